@@ -67,8 +67,8 @@ EventListModel::updateList(unsigned int track)
     clear();
     setupHeader();
     if (!m_ws) return;
-    auto& events = m_ws->events_abs_tick_mut(track);
-    events.linkNotePairs();
+    // the workspace keeps the note pairs linked as events are edited
+    const auto& events = m_ws->events_abs_tick(track);
     const auto events_len = events.getEventCount();
 
     //auto debug_vector = [](const aut)
@@ -0,0 +1,261 @@
+#include "eventtrack.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+
+namespace midie
+{
+
+EventTrack::const_iterator::const_iterator(const EventTrack& track, Position pos)
+    : m_track(&track), m_pos(pos)
+{}
+
+smf::MidiEvent&
+EventTrack::const_iterator::operator*() const
+{
+    return *m_track->m_chunks[m_pos.chunk][m_pos.offset];
+}
+
+smf::MidiEvent*
+EventTrack::const_iterator::operator->() const
+{
+    return m_track->m_chunks[m_pos.chunk][m_pos.offset];
+}
+
+EventTrack::const_iterator&
+EventTrack::const_iterator::operator++()
+{
+    m_pos.offset++;
+    if (m_pos.offset == m_track->m_chunks[m_pos.chunk].size()) {
+        m_pos.chunk++;
+        m_pos.offset = 0;
+    }
+    return *this;
+}
+
+bool
+EventTrack::const_iterator::operator==(const const_iterator& other) const
+{
+    return m_pos.chunk == other.m_pos.chunk && m_pos.offset == other.m_pos.offset;
+}
+
+bool
+EventTrack::const_iterator::operator!=(const const_iterator& other) const
+{
+    return !(*this == other);
+}
+
+
+EventTrack::EventTrack(const smf::MidiEventList& events)
+{
+    assign(events);
+}
+
+void
+EventTrack::assign(const smf::MidiEventList& events)
+{
+    m_chunks.clear();
+    m_size = static_cast<size_t>(events.getEventCount());
+    // Fill chunks to 3/4 so that the first inserts do not split them.
+    const size_t fill = CHUNK_SIZE * 3 / 4;
+    for (size_t i=0; i<m_size; i+=fill) {
+        const auto count = std::min(fill, m_size - i);
+        std::vector<smf::MidiEvent*> chunk;
+        chunk.reserve(CHUNK_SIZE);
+        for (size_t j=0; j<count; j++) {
+            chunk.push_back(const_cast<smf::MidiEvent*>(&events[static_cast<int>(i + j)]));
+        }
+        m_chunks.push_back(std::move(chunk));
+    }
+    rebuild_tree();
+}
+
+smf::MidiEvent&
+EventTrack::at(size_t index) const
+{
+    if (index >= m_size)
+        throw std::out_of_range("event index out of range");
+
+    // Descend the Fenwick tree to the chunk which holds index.
+    const auto chunks = m_chunks.size();
+    size_t step = 1;
+    while (step * 2 <= chunks) {
+        step *= 2;
+    }
+    size_t chunk = 0;
+    for (; step>0; step/=2) {
+        if (chunk + step <= chunks && m_tree[chunk + step] <= index) {
+            chunk += step;
+            index -= m_tree[chunk];
+        }
+    }
+    return *m_chunks[chunk][index];
+}
+
+size_t
+EventTrack::index_of(Position pos) const
+{
+    size_t index = pos.offset;
+    for (auto i=pos.chunk; i>0; i-=i&(~i+1)) {
+        index += m_tree[i];
+    }
+    return index;
+}
+
+EventTrack::const_iterator
+EventTrack::begin() const
+{
+    return const_iterator(*this, Position{0, 0});
+}
+
+EventTrack::const_iterator
+EventTrack::end() const
+{
+    return const_iterator(*this, Position{m_chunks.size(), 0});
+}
+
+EventTrack::const_iterator
+EventTrack::lower_bound(int tick) const
+{
+    const auto chunk = find_chunk_at(tick);
+    if (chunk == m_chunks.size())
+        return end();
+    const auto& events = m_chunks[chunk];
+    const auto it = std::lower_bound(events.begin(), events.end(), tick,
+                                     [](const smf::MidiEvent* e, int t){ return e->tick < t; });
+    return const_iterator(*this, Position{chunk, static_cast<size_t>(it - events.begin())});
+}
+
+size_t
+EventTrack::insert(smf::MidiEvent* event)
+{
+    if (m_chunks.empty()) {
+        m_chunks.emplace_back();
+        m_chunks.back().reserve(CHUNK_SIZE);
+        rebuild_tree();
+    }
+    // The only chunk may be empty, and has no last event to compare.
+    auto chunk = m_size == 0 ? 0 : find_chunk_after(event->tick);
+    auto& events = m_chunks[chunk];
+    const auto it = std::upper_bound(events.begin(), events.end(), event->tick,
+                                     [](int t, const smf::MidiEvent* e){ return t < e->tick; });
+    auto offset = static_cast<size_t>(it - events.begin());
+    events.insert(it, event);
+    m_size++;
+    add_to_tree(chunk, 1);
+    if (events.size() > CHUNK_SIZE) {
+        split_chunk(chunk);
+        const auto half = m_chunks[chunk].size();
+        if (offset >= half) {
+            chunk++;
+            offset -= half;
+        }
+    }
+    return index_of(Position{chunk, offset});
+}
+
+smf::MidiEvent*
+EventTrack::erase(Position pos)
+{
+    auto& events = m_chunks.at(pos.chunk);
+    auto* event = events.at(pos.offset);
+    events.erase(events.begin() + static_cast<long>(pos.offset));
+    m_size--;
+    add_to_tree(pos.chunk, -1);
+    if (events.size() < CHUNK_SIZE / 4) {
+        merge_chunk(pos.chunk);
+    }
+    return event;
+}
+
+void
+EventTrack::write_to(smf::MidiEventList& list) const
+{
+    list.detach();
+    list.reserve(static_cast<int>(m_size));
+    for (const auto& events : m_chunks) {
+        for (auto* event : events) {
+            list.push_back_no_copy(event);
+        }
+    }
+}
+
+// Returns the first chunk whose last event is later than tick, or the last
+// chunk if there is none.
+size_t
+EventTrack::find_chunk_after(int tick) const
+{
+    const auto it = std::upper_bound(m_chunks.begin(), m_chunks.end(), tick,
+                                     [](int t, const auto& c){ return t < c.back()->tick; });
+    if (it == m_chunks.end())
+        return m_chunks.size() - 1;
+    return static_cast<size_t>(it - m_chunks.begin());
+}
+
+// Returns the first chunk whose last event is at tick or later, or the
+// number of chunks if there is none.
+size_t
+EventTrack::find_chunk_at(int tick) const
+{
+    const auto it = std::lower_bound(m_chunks.begin(), m_chunks.end(), tick,
+                                     [](const auto& c, int t){ return c.back()->tick < t; });
+    return static_cast<size_t>(it - m_chunks.begin());
+}
+
+void
+EventTrack::add_to_tree(size_t chunk, long delta)
+{
+    for (auto i=chunk+1; i<m_tree.size(); i+=i&(~i+1)) {
+        m_tree[i] = static_cast<size_t>(static_cast<long>(m_tree[i]) + delta);
+    }
+}
+
+void
+EventTrack::rebuild_tree()
+{
+    m_tree.assign(m_chunks.size() + 1, 0);
+    for (size_t i=1; i<m_tree.size(); i++) {
+        m_tree[i] += m_chunks[i-1].size();
+        const auto parent = i + (i&(~i+1));
+        if (parent < m_tree.size()) {
+            m_tree[parent] += m_tree[i];
+        }
+    }
+}
+
+void
+EventTrack::split_chunk(size_t chunk)
+{
+    auto& events = m_chunks[chunk];
+    const auto half = events.size() / 2;
+    std::vector<smf::MidiEvent*> upper;
+    upper.reserve(CHUNK_SIZE);
+    upper.assign(events.begin() + static_cast<long>(half), events.end());
+    events.resize(half);
+    m_chunks.insert(m_chunks.begin() + static_cast<long>(chunk) + 1, std::move(upper));
+    rebuild_tree();
+}
+
+// Moves the events of an underfull chunk into a neighbour, as long as the
+// neighbour stays below 3/4 full (so that it is not split again soon), and
+// removes the chunk. Empty chunks are always removed.
+void
+EventTrack::merge_chunk(size_t chunk)
+{
+    auto& events = m_chunks[chunk];
+    const auto limit = CHUNK_SIZE * 3 / 4;
+    if (chunk + 1 < m_chunks.size() && events.size() + m_chunks[chunk + 1].size() <= limit) {
+        auto& next = m_chunks[chunk + 1];
+        next.insert(next.begin(), events.begin(), events.end());
+    } else if (chunk > 0 && events.size() + m_chunks[chunk - 1].size() <= limit) {
+        auto& previous = m_chunks[chunk - 1];
+        previous.insert(previous.end(), events.begin(), events.end());
+    } else if (!events.empty()) {
+        return;
+    }
+    m_chunks.erase(m_chunks.begin() + static_cast<long>(chunk));
+    rebuild_tree();
+}
+
+}
@@ -0,0 +1,94 @@
+#ifndef EVENTTRACK_H
+#define EVENTTRACK_H
+
+#include <MidiEvent.h>
+#include <MidiEventList.h>
+#include <cstddef>
+#include <vector>
+
+
+namespace midie
+{
+
+// The events of one track in tick order, stored in chunks of at most
+// CHUNK_SIZE pointers. A Fenwick tree over the chunk sizes finds the chunk
+// holding an index, and chunks are found by tick with a binary search, so
+// looking up an event takes O(log n) time. Inserting or erasing one also
+// shifts the pointers within its chunk. Full chunks are split, and chunks
+// which fall below a quarter full are merged into a neighbour with room,
+// so this only happens after many edits of a chunk; only then are the
+// chunk list and the tree rebuilt, in O(n / CHUNK_SIZE) time. The events
+// are not owned by the track.
+class EventTrack
+{
+public:
+    static constexpr size_t CHUNK_SIZE = 512;
+
+    // Position of an event: chunk number and offset in the chunk.
+    struct Position
+    {
+        size_t chunk;
+        size_t offset;
+    };
+
+    class const_iterator
+    {
+    public:
+        const_iterator(const EventTrack& track, Position pos);
+
+        smf::MidiEvent& operator*() const;
+        smf::MidiEvent* operator->() const;
+        const_iterator& operator++();
+        bool operator==(const const_iterator& other) const;
+        bool operator!=(const const_iterator& other) const;
+
+        Position position() const { return m_pos; }
+
+    private:
+        const EventTrack* m_track;
+        Position m_pos;
+    };
+
+    EventTrack() = default;
+    explicit EventTrack(const smf::MidiEventList& events);
+
+    // Replaces the contents with the events of a tick-sorted list.
+    void assign(const smf::MidiEventList& events);
+
+    size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+
+    smf::MidiEvent& at(size_t index) const;
+    size_t index_of(Position pos) const;
+
+    const_iterator begin() const;
+    const_iterator end() const;
+    // First event with a tick of at least tick.
+    const_iterator lower_bound(int tick) const;
+
+    // Inserts event after the events with the same or an earlier tick and
+    // returns its index.
+    size_t insert(smf::MidiEvent* event);
+    // Removes the event at pos and returns it.
+    smf::MidiEvent* erase(Position pos);
+
+    // Stores the events in list (in order) without copying them. The list
+    // must not own any events which are not in this track.
+    void write_to(smf::MidiEventList& list) const;
+
+private:
+    std::vector<std::vector<smf::MidiEvent*>> m_chunks;
+    std::vector<size_t> m_tree; // Fenwick tree of chunk sizes
+    size_t m_size = 0;
+
+    size_t find_chunk_after(int tick) const;
+    size_t find_chunk_at(int tick) const;
+    void add_to_tree(size_t chunk, long delta);
+    void rebuild_tree();
+    void split_chunk(size_t chunk);
+    void merge_chunk(size_t chunk);
+};
+
+}
+
+#endif // EVENTTRACK_H
@@ -5,6 +5,9 @@
 #include "midiworkspace.h"
 #include "trackchooser.h"
 #include <QFileDialog>
+#include <QMessageBox>
+#include <QProgressBar>
+#include <QThread>
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
@@ -13,6 +16,15 @@ MainWindow::MainWindow(QWidget *parent)
     ui->setupUi(this);
     connect(ui->actionNewSmf, &QAction::triggered, this, &MainWindow::newSmf);
     connect(ui->actionOpenSmf, &QAction::triggered, this, &MainWindow::loadSmf);
+    connect(ui->actionWriteSmf, &QAction::triggered, this, &MainWindow::saveSmf);
+    connect(ui->actionWriteSmfAs, &QAction::triggered, this, &MainWindow::saveSmfAs);
+
+    // busy indicator shown in the status bar while a file is being written
+    m_save_progress = new QProgressBar(this);
+    m_save_progress->setRange(0, 0);
+    m_save_progress->setMaximumWidth(160);
+    m_save_progress->hide();
+    ui->statusbar->addPermanentWidget(m_save_progress);
 
     connect(this, &MainWindow::notifyNewSmf, ui->scrollAreaWidgetContents, &midie::PianoRollWidget::replaceWorkspace);
     connect(this, &MainWindow::notifyNewSmf, ui->trackComboBox, &midie::TrackChooser::replaceWorkspace);
@@ -24,16 +36,90 @@ MainWindow::MainWindow(QWidget *parent)
 
 MainWindow::~MainWindow()
 {
+    if (m_save_thread) {
+        // let a running save finish so that the file is complete.
+        m_save_thread->wait();
+        delete m_save_thread;
+    }
     delete ui;
 }
 
+void MainWindow::setWorkspace(std::shared_ptr<midie::MidiWorkspace> ws, const QString& path)
+{
+    m_workspace = ws;
+    m_path = path;
+    notifyNewSmf(ws);
+}
+
 void MainWindow::newSmf()
 {
-    notifyNewSmf(std::make_shared<midie::MidiWorkspace>());
+    setWorkspace(std::make_shared<midie::MidiWorkspace>(), QString());
 }
 
 void MainWindow::loadSmf()
 {
     const auto& filename = QFileDialog::getOpenFileName(this, tr("Open SMF"), "", tr("Standard MIDI File (*.mid)"));
-    notifyNewSmf(std::make_shared<midie::MidiWorkspace>(filename));
+    setWorkspace(std::make_shared<midie::MidiWorkspace>(filename), filename);
+}
+
+void MainWindow::saveSmf()
+{
+    if (m_path.isEmpty()) {
+        saveSmfAs();
+        return;
+    }
+    startSave(m_path);
+}
+
+void MainWindow::saveSmfAs()
+{
+    if (!m_workspace)
+        return;
+    const auto& filename = QFileDialog::getSaveFileName(this, tr("Save SMF"), m_path, tr("Standard MIDI File (*.mid)"));
+    if (filename.isEmpty())
+        return;
+    startSave(filename);
+}
+
+void MainWindow::startSave(const QString& path)
+{
+    if (!m_workspace || m_save_thread)
+        return;
+
+    // The snapshot is taken here, on the GUI thread, so that it cannot
+    // observe an edit in progress. Encoding and writing happen on the
+    // worker thread while the workspace stays editable.
+    auto snapshot = m_workspace->snapshot();
+    const auto path_str = path.toStdString();
+    m_save_thread = QThread::create([this, snapshot, path, path_str]() {
+        const bool ok = midie::write_smf_atomically(*snapshot, path_str);
+        if (ok)
+            midie::write_smf_cache(*snapshot, path_str); // keep reopening fast
+        QMetaObject::invokeMethod(this, [this, ok, path]() { finishSave(ok, path); }, Qt::QueuedConnection);
+    });
+
+    ui->actionWriteSmf->setEnabled(false);
+    ui->actionWriteSmfAs->setEnabled(false);
+    m_save_progress->show();
+    ui->statusbar->showMessage(tr("Saving %1...").arg(path));
+    m_save_thread->start();
+}
+
+void MainWindow::finishSave(bool ok, const QString& path)
+{
+    m_save_thread->wait();
+    delete m_save_thread;
+    m_save_thread = nullptr;
+
+    m_save_progress->hide();
+    ui->actionWriteSmf->setEnabled(true);
+    ui->actionWriteSmfAs->setEnabled(true);
+
+    if (ok) {
+        m_path = path;
+        ui->statusbar->showMessage(tr("Saved %1").arg(path), 5000);
+    } else {
+        ui->statusbar->clearMessage();
+        QMessageBox::warning(this, tr("Save SMF"), tr("Could not write %1.").arg(path));
+    }
 }
@@ -2,10 +2,13 @@
 #define MAINWINDOW_H
 
 #include <QMainWindow>
+#include <QString>
 #include <memory>
 
 QT_BEGIN_NAMESPACE
 namespace Ui { class MainWindow; }
+class QProgressBar;
+class QThread;
 QT_END_NAMESPACE
 
 namespace midie { class MidiWorkspace; }
@@ -21,11 +24,24 @@ public:
 private:
     Ui::MainWindow *ui;
 
+    std::shared_ptr<midie::MidiWorkspace> m_workspace;
+    QString m_path;
+
+    // the thread writing a snapshot of the workspace, or nullptr.
+    QThread *m_save_thread = nullptr;
+    QProgressBar *m_save_progress;
+
+    void setWorkspace(std::shared_ptr<midie::MidiWorkspace> ws, const QString& path);
+    void startSave(const QString& path);
+    void finishSave(bool ok, const QString& path);
+
 signals:
     void notifyNewSmf(std::shared_ptr<midie::MidiWorkspace> new_ws);
 
 public slots:
     void newSmf();
     void loadSmf();
+    void saveSmf();
+    void saveSmfAs();
 };
 #endif // MAINWINDOW_H
@@ -59,6 +59,9 @@ class Binasc {
 		                                              const std::string& infile);
 		int                  writeToBinary           (std::ostream& out,
 		                                              std::istream& input);
+		int                  writeLineToBinary       (std::ostream& out,
+		                                              const std::string& line,
+		                                              int lineNum);
 
 		// functions for converting into an ASCII file with hex bytes:
 		int                  readFromBinary          (const std::string&
@@ -135,6 +138,9 @@ class Binasc {
 		int                  processMidiTempoWord    (std::ostream& out,
 		                                              const std::string& input,
 		                                              int lineNum);
+		int                  processSimpleWord       (std::ostream& out,
+		                                              const std::string& input,
+		                                              int index);
 
 		// helper functions for reading binary content to convert to ASCII:
 		int  outputStyleAscii   (std::ostream& out, std::istream& input);
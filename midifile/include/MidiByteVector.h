@@ -0,0 +1,270 @@
+//
+// Creation Date: Sat Oct 17 09:05:22 JST 2026
+// Last Modified: Sat Oct 17 09:05:22 JST 2026
+// Filename:      midifile/include/MidiByteVector.h
+// Website:       http://midifile.sapp.org
+// Syntax:        C++11
+// vim:           ts=3 noexpandtab
+//
+// Description:   Byte storage for MidiMessage with the interface of
+//                std::vector<uchar>.  Messages of up to 16 bytes (all
+//                channel messages and most meta messages) are stored
+//                inside the object; only longer system exclusive and meta
+//                messages use memory on the heap.
+//
+
+#ifndef _MIDIBYTEVECTOR_H_INCLUDED
+#define _MIDIBYTEVECTOR_H_INCLUDED
+
+#include <cstddef>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <vector>
+
+namespace smf {
+
+typedef unsigned char  uchar;
+
+class MidiByteVector {
+	public:
+		typedef uchar                                 value_type;
+		typedef size_t                                size_type;
+		typedef ptrdiff_t                             difference_type;
+		typedef uchar&                                reference;
+		typedef const uchar&                          const_reference;
+		typedef uchar*                                pointer;
+		typedef const uchar*                          const_pointer;
+		typedef uchar*                                iterator;
+		typedef const uchar*                          const_iterator;
+		typedef std::reverse_iterator<iterator>       reverse_iterator;
+		typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+
+		// number of bytes stored inside the object:
+		enum { LOCAL_CAPACITY = 16 };
+
+		// m_kind value while the bytes may be changed through a pointer,
+		// reference or iterator from a non-const accessor:
+		enum { KIND_UNCACHED = 255 };
+
+		                MidiByteVector   (void);
+		                MidiByteVector   (size_t count, uchar value = 0);
+		                MidiByteVector   (const MidiByteVector& other);
+		                MidiByteVector   (MidiByteVector&& other) noexcept;
+
+		               ~MidiByteVector   ();
+
+		MidiByteVector& operator=        (const MidiByteVector& other);
+		MidiByteVector& operator=        (MidiByteVector&& other) noexcept;
+
+		// size and storage:
+		size_t          size             (void) const { return m_size; }
+		bool            empty            (void) const { return m_size == 0; }
+		size_t          capacity         (void) const { return m_capacity; }
+		size_t          max_size         (void) const { return UINT32_MAX; }
+		bool            isLocal          (void) const;
+		void            resize           (size_t count);
+		void            resize           (size_t count, uchar value);
+		void            reserve          (size_t count);
+		void            shrink_to_fit    (void);
+		void            clear            (void) { m_size = 0; resetKind(); }
+		void            swap             (MidiByteVector& other) noexcept;
+
+		// element access:
+		uchar*          data             (void);
+		const uchar*    data             (void) const;
+		uchar&          operator[]       (size_t index) { return data()[index]; }
+		const uchar&    operator[]       (size_t index) const { return data()[index]; }
+		uchar&          front            (void) { return data()[0]; }
+		const uchar&    front            (void) const { return data()[0]; }
+		uchar&          back             (void) { return data()[m_size-1]; }
+		const uchar&    back             (void) const { return data()[m_size-1]; }
+
+		// iterators:
+		iterator        begin            (void) { return data(); }
+		const_iterator  begin            (void) const { return data(); }
+		const_iterator  cbegin           (void) const { return data(); }
+		iterator        end              (void) { return data() + m_size; }
+		const_iterator  end              (void) const { return data() + m_size; }
+		const_iterator  cend             (void) const { return data() + m_size; }
+		reverse_iterator       rbegin    (void) { return reverse_iterator(end()); }
+		const_reverse_iterator rbegin    (void) const { return const_reverse_iterator(end()); }
+		reverse_iterator       rend      (void) { return reverse_iterator(begin()); }
+		const_reverse_iterator rend      (void) const { return const_reverse_iterator(begin()); }
+
+		// modifiers:
+		void            push_back        (uchar value);
+		void            pop_back         (void) { m_size--; invalidateKind(); }
+		void            assign           (size_t count, uchar value);
+		void            assign           (const uchar* first, const uchar* last);
+		iterator        insert           (const_iterator pos, uchar value);
+		iterator        insert           (const_iterator pos, size_t count,
+		                                  uchar value);
+		iterator        insert           (const_iterator pos, const uchar* first,
+		                                  const uchar* last);
+		iterator        erase            (const_iterator pos);
+		iterator        erase            (const_iterator first,
+		                                  const_iterator last);
+
+		// conversion for functions which take a std::vector:
+		                operator std::vector<uchar> (void) const;
+
+	protected:
+		uchar*          storage          (void);
+		uchar*          makeGap          (size_t index, size_t count);
+		void            grow             (size_t count);
+
+		// Classification of the bytes cached by MidiMessage::getKind() (0 if
+		// not known).  It is cleared by every non-const function.  Functions
+		// which hand out a writable pointer, reference or iterator stop the
+		// caching altogether, since the bytes may be changed through it
+		// later.  The caching starts again when the bytes are replaced
+		// (clear, assign, operator=), or with resetKind():
+		int             getCachedKind    (void) const;
+		void            setCachedKind    (int kind) const;
+		void            invalidateKind   (void);
+		void            resetKind        (void);
+
+	private:
+		// The bytes are stored in m_local if m_capacity is LOCAL_CAPACITY,
+		// otherwise in m_heap.
+		union {
+			uchar  m_local[LOCAL_CAPACITY];
+			uchar* m_heap;
+		};
+		uint32_t m_size     = 0;
+		uint32_t m_capacity = LOCAL_CAPACITY;
+
+		// m_kind == Cached kind of the message.  It is written by const
+		// functions, so it is atomic to allow several threads to read the
+		// same message.  (It fits in the padding at the end of the object,
+		// where MidiEvent places its first member, so it costs no space in
+		// events.)
+		mutable std::atomic<uchar> m_kind{0};
+};
+
+
+bool operator==(const MidiByteVector& a, const MidiByteVector& b);
+bool operator!=(const MidiByteVector& a, const MidiByteVector& b);
+bool operator< (const MidiByteVector& a, const MidiByteVector& b);
+
+
+//////////////////////////////
+//
+// MidiByteVector::isLocal -- Returns true if the bytes are stored inside
+//    the object.
+//
+
+inline bool MidiByteVector::isLocal(void) const {
+	return m_capacity == LOCAL_CAPACITY;
+}
+
+
+
+//////////////////////////////
+//
+// MidiByteVector::data -- Returns a pointer to the first byte.
+//
+
+inline uchar* MidiByteVector::data(void) {
+	// The bytes may be changed through the pointer at any time.
+	m_kind.store(KIND_UNCACHED, std::memory_order_relaxed);
+	return storage();
+}
+
+
+inline const uchar* MidiByteVector::data(void) const {
+	return isLocal() ? m_local : m_heap;
+}
+
+
+
+//////////////////////////////
+//
+// MidiByteVector::push_back -- Append a byte.
+//
+
+inline void MidiByteVector::push_back(uchar value) {
+	if (m_size == m_capacity) {
+		grow(m_size + 1);
+	}
+	storage()[m_size++] = value;
+	invalidateKind();
+}
+
+
+
+//////////////////////////////
+//
+// MidiByteVector::resize -- Change the number of bytes.  New bytes are
+//    set to zero (or to the given value).
+//
+
+inline void MidiByteVector::resize(size_t count) {
+	resize(count, 0);
+}
+
+
+inline void MidiByteVector::resize(size_t count, uchar value) {
+	if (count > m_capacity) {
+		grow(count);
+	}
+	if (count > m_size) {
+		memset(storage() + m_size, value, count - m_size);
+	}
+	m_size = (uint32_t)count;
+	invalidateKind();
+}
+
+
+
+//////////////////////////////
+//
+// MidiByteVector::storage -- Returns a pointer to the first byte for
+//    the functions which change the bytes themselves.
+//
+
+inline uchar* MidiByteVector::storage(void) {
+	return isLocal() ? m_local : m_heap;
+}
+
+
+
+//////////////////////////////
+//
+// MidiByteVector::getCachedKind -- Returns the kind stored by
+//    setCachedKind(), or 0 if the bytes have been changed since then.
+//
+
+inline int MidiByteVector::getCachedKind(void) const {
+	int kind = m_kind.load(std::memory_order_relaxed);
+	return kind == KIND_UNCACHED ? 0 : kind;
+}
+
+
+inline void MidiByteVector::setCachedKind(int kind) const {
+	// Nothing is stored while the caching is stopped.
+	uchar expected = 0;
+	m_kind.compare_exchange_strong(expected, (uchar)kind,
+			std::memory_order_relaxed);
+}
+
+
+inline void MidiByteVector::invalidateKind(void) {
+	if (m_kind.load(std::memory_order_relaxed) != KIND_UNCACHED) {
+		m_kind.store(0, std::memory_order_relaxed);
+	}
+}
+
+
+inline void MidiByteVector::resetKind(void) {
+	m_kind.store(0, std::memory_order_relaxed);
+}
+
+} // end of namespace smf
+
+#endif /* _MIDIBYTEVECTOR_H_INCLUDED */
+
+
+
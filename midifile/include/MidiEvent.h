@@ -26,14 +26,18 @@ class MidiEvent : public MidiMessage {
 		           MidiEvent             (int command, int param1);
 		           MidiEvent             (int command, int param1, int param2);
 		           MidiEvent             (const MidiMessage& message);
+		           MidiEvent             (MidiMessage&& message);
 		           MidiEvent             (const MidiEvent& mfevent);
+		           MidiEvent             (MidiEvent&& mfevent);
 		           MidiEvent             (int aTime, int aTrack,
 		                                  std::vector<uchar>& message);
 
 		          ~MidiEvent             ();
 
 		MidiEvent& operator=             (const MidiEvent& mfevent);
+		MidiEvent& operator=             (MidiEvent&& mfevent);
 		MidiEvent& operator=             (const MidiMessage& message);
+		MidiEvent& operator=             (MidiMessage&& message);
 		MidiEvent& operator=             (const std::vector<uchar>& bytes);
 		MidiEvent& operator=             (const std::vector<char>& bytes);
 		MidiEvent& operator=             (const std::vector<int>& bytes);
@@ -55,12 +59,19 @@ class MidiEvent : public MidiMessage {
 
 		int        tick;     // delta or absolute MIDI ticks
 		int        track;    // [original] track number of event in MIDI file
-		double     seconds;  // calculated time in sec. (after doTimeAnalysis())
 		int        seq;      // sorting sequence number of event
+		double     seconds;  // calculated time in sec. (after doTimeAnalysis())
 
 	private:
 		MidiEvent* m_eventlink;  // used to match note-ons and note-offs
 
+		// m_arenablock == The MidiEventArena block which holds the event,
+		// or NULL if the event was allocated with new.  Events in a block
+		// have to be deleted with MidiEventArena::deleteEvent().
+		void*      m_arenablock = NULL;
+
+	friend class MidiEventArena;
+	friend class MidiEventList;
 };
 
 } // end of namespace smf
@@ -0,0 +1,57 @@
+//
+// Creation Date: Fri Oct 16 20:41:37 JST 2026
+// Last Modified: Fri Oct 16 20:41:37 JST 2026
+// Filename:      midifile/include/MidiEventArena.h
+// Website:       http://midifile.sapp.org
+// Syntax:        C++11
+// vim:           ts=3 noexpandtab
+//
+// Description:   Allocates MidiEvents in large blocks instead of one at
+//                a time.  The events are still deleted one at a time
+//                with deleteEvent(), which destroys the event and
+//                decrements the atomic count of its block.  A block is
+//                freed when the last of its events has been deleted, so
+//                the events can outlive the arena.
+//
+
+#ifndef _MIDIEVENTARENA_H_INCLUDED
+#define _MIDIEVENTARENA_H_INCLUDED
+
+#include "MidiEvent.h"
+
+#include <cstddef>
+
+namespace smf {
+
+class MidiEventArena {
+	public:
+		                MidiEventArena      (void);
+		                MidiEventArena      (const MidiEventArena& other) = delete;
+
+		               ~MidiEventArena      ();
+
+		MidiEventArena& operator=           (const MidiEventArena& other) = delete;
+
+		MidiEvent*      newEvent            (void);
+		static void     deleteEvent         (MidiEvent* event);
+		int             getBlockCount       (void) const;
+
+	protected:
+		void            startBlock          (void);
+		static void     releaseBlock        (void* block);
+
+		// m_block == The block in which new events are placed, or NULL
+		// before the first event.  The arena holds a reference to the
+		// block until it starts the next one.
+		char*  m_block    = NULL;
+		int    m_used     = 0;    // events placed in m_block
+		int    m_capacity = 0;    // events which fit in m_block
+		int    m_blocks   = 0;    // number of blocks started
+};
+
+} // end of namespace smf
+
+#endif /* _MIDIEVENTARENA_H_INCLUDED */
+
+
+
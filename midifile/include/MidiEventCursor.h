@@ -0,0 +1,113 @@
+//
+// Creation Date: Fri Oct 16 16:05:31 JST 2026
+// Last Modified: Fri Oct 16 16:05:31 JST 2026
+// Filename:      midifile/include/MidiEventCursor.h
+// Website:       http://midifile.sapp.org
+// Syntax:        C++11
+// vim:           ts=3 noexpandtab
+//
+// Description:   Reads the events of a Standard MIDI File one at a time
+//                in file order, without storing them in a MidiFile.
+//                Memory use does not depend on the size of the file.
+//
+
+#ifndef _MIDIEVENTCURSOR_H_INCLUDED
+#define _MIDIEVENTCURSOR_H_INCLUDED
+
+#include "MidiMessage.h"
+#include "MidiTrackDecoder.h"
+
+#include <fstream>
+#include <istream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace smf {
+
+class MidiEventCursor {
+	public:
+		               MidiEventCursor      (void);
+		               MidiEventCursor      (const std::string& filename);
+		               MidiEventCursor      (std::istream& input);
+		               MidiEventCursor      (const MidiEventCursor& other) = delete;
+
+		              ~MidiEventCursor      ();
+
+		MidiEventCursor& operator=          (const MidiEventCursor& other) = delete;
+
+		bool           open                 (const std::string& filename);
+		bool           open                 (std::istream& input);
+		void           close                (void);
+		bool           status               (void) const;
+
+		// header information:
+		int            getType              (void) const;
+		int            getTrackCount        (void) const;
+		int            getTicksPerQuarterNote(void) const;
+		int            getTPQ               (void) const;
+
+		// event iteration:
+		bool           next                 (void);
+		int            getTrack             (void) const;
+		int            getTick              (void) const;
+		int            getCommandByte       (void) const;
+		const uchar*   getPayload           (void) const;
+		int            getPayloadSize       (void) const;
+		bool           isMeta               (void) const;
+		int            getMetaType          (void) const;
+		const uchar*   getMetaContent       (void) const;
+		int            getMetaContentSize   (void) const;
+		std::string    getMetaText          (void) const;
+		bool           isEndOfTrack         (void) const;
+		void           getMessage           (MidiMessage& message) const;
+
+		// physical-time functions:
+		int            getTempoCount        (void) const;
+		double         getTimeInSeconds     (int tick) const;
+
+	protected:
+		bool           readHeader           (void);
+		bool           fill                 (size_t minimum);
+		static void    mergeTempos          (std::vector<std::pair<int, double>>& tempos,
+		                                     size_t count);
+
+		// Input source: either a file opened by the cursor, an external
+		// stream, or binasc content converted to binary.
+		std::ifstream      m_file;
+		std::stringstream  m_binary;
+		std::istream*      m_input = NULL;
+
+		// m_buffer == Window of the input data.  Only the bytes from
+		// m_begin to m_end are valid.  The buffer only grows beyond its
+		// initial size for single messages larger than the buffer.
+		std::vector<uchar> m_buffer;
+		size_t             m_begin    = 0;
+		size_t             m_end      = 0;
+		size_t             m_consumed = 0;  // size of current event
+
+		MidiTrackDecoder   m_decoder;
+
+		// m_tempos == The tempo changes read so far (tick, seconds per
+		// quarter note).  The first m_trackTempos entries are those of the
+		// finished tracks, sorted by tick.
+		std::vector<std::pair<int, double>> m_tempos;
+		size_t             m_trackTempos = 0;
+
+		int   m_type    = 0;
+		int   m_tracks  = 0;
+		int   m_tpq     = 120;
+		int   m_track   = -1;     // current track
+		int   m_tick    = 0;      // absolute tick of current event
+		bool  m_inTrackQ = false; // true between MTrk header and end-of-track
+		bool  m_eventQ  = false;  // true if an event is available
+		bool  m_status  = false;  // false after an error or if not open
+};
+
+} // end of namespace smf
+
+#endif /* _MIDIEVENTCURSOR_H_INCLUDED */
+
+
+
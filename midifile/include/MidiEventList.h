@@ -14,6 +14,7 @@
 #define _MIDIEVENTLIST_H_INCLUDED
 
 #include "MidiEvent.h"
+#include <utility>
 #include <vector>
 
 namespace smf {
@@ -22,11 +23,12 @@ class MidiEventList {
 	public:
 		                 MidiEventList      (void);
 		                 MidiEventList      (const MidiEventList& other);
-		                 MidiEventList      (MidiEventList&& other);
+		                 MidiEventList      (MidiEventList&& other) noexcept;
 
 		                ~MidiEventList      ();
 
-		MidiEventList&   operator=          (MidiEventList& other);
+		MidiEventList&   operator=          (const MidiEventList& other);
+		MidiEventList&   operator=          (MidiEventList&& other);
 		MidiEvent&       operator[]         (int index);
 		const MidiEvent& operator[]         (int index) const;
 
@@ -48,9 +50,23 @@ class MidiEventList {
 		void             clearSequence      (void);
 		int              markSequence       (int sequence = 1);
 
-		int              push               (MidiEvent& event);
-		int              push_back          (MidiEvent& event);
-		int              append             (MidiEvent& event);
+		// finding events by kind (masks of MidiMessage::KIND_* values,
+		// such as MidiMessage::KINDS_NOTES):
+		int              findNextKind       (int index,
+		                                     unsigned int kinds) const;
+		std::vector<int> getKindIndex       (unsigned int kinds) const;
+
+		int              push               (const MidiEvent& event);
+		int              push               (MidiEvent&& event);
+		int              push_back          (const MidiEvent& event);
+		int              push_back          (MidiEvent&& event);
+		int              append             (const MidiEvent& event);
+		int              append             (MidiEvent&& event);
+
+		// construct an event at the end of the list from the arguments of
+		// one of the MidiEvent constructors, without copying it:
+		template <class... Args>
+		int              emplace_back       (Args&&... args);
 
 		// careful when using these, intended for internal use in MidiFile class:
 		void             detach             (void);
@@ -62,21 +78,38 @@ class MidiEventList {
         // event list manipulation.
         // from https://github.com/craigsapp/midifile/pull/52.
         int              remove             (int index);
-        int              insert             (int index, MidiEvent& event);
+        int              insert             (int index, const MidiEvent& event);
+        int              insert             (int index, MidiEvent&& event);
 
 	protected:
 		std::vector<MidiEvent*> list;
 
 	private:
 		void             sort                (void);
+		int              linkNotePairs       (bool unlinkOthers);
+		void             clearLinks          (bool unlinkOthers);
 
-	// MidiFile class calls sort()
+	// MidiFile class calls sort(), and links tracks concurrently
 	friend class MidiFile;
 };
 
 
 int eventcompare(const void* a, const void* b);
 
+
+
+//////////////////////////////
+//
+// MidiEventList::emplace_back -- Add an event constructed from the given
+//     arguments at the end of the list.  Returns the index of the event.
+//
+
+template <class... Args>
+int MidiEventList::emplace_back(Args&&... args) {
+	list.push_back(new MidiEvent(std::forward<Args>(args)...));
+	return (int)list.size()-1;
+}
+
 } // end of namespace smf
 
 #endif /* _MIDIEVENTLIST_H_INCLUDED */
@@ -20,6 +20,9 @@
 #include <string>
 #include <istream>
 #include <fstream>
+#include <cstdint>
+#include <functional>
+#include <memory>
 
 #define TIME_STATE_DELTA       0
 #define TIME_STATE_ABSOLUTE    1
@@ -29,10 +32,13 @@
 
 namespace smf {
 
-class _TickTime {
+// One tempo segment of the time map: the ticks from tick up to the start
+// of the next segment are seconds + (t - tick) * secondsPerTick.
+class _TempoSegment {
 	public:
 		int    tick;
 		double seconds;
+		double secondsPerTick;
 };
 
 
@@ -52,8 +58,10 @@ class MidiFile {
 		// reading/writing functions:
 		bool           read                        (const std::string& filename);
 		bool           read                        (std::istream& instream);
+		bool           read                        (const uchar* data,
+		                                            size_t length);
 		bool           write                       (const std::string& filename);
-		bool           write                       (std::ostream& out);
+		bool           write                       (std::ostream& out) const;
 		bool           writeHex                    (const std::string& filename,
 		                                            int width = 25);
 		bool           writeHex                    (std::ostream& out,
@@ -64,9 +72,24 @@ class MidiFile {
 		bool           writeBinascWithComments     (std::ostream& out);
 		bool           status                      (void) const;
 
+		// binary cache functions:
+		bool           readCache                   (const std::string& cachefile,
+		                                            const std::string& sourcefile);
+		bool           writeCache                  (const std::string& cachefile,
+		                                            const std::string& sourcefile) const;
+
+		// multi-threading functions:
+		void           setThreadCount              (int count);
+		int            getThreadCount              (void) const;
+
+		// event storage functions:
+		void           setArenaStorage             (bool state);
+		bool           getArenaStorage             (void) const;
+
 		// track-related functions:
 		const MidiEventList& operator[]            (int aTrack) const;
 		MidiEventList&   operator[]                (int aTrack);
+		bool             isTrackShared             (int aTrack) const;
 		int              getTrackCount             (void) const;
 		int              getNumTracks              (void) const;
 		int              size                      (void) const;
@@ -118,6 +141,8 @@ class MidiFile {
 		void             doTimeAnalysis            (void);
 		double           getTimeInSeconds          (int aTrack, int anIndex);
 		double           getTimeInSeconds          (int tickvalue);
+		void             getTimesInSeconds         (const std::vector<int>& ticks,
+		                                            std::vector<double>& seconds);
 		double           getAbsoluteTickTime       (double starttime);
 		int              getFileDurationInTicks    (void);
 		double           getFileDurationInQuarters (void);
@@ -126,6 +151,8 @@ class MidiFile {
 		// note-analysis functions:
 		int              linkNotePairs             (void);
 		int              linkEventPairs            (void);
+		void             setLinkedNotePairs        (bool state);
+		bool             hasLinkedNotePairs        (void) const;
 		void             clearLinks                (void);
 
 		// filename functions:
@@ -135,8 +162,12 @@ class MidiFile {
 		// event functionality:
 		MidiEvent*       addEvent                  (int aTrack, int aTick,
 		                                            std::vector<uchar>& midiData);
-		MidiEvent*       addEvent                  (MidiEvent& mfevent);
-		MidiEvent*       addEvent                  (int aTrack, MidiEvent& mfevent);
+		MidiEvent*       addEvent                  (const MidiEvent& mfevent);
+		MidiEvent*       addEvent                  (MidiEvent&& mfevent);
+		MidiEvent*       addEvent                  (int aTrack,
+		                                            const MidiEvent& mfevent);
+		MidiEvent*       addEvent                  (int aTrack,
+		                                            MidiEvent&& mfevent);
 		MidiEvent&       getEvent                  (int aTrack, int anIndex);
 		const MidiEvent& getEvent                  (int aTrack, int anIndex) const;
 		int              getEventCount             (int aTrack) const;
@@ -243,7 +274,9 @@ class MidiFile {
 
 	protected:
 		// m_events == Lists of MidiEvents for each MIDI file track.
-		std::vector<MidiEventList*> m_events;
+		// Copies of a MidiFile share the lists until they change them
+		// (see unshareTrack()).
+		std::vector<std::shared_ptr<MidiEventList>> m_events;
 
 		// m_ticksPerQuarterNote == A value for the MIDI file header
 		// which represents the number of ticks in a quarter note
@@ -267,11 +300,13 @@ class MidiFile {
 		// the object.
 		std::string m_readFileName;
 
-		// m_timemapvalid ==
+		// m_timemapvalid == True if m_timemap matches the events.
 		bool m_timemapvalid = false;
 
-		// m_timemap ==
-		std::vector<_TickTime> m_timemap;
+		// m_timemap == The tempo segments of the file in tick order, starting
+		// at tick 0.  The last entry marks the end of the file: the tick of
+		// the last event and its time in seconds.
+		std::vector<_TempoSegment> m_timemap;
 
 		// m_rwstatus == True if last read was successful, false if a problem.
 		bool m_rwstatus = true;
@@ -279,10 +314,56 @@ class MidiFile {
 		// m_linkedEventQ == True if link analysis has been done.
 		bool m_linkedEventsQ = false;
 
+		// m_threadCount == The number of threads which may be used for
+		// processing tracks concurrently (1 = no threading, 0 = use all
+		// hardware threads).
+		int m_threadCount = 1;
+
+		// m_arenaQ == True if events read from files are placed in blocks
+		// by MidiEventArena instead of being allocated one at a time.
+		bool m_arenaQ = false;
+
+		void       unshareTrack                    (int aTrack);
+		void       unshareTracks                   (void);
+
 	private:
 		int        extractMidiData                 (std::istream& inputfile,
 		                                            std::vector<uchar>& array,
 		                                            uchar& runningCommand);
+		bool       readBinasc                      (std::istream& input);
+		bool       readStream                      (std::istream& input);
+		bool       decodeFile                      (const uchar* data,
+		                                            size_t length);
+		bool       readHeaderChunk                 (const uchar*& ptr,
+		                                            const uchar* end,
+		                                            int& tracks,
+		                                            bool reportQ);
+		bool       readTrackHeader                 (const uchar*& ptr,
+		                                            const uchar* end,
+		                                            ulong& chunksize,
+		                                            bool reportQ);
+		const char* decodeTrack                    (int track,
+		                                            const uchar* data,
+		                                            size_t size,
+		                                            size_t& used);
+		bool       readTracksInParallel            (const uchar* data,
+		                                            const uchar* end,
+		                                            int tracks);
+		void       encodeChunks                    (std::vector<std::vector<uchar>>&
+		                                            chunks) const;
+		void       encodeTrackChunk                (int track,
+		                                            std::vector<uchar>& chunk,
+		                                            std::string& messages) const;
+		void       runTrackTasks                   (const std::function<void(int)>&
+		                                            task) const;
+		static ulong getWritableVLV                (long value,
+		                                            std::ostream* errors = NULL);
+		static bool writeChunks                    (const std::string& filename,
+		                                            const std::vector<std::vector<uchar>>&
+		                                            chunks);
+		static bool getSourceKey                   (const std::string& filename,
+		                                            uint64_t& size, int64_t& time);
+		static int  getCacheSize                   (int status);
 		ulong      readVLValue                     (std::istream& inputfile);
 		ulong      unpackVLV                       (uchar a = 0, uchar b = 0,
 		                                            uchar c = 0, uchar d = 0,
@@ -290,11 +371,9 @@ class MidiFile {
 		void       writeVLValue                    (long aValue,
 		                                            std::vector<uchar>& data);
 		int        makeVLV                         (uchar *buffer, int number);
-		static int ticksearch                      (const void* A, const void* B);
-		static int secondsearch                    (const void* A, const void* B);
 		void       buildTimeMap                    (void);
-		double     linearTickInterpolationAtSecond (double seconds);
-		double     linearSecondInterpolationAtTick (int ticktime);
+		int        getSegmentAtTick                (int tick) const;
+		int        getSegmentAtSeconds             (double seconds) const;
 };
 
 } // end of namespace smf
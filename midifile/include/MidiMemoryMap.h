@@ -0,0 +1,67 @@
+//
+// Creation Date: Fri Oct 16 09:12:40 JST 2026
+// Last Modified: Fri Oct 16 09:12:40 JST 2026
+// Filename:      midifile/include/MidiMemoryMap.h
+// Website:       http://midifile.sapp.org
+// Syntax:        C++11
+// vim:           ts=3 noexpandtab
+//
+// Description:   Read-only view of the bytes of a file on disk.  The file
+//                is memory-mapped where the operating system allows it,
+//                otherwise its contents are loaded into a private buffer.
+//
+
+#ifndef _MIDIMEMORYMAP_H_INCLUDED
+#define _MIDIMEMORYMAP_H_INCLUDED
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+namespace smf {
+
+typedef unsigned char  uchar;
+
+class MidiMemoryMap {
+	public:
+		               MidiMemoryMap        (void);
+		               MidiMemoryMap        (const std::string& filename);
+		               MidiMemoryMap        (const MidiMemoryMap& other) = delete;
+
+		              ~MidiMemoryMap        ();
+
+		MidiMemoryMap& operator=            (const MidiMemoryMap& other) = delete;
+
+		bool           open                 (const std::string& filename);
+		void           close                (void);
+		bool           isOpen               (void) const;
+		bool           isMapped             (void) const;
+
+		const uchar*   data                 (void) const;
+		size_t         size                 (void) const;
+
+	protected:
+		// m_data == Start of the file contents (either the mapped pages
+		// or m_buffer.data()).
+		const uchar* m_data = NULL;
+
+		// m_size == Number of bytes in the file.
+		size_t m_size = 0;
+
+		// m_openQ == True if a file is currently attached.
+		bool m_openQ = false;
+
+		// m_mappedQ == True if m_data points to memory-mapped pages
+		// which have to be unmapped when closing.
+		bool m_mappedQ = false;
+
+		// m_buffer == Fallback storage when the file cannot be mapped.
+		std::vector<uchar> m_buffer;
+};
+
+} // end of namespace smf
+
+#endif /* _MIDIMEMORYMAP_H_INCLUDED */
+
+
+
@@ -14,6 +14,8 @@
 #ifndef _MIDIMESSAGE_H_INCLUDED
 #define _MIDIMESSAGE_H_INCLUDED
 
+#include "MidiByteVector.h"
+
 #include <vector>
 #include <string>
 
@@ -23,14 +25,50 @@ typedef unsigned char  uchar;
 typedef unsigned short ushort;
 typedef unsigned long  ulong;
 
-class MidiMessage : public std::vector<uchar> {
+class MidiMessage : public MidiByteVector {
 
 	public:
+		// kinds of messages returned by getKind().  Each message has one
+		// kind, which agrees with the is*() functions below:
+		enum {
+			KIND_OTHER            = 1,   // system or ill-formed message
+			KIND_EMPTY            = 2,
+			KIND_NOTE_OFF         = 3,   // including note-ons of velocity 0
+			KIND_NOTE_ON          = 4,
+			KIND_AFTERTOUCH       = 5,
+			KIND_CONTROLLER       = 6,
+			KIND_PATCH_CHANGE     = 7,
+			KIND_PRESSURE         = 8,
+			KIND_PITCHBEND        = 9,
+			KIND_SYSEX            = 10,
+			KIND_META             = 11,  // meta message of any other type
+			KIND_TEXT             = 12,
+			KIND_COPYRIGHT        = 13,
+			KIND_TRACK_NAME       = 14,
+			KIND_INSTRUMENT_NAME  = 15,
+			KIND_LYRIC            = 16,
+			KIND_MARKER           = 17,
+			KIND_TEMPO            = 18,
+			KIND_TIME_SIGNATURE   = 19,
+			KIND_KEY_SIGNATURE    = 20,
+			KIND_END_OF_TRACK     = 21
+		};
+
+		// sets of kinds, for MidiEventList::findNextKind() and
+		// MidiEventList::getKindIndex():
+		static constexpr unsigned int kindMask(int kind) { return 1u << kind; }
+		enum : unsigned int {
+			KINDS_NOTES   = (1u << KIND_NOTE_ON) | (1u << KIND_NOTE_OFF),
+			KINDS_META    = (1u << (KIND_END_OF_TRACK + 1)) - (1u << KIND_META),
+			KINDS_CHANNEL = (1u << (KIND_PITCHBEND + 1)) - (1u << KIND_NOTE_OFF)
+		};
+
 		               MidiMessage          (void);
 		               MidiMessage          (int command);
 		               MidiMessage          (int command, int p1);
 		               MidiMessage          (int command, int p1, int p2);
 		               MidiMessage          (const MidiMessage& message);
+		               MidiMessage          (MidiMessage&& message) noexcept;
 		               MidiMessage          (const std::vector<uchar>& message);
 		               MidiMessage          (const std::vector<char>& message);
 		               MidiMessage          (const std::vector<int>& message);
@@ -38,6 +76,7 @@ class MidiMessage : public std::vector<uchar> {
 		              ~MidiMessage          ();
 
 		MidiMessage&   operator=            (const MidiMessage& message);
+		MidiMessage&   operator=            (MidiMessage&& message) noexcept;
 		MidiMessage&   operator=            (const std::vector<uchar>& bytes);
 		MidiMessage&   operator=            (const std::vector<char>& bytes);
 		MidiMessage&   operator=            (const std::vector<int>& bytes);
@@ -91,6 +130,8 @@ class MidiMessage : public std::vector<uchar> {
 		void           setMessage           (const std::vector<int>& message);
 
 		// message-type convenience functions:
+		int            getKind              (void) const;
+		void           updateKind           (void);
 		bool           isMetaMessage        (void) const;
 		bool             isMeta             (void) const;
 		bool           isNote               (void) const;
@@ -160,14 +201,49 @@ class MidiMessage : public std::vector<uchar> {
 		bool           isKeySignature       (void) const;
 		bool           isEndOfTrack         (void) const;
 
-		std::string    getMetaContent       (void);
+		std::string    getMetaContent       (void) const;
 		void           setMetaContent       (const std::string& content);
 		void           setTempo             (double tempo);
 		void           setTempoMicroseconds (int microseconds);
 		void           setMetaTempo         (double tempo);
 
+	protected:
+		int            classify             (void) const;
+
 };
 
+//////////////////////////////
+//
+// MidiMessage::getKind -- Return the KIND_* value of the message.  The
+//    bytes are only examined the first time after they are changed.
+//
+
+inline int MidiMessage::getKind(void) const {
+	int kind = getCachedKind();
+	if (kind == 0) {
+		kind = classify();
+		setCachedKind(kind);
+	}
+	return kind;
+}
+
+
+
+//////////////////////////////
+//
+// MidiMessage::updateKind -- Classify the message again after its bytes
+//    have been written through a pointer, reference or iterator from a
+//    non-const accessor (such as data() or operator[]), and let getKind()
+//    cache the kind again.  The bytes must not be changed through such a
+//    pointer after this call.
+//
+
+inline void MidiMessage::updateKind(void) {
+	resetKind();
+	getKind();
+}
+
+
 } // end of namespace smf
 
 #endif /* _MIDIMESSAGE_H_INCLUDED */
@@ -0,0 +1,107 @@
+//
+// Creation Date: Sat Oct 17 10:12:48 JST 2026
+// Last Modified: Sat Oct 17 10:12:48 JST 2026
+// Filename:      midifile/include/MidiNoteTable.h
+// Website:       http://midifile.sapp.org
+// Syntax:        C++11
+// vim:           ts=3 noexpandtab
+//
+// Description:   Table of the notes in a MidiEventList or MidiFile, with
+//                one array per field (start tick, end tick, key, velocity,
+//                channel, track and note-on event index).  Notes are
+//                ordered by start tick, and lists of note indexes (views)
+//                can be selected and sorted without touching the events.
+//
+
+#ifndef _MIDINOTETABLE_H_INCLUDED
+#define _MIDINOTETABLE_H_INCLUDED
+
+#include "MidiEventList.h"
+
+#include <functional>
+#include <vector>
+
+namespace smf {
+
+class MidiFile;
+
+class MidiNoteTable {
+	public:
+		// fields which views can be sorted by:
+		enum {
+			NOTE_START    = 0,
+			NOTE_END      = 1,
+			NOTE_DURATION = 2,
+			NOTE_KEY      = 3,
+			NOTE_VELOCITY = 4,
+			NOTE_CHANNEL  = 5,
+			NOTE_TRACK    = 6
+		};
+
+		               MidiNoteTable        (void);
+		               MidiNoteTable        (const MidiEventList& events);
+		               MidiNoteTable        (const MidiFile& midifile);
+
+		void           build                (const MidiEventList& events);
+		void           build                (const MidiFile& midifile);
+		void           clear                (void);
+
+		int            getNoteCount         (void) const;
+		int            size                 (void) const;
+		bool           empty                (void) const;
+
+		// fields of a note:
+		int            getStartTick         (int index) const;
+		int            getEndTick           (int index) const;
+		int            getTickDuration      (int index) const;
+		int            getKey               (int index) const;
+		int            getVelocity          (int index) const;
+		int            getChannel           (int index) const;
+		int            getTrack             (int index) const;
+		int            getEventIndex        (int index) const;
+		bool           isMatched            (int index) const;
+
+		// whole columns:
+		const std::vector<int>&   getStartTicks  (void) const;
+		const std::vector<int>&   getEndTicks    (void) const;
+		const std::vector<uchar>& getKeys        (void) const;
+		const std::vector<uchar>& getVelocities  (void) const;
+		const std::vector<uchar>& getChannels    (void) const;
+		const std::vector<int>&   getTracks      (void) const;
+		const std::vector<int>&   getEventIndexes(void) const;
+
+		// views:
+		std::vector<int> getAllNotes        (void) const;
+		std::vector<int> getNotesInRange    (int starttick, int endtick) const;
+		std::vector<int> filter             (const std::function<bool(int)>& test) const;
+		std::vector<int> filter             (const std::vector<int>& view,
+		                                     const std::function<bool(int)>& test) const;
+		void           sort                 (std::vector<int>& view, int field,
+		                                     bool descendingQ = false) const;
+
+	protected:
+		void           addNotes             (const MidiEventList& events);
+		void           sortByStart          (void);
+		int            getField             (int index, int field) const;
+
+	private:
+		std::vector<int>   m_start;     // tick of the note-on
+		std::vector<int>   m_end;       // tick of the note-off
+		std::vector<uchar> m_key;
+		std::vector<uchar> m_velocity;  // note-on velocity
+		std::vector<uchar> m_channel;
+		std::vector<int>   m_track;     // MidiEvent::track of the note-on
+		std::vector<int>   m_event;     // index of the note-on in its list
+		std::vector<uchar> m_matched;   // 1 if a note-off was found
+
+		// m_maxDuration == The longest note, used to find the notes which
+		// started before a range but are still sounding in it.
+		int m_maxDuration = 0;
+};
+
+} // end of namespace smf
+
+#endif /* _MIDINOTETABLE_H_INCLUDED */
+
+
+
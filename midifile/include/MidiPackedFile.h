@@ -0,0 +1,98 @@
+//
+// Creation Date: Sat Oct 17 15:02:37 JST 2026
+// Last Modified: Sat Oct 17 15:02:37 JST 2026
+// Filename:      midifile/include/MidiPackedFile.h
+// Website:       http://midifile.sapp.org
+// Syntax:        C++11
+// vim:           ts=3 noexpandtab
+//
+// Description:   Read-only, compact copy of the events of a MIDI file for
+//                keeping many files in memory at once.  Each event takes
+//                12 bytes (absolute tick, up to three message bytes and a
+//                note link); longer messages such as meta and system
+//                exclusive messages are kept in a side table.  Note-ons
+//                and note-offs are paired when the file is packed.
+//
+
+#ifndef _MIDIPACKEDFILE_H_INCLUDED
+#define _MIDIPACKEDFILE_H_INCLUDED
+
+#include "MidiMessage.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace smf {
+
+class MidiFile;
+
+class MidiPackedFile {
+	public:
+		               MidiPackedFile       (void);
+		               MidiPackedFile       (const std::string& filename);
+		               MidiPackedFile       (const MidiFile& midifile);
+
+		bool           read                 (const std::string& filename);
+		void           pack                 (const MidiFile& midifile);
+		void           unpack               (MidiFile& midifile) const;
+		void           clear                (void);
+		bool           status               (void) const;
+		size_t         getMemoryUsage       (void) const;
+
+		int            getTrackCount        (void) const;
+		int            getTicksPerQuarterNote(void) const;
+		int            getTPQ               (void) const;
+		int            getEventCount        (void) const;
+		int            getEventCount        (int track) const;
+
+		// events, by track and index in the track:
+		int            getTick              (int track, int index) const;
+		int            getSize              (int track, int index) const;
+		const uchar*   getBytes             (int track, int index) const;
+		int            getCommandByte       (int track, int index) const;
+		void           getMessage           (int track, int index,
+		                                     MidiMessage& message) const;
+		bool           isNoteOn             (int track, int index) const;
+		bool           isNoteOff            (int track, int index) const;
+		bool           isMeta               (int track, int index) const;
+
+		// note pairs:
+		int            getLinkedIndex       (int track, int index) const;
+		int            getTickDuration      (int track, int index) const;
+
+	protected:
+		// One event.  m_link is the distance to the linked note event
+		// (0 if none) for short messages, and the index of the message in
+		// the side table for long ones.
+		struct PackedEvent {
+			uint32_t m_tick;
+			uchar    m_bytes[3];
+			uchar    m_size;      // LONG_EVENT for messages in the side table
+			int32_t  m_link;
+		};
+		enum { LONG_EVENT = 0xff };
+
+		void           appendEvent          (int tick, const uchar* bytes,
+		                                     int size);
+		void           endTrack             (void);
+		void           linkTrack            (int track);
+		const PackedEvent& getEvent         (int track, int index) const;
+
+	private:
+		std::vector<PackedEvent> m_events;   // events of all tracks in order
+		std::vector<uint32_t>    m_tracks;   // first event of each track, and
+		                                     // the total count at the end
+		std::vector<uchar>       m_long;     // bytes of long messages
+		std::vector<uint32_t>    m_offsets;  // start of each long message in
+		                                     // m_long, and its size at the end
+		int                      m_tpq    = 120;
+		bool                     m_status = false;
+};
+
+} // end of namespace smf
+
+#endif /* _MIDIPACKEDFILE_H_INCLUDED */
+
+
+
@@ -0,0 +1,109 @@
+//
+// Creation Date: Fri Oct 16 19:48:10 JST 2026
+// Last Modified: Fri Oct 16 19:48:10 JST 2026
+// Filename:      midifile/include/MidiProbe.h
+// Website:       http://midifile.sapp.org
+// Syntax:        C++11
+// vim:           ts=3 noexpandtab
+//
+// Description:   Reads the header information of a Standard MIDI File
+//                (type, tracks, track names and sizes, first tempo and
+//                time signature) without storing its events.  Reading
+//                stops as soon as the requested information is found.
+//
+
+#ifndef _MIDIPROBE_H_INCLUDED
+#define _MIDIPROBE_H_INCLUDED
+
+#include <cstddef>
+#include <istream>
+#include <string>
+#include <vector>
+
+namespace smf {
+
+typedef unsigned char  uchar;
+typedef unsigned long  ulong;
+
+class MidiProbe {
+	public:
+		// fields which can be requested from probe() (the header is
+		// always read):
+		enum {
+			PROBE_HEADER         = 0,
+			PROBE_TRACK_SIZES    = 1,
+			PROBE_TRACK_NAMES    = 2,
+			PROBE_TEMPO          = 4,
+			PROBE_TIME_SIGNATURE = 8,
+			PROBE_ALL            = 15
+		};
+
+		               MidiProbe            (void);
+		               MidiProbe            (const std::string& filename,
+		                                     int fields = PROBE_ALL);
+
+		bool           probe                (const std::string& filename,
+		                                     int fields = PROBE_ALL);
+		bool           probe                (std::istream& input,
+		                                     int fields = PROBE_ALL);
+		bool           probe                (const uchar* data, size_t size,
+		                                     int fields = PROBE_ALL);
+		void           clear                (void);
+		bool           status               (void) const;
+
+		// header information:
+		int            getType              (void) const;
+		int            getTrackCount        (void) const;
+		int            getTicksPerQuarterNote(void) const;
+		int            getTPQ               (void) const;
+
+		// track information:
+		ulong          getTrackSize         (int track) const;
+		std::string    getTrackName         (int track) const;
+
+		// first tempo and time signature in the file:
+		bool           hasTempo             (void) const;
+		int            getTempoTick         (void) const;
+		int            getTempoMicroseconds (void) const;
+		double         getTempoBPM          (void) const;
+		bool           hasTimeSignature     (void) const;
+		int            getTimeSignatureTick (void) const;
+		int            getTimeSignatureTop  (void) const;
+		int            getTimeSignatureBottom(void) const;
+
+	protected:
+		bool           readHeader           (const uchar*& ptr, const uchar* end);
+		bool           needTrack            (void) const;
+		bool           needEvent            (int tick, bool nameQ) const;
+		void           scanTrack            (int track, const uchar* data,
+		                                     size_t size);
+		bool           findTrackEnd         (const uchar* data, size_t size,
+		                                     size_t& used);
+
+		int  m_fields  = 0;      // fields requested from probe()
+		bool m_status  = false;  // false after an error or before probing
+		int  m_type    = 0;
+		int  m_tracks  = 0;
+		int  m_tpq     = 120;
+
+		// m_trackSizes == The number of bytes in each MTrk chunk (without
+		// the chunk header).  m_trackNames == The first track name
+		// message at tick 0 in each track.
+		std::vector<ulong>       m_trackSizes;
+		std::vector<std::string> m_trackNames;
+
+		bool m_tempoQ       = false;
+		int  m_tempoTick    = 0;
+		int  m_tempo        = 500000;  // microseconds per quarter note
+		bool m_timeSigQ     = false;
+		int  m_timeSigTick  = 0;
+		int  m_timeSigTop   = 4;
+		int  m_timeSigBottom = 4;
+};
+
+} // end of namespace smf
+
+#endif /* _MIDIPROBE_H_INCLUDED */
+
+
+
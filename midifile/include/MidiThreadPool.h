@@ -0,0 +1,69 @@
+//
+// Creation Date: Fri Oct 16 13:40:02 JST 2026
+// Last Modified: Fri Oct 16 13:40:02 JST 2026
+// Filename:      midifile/include/MidiThreadPool.h
+// Website:       http://midifile.sapp.org
+// Syntax:        C++11
+// vim:           ts=3 noexpandtab
+//
+// Description:   A small pool of worker threads used by the MidiFile
+//                class to process independent tracks concurrently.
+//
+
+#ifndef _MIDITHREADPOOL_H_INCLUDED
+#define _MIDITHREADPOOL_H_INCLUDED
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace smf {
+
+class MidiThreadPool {
+	public:
+		                MidiThreadPool      (int threads = 0);
+		                MidiThreadPool      (const MidiThreadPool& other) = delete;
+
+		               ~MidiThreadPool      ();
+
+		MidiThreadPool& operator=           (const MidiThreadPool& other) = delete;
+
+		int             getThreadCount      (void) const;
+		void            run                 (int count,
+		                                     const std::function<void(int)>& task,
+		                                     int maxthreads = 0);
+
+		static MidiThreadPool& getSharedPool(void);
+		static int      getHardwareThreads  (void);
+
+	protected:
+		void            workerLoop          (void);
+
+		// m_workers == Threads waiting for tasks.  The thread calling run()
+		// also processes tasks, so a pool for N threads has N-1 workers.
+		std::vector<std::thread> m_workers;
+
+		// Synchronization for the current job:
+		std::mutex               m_runMutex;   // one job at a time
+		std::mutex               m_mutex;      // protects variables below
+		std::condition_variable  m_wake;       // workers wait for a job
+		std::condition_variable  m_done;       // run() waits for workers
+
+		const std::function<void(int)>* m_task = NULL;
+		int                      m_count      = 0;
+		std::atomic<int>         m_next;
+		int                      m_helpers    = 0;  // workers still allowed to join
+		int                      m_busy       = 0;  // workers inside the job
+		unsigned long            m_generation = 0;
+		bool                     m_stop       = false;
+};
+
+} // end of namespace smf
+
+#endif /* _MIDITHREADPOOL_H_INCLUDED */
+
+
+
@@ -0,0 +1,81 @@
+//
+// Creation Date: Sat Oct 17 17:52:08 JST 2026
+// Last Modified: Sat Oct 17 17:52:08 JST 2026
+// Filename:      midifile/include/MidiTimeline.h
+// Website:       http://midifile.sapp.org
+// Syntax:        C++11
+// vim:           ts=3 noexpandtab
+//
+// Description:   Read-only view of the events of all tracks of a MidiFile
+//                in time order.  The tracks are merged one event at a time
+//                with a small heap that holds the next event of each track,
+//                so the MidiFile is never joined, sorted or changed to
+//                absolute ticks, and several timelines can read the same
+//                file at once.  The time of each event in seconds is
+//                calculated from the tempo messages on the way.
+//
+
+#ifndef _MIDITIMELINE_H_INCLUDED
+#define _MIDITIMELINE_H_INCLUDED
+
+#include "MidiEvent.h"
+
+#include <vector>
+
+namespace smf {
+
+class MidiFile;
+
+class MidiTimeline {
+	public:
+		               MidiTimeline         (void);
+		               MidiTimeline         (const MidiFile& midifile);
+
+		void           open                 (const MidiFile& midifile);
+		void           rewind               (void);
+
+		// event iteration:
+		bool           next                 (void);
+		const MidiEvent& getEvent           (void) const;
+		int            getTrack             (void) const;
+		int            getIndex             (void) const;
+		int            getTick              (void) const;
+		double         getSeconds           (void) const;
+		double         getSecondsPerTick    (void) const;
+
+	protected:
+		void           siftDown             (int index);
+
+	private:
+		// One entry for each track with events left: the absolute tick of
+		// its next event.  The heap keeps the entry with the smallest tick
+		// (and then the lowest track) on top.
+		struct HeapItem {
+			int tick;
+			int track;
+		};
+
+		const MidiFile*       m_file   = NULL;
+		bool                  m_deltaQ = false;  // file is in delta ticks
+		std::vector<HeapItem> m_heap;
+		std::vector<int>      m_next;            // next index in each track
+
+		// current event:
+		int    m_track   = -1;
+		int    m_index   = -1;
+		int    m_tick    = 0;
+
+		// time in seconds at the current tick, and the tempo segment
+		// which it is in:
+		double m_seconds = 0.0;
+		double m_secondsPerTick = 0.0;
+		int    m_segmentTick = 0;
+		double m_segmentSeconds = 0.0;
+};
+
+} // end of namespace smf
+
+#endif /* _MIDITIMELINE_H_INCLUDED */
+
+
+
@@ -0,0 +1,73 @@
+//
+// Creation Date: Fri Oct 16 09:12:40 JST 2026
+// Last Modified: Fri Oct 16 09:12:40 JST 2026
+// Filename:      midifile/include/MidiTrackDecoder.h
+// Website:       http://midifile.sapp.org
+// Syntax:        C++11
+// vim:           ts=3 noexpandtab
+//
+// Description:   Decodes the events of an MTrk chunk directly from a
+//                block of memory, one event at a time, without copying
+//                the message bytes.
+//
+
+#ifndef _MIDITRACKDECODER_H_INCLUDED
+#define _MIDITRACKDECODER_H_INCLUDED
+
+#include <cstddef>
+
+namespace smf {
+
+typedef unsigned char  uchar;
+typedef unsigned long  ulong;
+
+class MidiTrackDecoder {
+	public:
+		               MidiTrackDecoder     (void);
+		               MidiTrackDecoder     (const uchar* data, size_t size);
+
+		void           setData              (const uchar* data, size_t size);
+		void           continueData         (const uchar* data, size_t size);
+		void           clearRunningStatus   (void);
+
+		// decoding functions (next() returns 1 when an event was decoded,
+		// 0 when the remaining data ends in the middle of an event, or
+		// -1 if the data is not valid MIDI track content):
+		int            next                 (void);
+		size_t         getOffset            (void) const;
+		const char*    getError             (void) const;
+
+		// access to the most recently decoded event:
+		ulong          getDeltaTick         (void) const;
+		int            getCommandByte       (void) const;
+		const uchar*   getPayload           (void) const;
+		int            getPayloadSize       (void) const;
+		int            getMessageSize       (void) const;
+		void           copyMessage          (uchar* output) const;
+		bool           isMeta               (void) const;
+		int            getMetaType          (void) const;
+		const uchar*   getMetaContent       (void) const;
+		int            getMetaContentSize   (void) const;
+		bool           isEndOfTrack         (void) const;
+
+	protected:
+		const uchar*   m_data    = NULL;   // start of the track data
+		size_t         m_size    = 0;      // number of bytes in m_data
+		size_t         m_offset  = 0;      // offset of next undecoded event
+		uchar          m_running = 0;      // running status command byte
+		const char*    m_error   = "";     // description of last error
+
+		// most recently decoded event:
+		ulong          m_delta   = 0;
+		uchar          m_command = 0;
+		const uchar*   m_payload = NULL;
+		int            m_length  = 0;
+		int            m_metaSkip = 0;     // meta type + length VLV bytes
+};
+
+} // end of namespace smf
+
+#endif /* _MIDITRACKDECODER_H_INCLUDED */
+
+
+
@@ -0,0 +1,51 @@
+//
+// Creation Date: Fri Oct 16 17:12:48 JST 2026
+// Last Modified: Fri Oct 16 17:12:48 JST 2026
+// Filename:      midifile/include/MidiVlv.h
+// Website:       http://midifile.sapp.org
+// Syntax:        C++11
+// vim:           ts=3 noexpandtab
+//
+// Description:   Conversion between integers and MIDI Variable Length
+//                Values stored in byte buffers.
+//
+
+#ifndef _MIDIVLV_H_INCLUDED
+#define _MIDIVLV_H_INCLUDED
+
+#include <cstddef>
+
+namespace smf {
+
+typedef unsigned char  uchar;
+typedef unsigned long  ulong;
+
+class MidiVlv {
+	public:
+		// decoding functions (return the number of bytes read, 0 if the
+		// data ends before the last byte of the value, or -1 if the value
+		// is longer than maxbytes):
+		static int     decode               (const uchar* data, size_t size,
+		                                     ulong& value, int maxbytes = 5);
+		static int     decodeMany           (const uchar* data, size_t size,
+		                                     ulong* values, int count,
+		                                     size_t& used, int maxbytes = 5);
+
+		// encoding functions (values must be less than 2^35):
+		static int     getEncodedSize       (ulong value);
+		static int     encode               (ulong value, uchar* buffer);
+		static size_t  encodeMany           (const ulong* values, int count,
+		                                     uchar* buffer);
+
+	protected:
+		static int     decodeBytewise       (const uchar* data, size_t size,
+		                                     ulong& value, int maxbytes);
+		static int     encodeBytewise       (ulong value, uchar* buffer);
+};
+
+} // end of namespace smf
+
+#endif /* _MIDIVLV_H_INCLUDED */
+
+
+
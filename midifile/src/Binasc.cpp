@@ -280,6 +280,21 @@ int Binasc::writeToBinary(std::ostream& out, std::istream& input) {
 
 
 
+//////////////////////////////
+//
+// Binasc::writeLineToBinary -- Convert a single line of ASCII content
+//     into bytes, such as when the bytes are used while the input is
+//     being read.  The line number is used in error messages.  Returns
+//     0 if there was a problem otherwise returns 1.
+//
+
+int Binasc::writeLineToBinary(std::ostream& out, const std::string& line,
+		int lineNum) {
+	return processLine(out, line, lineNum);
+}
+
+
+
 //////////////////////////////
 //
 // Binasc::readFromBinary -- convert an ASCII representation of bytes into
@@ -524,6 +539,10 @@ int Binasc::processLine(std::ostream& out, const std::string& input,
 			// ignore whitespace
 			i++;
 			continue;
+		} else if ((status = processSimpleWord(out, input, i)) > 0) {
+			// hex byte, small decimal byte or delta time
+			i = status;
+			continue;
 		} else if (input[i] == '+') {
 			i = getWord(word, input, " \n\t", i);
 			status = processAsciiWord(out, word, lineCount);
@@ -562,6 +581,75 @@ int Binasc::processLine(std::ostream& out, const std::string& input,
 
 
 
+//////////////////////////////
+//
+// Binasc::processSimpleWord -- Convert the most common words in binasc
+//     MIDI files without copying them: one or two hex digits ("9f"), a
+//     one-byte decimal number without a sign ("'64"), and a VLV with at
+//     most nine digits ("v480").  The output is the same as from the
+//     general functions.  Returns the index after the word, or 0 if the
+//     word at the index is not one of these forms.
+//
+
+int Binasc::processSimpleWord(std::ostream& out, const std::string& input,
+		int index) {
+	int length = (int)input.size();
+	int i = index;
+	char first = input[i];
+	if ((first == '\'') || (first == 'v')) {
+		i++;
+	}
+	ulong value = 0;
+	int digits = 0;
+	while ((i < length) && (digits < 10)) {
+		char ch = input[i];
+		int digit;
+		if ((ch >= '0') && (ch <= '9')) {
+			digit = ch - '0';
+		} else if ((first != '\'') && (first != 'v') &&
+				(((ch >= 'a') && (ch <= 'f')) || ((ch >= 'A') && (ch <= 'F')))) {
+			digit = (ch & 0x0f) + 9;
+		} else {
+			break;
+		}
+		value = value * ((first == '\'') || (first == 'v') ? 10 : 16) + digit;
+		digits++;
+		i++;
+	}
+	if ((i < length) && (input[i] != ' ') && (input[i] != '\t') &&
+			(input[i] != '\n')) {
+		return 0;
+	}
+
+	if (first == 'v') {
+		if ((digits == 0) || (digits > 9)) {
+			return 0;
+		}
+		uchar bytes[5];
+		int size = 0;
+		for (int shift=28; shift>0; shift-=7) {
+			if ((value >> shift) || size) {
+				bytes[size++] = (uchar)(((value >> shift) & 0x7f) | 0x80);
+			}
+		}
+		bytes[size++] = (uchar)(value & 0x7f);
+		out.write((const char*)bytes, size);
+	} else if (first == '\'') {
+		if ((digits == 0) || (digits > 3) || (value > 255)) {
+			return 0;
+		}
+		out.put((char)value);
+	} else {
+		if ((digits == 0) || (digits > 2)) {
+			return 0;
+		}
+		out.put((char)value);
+	}
+	return i;
+}
+
+
+
 //////////////////////////////
 //
 // Binasc::getWord -- extract a sub string, stopping at any of the given
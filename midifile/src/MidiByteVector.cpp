@@ -0,0 +1,331 @@
+//
+// Creation Date: Sat Oct 17 09:05:22 JST 2026
+// Last Modified: Sat Oct 17 09:05:22 JST 2026
+// Filename:      midifile/src/MidiByteVector.cpp
+// Website:       http://midifile.sapp.org
+// Syntax:        C++11
+// vim:           ts=3 noexpandtab
+//
+// Description:   Byte storage for MidiMessage with the interface of
+//                std::vector<uchar>.  Messages of up to 16 bytes (all
+//                channel messages and most meta messages) are stored
+//                inside the object; only longer system exclusive and meta
+//                messages use memory on the heap.
+//
+
+#include "MidiByteVector.h"
+
+#include <algorithm>
+#include <utility>
+
+
+namespace smf {
+
+//////////////////////////////
+//
+// MidiByteVector::MidiByteVector -- Constructor.
+//
+
+MidiByteVector::MidiByteVector(void) {
+	// do nothing
+}
+
+
+MidiByteVector::MidiByteVector(size_t count, uchar value) {
+	resize(count, value);
+}
+
+
+MidiByteVector::MidiByteVector(const MidiByteVector& other) {
+	assign(other.begin(), other.end());
+	setCachedKind(other.getCachedKind());
+}
+
+
+MidiByteVector::MidiByteVector(MidiByteVector&& other) noexcept {
+	swap(other);
+}
+
+
+
+//////////////////////////////
+//
+// MidiByteVector::~MidiByteVector -- Deconstructor.
+//
+
+MidiByteVector::~MidiByteVector() {
+	if (!isLocal()) {
+		delete [] m_heap;
+	}
+}
+
+
+
+//////////////////////////////
+//
+// MidiByteVector::operator= --
+//
+
+MidiByteVector& MidiByteVector::operator=(const MidiByteVector& other) {
+	if (this != &other) {
+		assign(other.begin(), other.end());
+		setCachedKind(other.getCachedKind());
+	}
+	return *this;
+}
+
+
+MidiByteVector& MidiByteVector::operator=(MidiByteVector&& other) noexcept {
+	swap(other);
+	return *this;
+}
+
+
+
+//////////////////////////////
+//
+// MidiByteVector::reserve -- Make room for at least the given number of
+//    bytes.
+//
+
+void MidiByteVector::reserve(size_t count) {
+	if (count > m_capacity) {
+		grow(count);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// MidiByteVector::shrink_to_fit -- Move the bytes back inside the object
+//    if they fit, or into a heap buffer of the exact size.
+//
+
+void MidiByteVector::shrink_to_fit(void) {
+	if (isLocal() || (m_size == m_capacity)) {
+		return;
+	}
+	uchar* old = m_heap;
+	if (m_size <= LOCAL_CAPACITY) {
+		memcpy(m_local, old, m_size);
+		m_capacity = LOCAL_CAPACITY;
+	} else {
+		m_heap = new uchar[m_size];
+		memcpy(m_heap, old, m_size);
+		m_capacity = m_size;
+	}
+	delete [] old;
+}
+
+
+
+//////////////////////////////
+//
+// MidiByteVector::swap -- Exchange the contents of two vectors.
+//
+
+void MidiByteVector::swap(MidiByteVector& other) noexcept {
+	// The storage is plain bytes, so it can be exchanged without caring
+	// where the bytes are stored.  (The whole object cannot be copied,
+	// since a derived class may keep members in its padding.)
+	uchar temp[LOCAL_CAPACITY];
+	memcpy(temp, m_local, LOCAL_CAPACITY);
+	memcpy(m_local, other.m_local, LOCAL_CAPACITY);
+	memcpy(other.m_local, temp, LOCAL_CAPACITY);
+	std::swap(m_size, other.m_size);
+	std::swap(m_capacity, other.m_capacity);
+	// Writable pointers follow bytes on the heap to the other vector, but
+	// stay with bytes stored inside the object, so the caching stays
+	// stopped for both vectors if it was stopped for either.
+	uchar kind = m_kind.load(std::memory_order_relaxed);
+	uchar otherkind = other.m_kind.load(std::memory_order_relaxed);
+	if ((kind == KIND_UNCACHED) || (otherkind == KIND_UNCACHED)) {
+		kind = otherkind = KIND_UNCACHED;
+	}
+	m_kind.store(otherkind, std::memory_order_relaxed);
+	other.m_kind.store(kind, std::memory_order_relaxed);
+}
+
+
+
+//////////////////////////////
+//
+// MidiByteVector::assign -- Replace the contents.
+//
+
+void MidiByteVector::assign(size_t count, uchar value) {
+	m_size = 0;
+	resize(count, value);
+	resetKind();
+}
+
+
+void MidiByteVector::assign(const uchar* first, const uchar* last) {
+	size_t count = last - first;
+	if (count > m_capacity) {
+		m_size = 0;
+		grow(count);
+	}
+	if (count > 0) {
+		memmove(storage(), first, count);
+	}
+	m_size = (uint32_t)count;
+	resetKind();
+}
+
+
+
+//////////////////////////////
+//
+// MidiByteVector::insert -- Insert bytes before pos, and return the
+//    position of the first inserted byte.
+//
+
+MidiByteVector::iterator MidiByteVector::insert(const_iterator pos,
+		uchar value) {
+	uchar* gap = makeGap(pos - begin(), 1);
+	*gap = value;
+	return gap;
+}
+
+
+MidiByteVector::iterator MidiByteVector::insert(const_iterator pos,
+		size_t count, uchar value) {
+	uchar* gap = makeGap(pos - begin(), count);
+	memset(gap, value, count);
+	return gap;
+}
+
+
+MidiByteVector::iterator MidiByteVector::insert(const_iterator pos,
+		const uchar* first, const uchar* last) {
+	size_t count = last - first;
+	if ((first >= begin()) && (first < end())) {
+		// inserting bytes of this vector
+		std::vector<uchar> copy(first, last);
+		return insert(pos, copy.data(), copy.data() + count);
+	}
+	uchar* gap = makeGap(pos - begin(), count);
+	if (count > 0) {
+		memcpy(gap, first, count);
+	}
+	return gap;
+}
+
+
+
+//////////////////////////////
+//
+// MidiByteVector::erase -- Remove bytes, and return the position of the
+//    byte after them.
+//
+
+MidiByteVector::iterator MidiByteVector::erase(const_iterator pos) {
+	return erase(pos, pos + 1);
+}
+
+
+MidiByteVector::iterator MidiByteVector::erase(const_iterator first,
+		const_iterator last) {
+	size_t index = first - begin();
+	size_t count = last - first;
+	uchar* bytes = data();
+	memmove(bytes + index, bytes + index + count, m_size - index - count);
+	m_size -= (uint32_t)count;
+	return bytes + index;
+}
+
+
+
+//////////////////////////////
+//
+// MidiByteVector::operator std::vector<uchar> -- Copy the bytes into a
+//    std::vector.
+//
+
+MidiByteVector::operator std::vector<uchar>(void) const {
+	return std::vector<uchar>(begin(), end());
+}
+
+
+///////////////////////////////////////////////////////////////////////////
+//
+// protected functions --
+//
+
+//////////////////////////////
+//
+// MidiByteVector::makeGap -- Open count bytes of space at index, and
+//    return a pointer to them.
+//
+
+uchar* MidiByteVector::makeGap(size_t index, size_t count) {
+	if (m_size + count > m_capacity) {
+		grow(m_size + count);
+	}
+	uchar* bytes = data();
+	memmove(bytes + index + count, bytes + index, m_size - index);
+	m_size += (uint32_t)count;
+	return bytes + index;
+}
+
+
+
+//////////////////////////////
+//
+// MidiByteVector::grow -- Move the bytes to a heap buffer which can hold
+//    at least count bytes.
+//
+
+void MidiByteVector::grow(size_t count) {
+	size_t capacity = std::max(count, (size_t)m_capacity * 2);
+	uchar* bytes = new uchar[capacity];
+	memcpy(bytes, storage(), m_size);
+	if (!isLocal()) {
+		delete [] m_heap;
+	}
+	m_heap = bytes;
+	m_capacity = (uint32_t)capacity;
+}
+
+
+
+//////////////////////////////
+//
+// operator== -- Compare the bytes of two vectors.
+//
+
+bool operator==(const MidiByteVector& a, const MidiByteVector& b) {
+	return (a.size() == b.size()) &&
+			(memcmp(a.data(), b.data(), a.size()) == 0);
+}
+
+
+
+//////////////////////////////
+//
+// operator!= --
+//
+
+bool operator!=(const MidiByteVector& a, const MidiByteVector& b) {
+	return !(a == b);
+}
+
+
+
+//////////////////////////////
+//
+// operator< -- Compare the bytes of two vectors in lexicographical order.
+//
+
+bool operator<(const MidiByteVector& a, const MidiByteVector& b) {
+	return std::lexicographical_compare(a.begin(), a.end(), b.begin(),
+			b.end());
+}
+
+
+} // end of namespace smf
+
+
+
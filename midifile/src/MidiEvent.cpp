@@ -14,6 +14,7 @@
 #include "MidiEvent.h"
 
 #include <stdlib.h>
+#include <utility>
 
 
 namespace smf {
@@ -44,7 +45,18 @@ MidiEvent::MidiEvent(int command, int p1, int p2)
 }
 
 
-MidiEvent::MidiEvent(int aTime, int aTrack, vector<uchar>& message)
+MidiEvent::MidiEvent(const MidiMessage& message) : MidiMessage(message) {
+	clearVariables();
+}
+
+
+MidiEvent::MidiEvent(MidiMessage&& message)
+		: MidiMessage(std::move(message)) {
+	clearVariables();
+}
+
+
+MidiEvent::MidiEvent(int aTime, int aTrack, std::vector<uchar>& message)
 		: MidiMessage(message) {
 	track       = aTrack;
 	tick        = aTime;
@@ -54,17 +66,27 @@ MidiEvent::MidiEvent(int aTime, int aTrack, vector<uchar>& message)
 }
 
 
-MidiEvent::MidiEvent(const MidiEvent& mfevent) : MidiMessage() {
+MidiEvent::MidiEvent(const MidiEvent& mfevent) : MidiMessage(mfevent) {
 	track   = mfevent.track;
 	tick    = mfevent.tick;
 	seconds = mfevent.seconds;
 	seq     = mfevent.seq;
 	m_eventlink = NULL;
+}
 
-	this->resize(mfevent.size());
-	for (int i=0; i<(int)this->size(); i++) {
-		(*this)[i] = mfevent[i];
-	}
+
+//
+// Move constructor: the bytes are taken from mfevent.  As with copies, the
+// new event is not linked.
+//
+
+MidiEvent::MidiEvent(MidiEvent&& mfevent)
+		: MidiMessage(std::move(mfevent)) {
+	track   = mfevent.track;
+	tick    = mfevent.tick;
+	seconds = mfevent.seconds;
+	seq     = mfevent.seq;
+	m_eventlink = NULL;
 }
 
 
@@ -112,10 +134,21 @@ MidiEvent& MidiEvent::operator=(const MidiEvent& mfevent) {
 	seconds = mfevent.seconds;
 	seq     = mfevent.seq;
 	m_eventlink = NULL;
-	this->resize(mfevent.size());
-	for (int i=0; i<(int)this->size(); i++) {
-		(*this)[i] = mfevent[i];
+	MidiMessage::operator=(mfevent);
+	return *this;
+}
+
+
+MidiEvent& MidiEvent::operator=(MidiEvent&& mfevent) {
+	if (this == &mfevent) {
+		return *this;
 	}
+	tick    = mfevent.tick;
+	track   = mfevent.track;
+	seconds = mfevent.seconds;
+	seq     = mfevent.seq;
+	m_eventlink = NULL;
+	MidiMessage::operator=(std::move(mfevent));
 	return *this;
 }
 
@@ -125,15 +158,22 @@ MidiEvent& MidiEvent::operator=(const MidiMessage& message) {
 		return *this;
 	}
 	clearVariables();
-	this->resize(message.size());
-	for (int i=0; i<(int)this->size(); i++) {
-		(*this)[i] = message[i];
+	MidiMessage::operator=(message);
+	return *this;
+}
+
+
+MidiEvent& MidiEvent::operator=(MidiMessage&& message) {
+	if (this == &message) {
+		return *this;
 	}
+	clearVariables();
+	MidiMessage::operator=(std::move(message));
 	return *this;
 }
 
 
-MidiEvent& MidiEvent::operator=(const vector<uchar>& bytes) {
+MidiEvent& MidiEvent::operator=(const std::vector<uchar>& bytes) {
 	clearVariables();
 	this->resize(bytes.size());
 	for (int i=0; i<(int)this->size(); i++) {
@@ -143,14 +183,14 @@ MidiEvent& MidiEvent::operator=(const vector<uchar>& bytes) {
 }
 
 
-MidiEvent& MidiEvent::operator=(const vector<char>& bytes) {
+MidiEvent& MidiEvent::operator=(const std::vector<char>& bytes) {
 	clearVariables();
 	setMessage(bytes);
 	return *this;
 }
 
 
-MidiEvent& MidiEvent::operator=(const vector<int>& bytes) {
+MidiEvent& MidiEvent::operator=(const std::vector<int>& bytes) {
 	clearVariables();
 	setMessage(bytes);
 	return *this;
@@ -0,0 +1,175 @@
+//
+// Creation Date: Fri Oct 16 20:41:37 JST 2026
+// Last Modified: Fri Oct 16 20:41:37 JST 2026
+// Filename:      midifile/src/MidiEventArena.cpp
+// Website:       http://midifile.sapp.org
+// Syntax:        C++11
+// vim:           ts=3 noexpandtab
+//
+// Description:   Allocates MidiEvents in large blocks instead of one at
+//                a time.  The events are still deleted one at a time
+//                with deleteEvent(), which destroys the event and
+//                decrements the atomic count of its block.  A block is
+//                freed when the last of its events has been deleted, so
+//                the events can outlive the arena.
+//
+
+#include "MidiEventArena.h"
+
+#include <atomic>
+#include <new>
+
+
+namespace smf {
+
+// Block sizes (in events).  Blocks start small so that short tracks do
+// not waste memory, and double in size up to the maximum.
+#define ARENA_FIRST_BLOCK  32
+#define ARENA_LARGEST_BLOCK 8192
+
+// Header at the start of each block, followed by the events.  The
+// reference count is the number of live events in the block, plus one
+// while the arena is still placing events in it.  Events may be deleted
+// on any thread, so the count is atomic.
+class _ArenaBlock {
+	public:
+		std::atomic<int> references;
+};
+
+// Offset of the first event in a block:
+static const size_t ArenaHeaderSize = (sizeof(_ArenaBlock) + alignof(MidiEvent)
+		- 1) / alignof(MidiEvent) * alignof(MidiEvent);
+
+
+//////////////////////////////
+//
+// MidiEventArena::MidiEventArena -- Constructor.
+//
+
+MidiEventArena::MidiEventArena(void) {
+	// do nothing
+}
+
+
+
+//////////////////////////////
+//
+// MidiEventArena::~MidiEventArena -- Deconstructor.  Blocks which still
+//    contain events are freed when their last event is deleted.
+//
+
+MidiEventArena::~MidiEventArena() {
+	if (m_block != NULL) {
+		releaseBlock(m_block);
+		m_block = NULL;
+	}
+}
+
+
+
+//////////////////////////////
+//
+// MidiEventArena::newEvent -- Return an empty MidiEvent placed in the
+//    current block.  The event has to be deleted with deleteEvent()
+//    (MidiEventList does this for the events which it holds).  An arena
+//    may only be used by one thread at a time.
+//
+
+MidiEvent* MidiEventArena::newEvent(void) {
+	if (m_used >= m_capacity) {
+		startBlock();
+	}
+	_ArenaBlock* header = (_ArenaBlock*)m_block;
+	header->references.fetch_add(1, std::memory_order_relaxed);
+	void* slot = m_block + ArenaHeaderSize + (size_t)m_used * sizeof(MidiEvent);
+	m_used++;
+	MidiEvent* event = ::new (slot) MidiEvent;
+	event->m_arenablock = m_block;
+	return event;
+}
+
+
+
+//////////////////////////////
+//
+// MidiEventArena::deleteEvent -- Delete an event allocated either by an
+//    arena or with new.
+//
+
+void MidiEventArena::deleteEvent(MidiEvent* event) {
+	if (event == NULL) {
+		return;
+	}
+	void* block = event->m_arenablock;
+	if (block == NULL) {
+		delete event;
+		return;
+	}
+	event->~MidiEvent();
+	releaseBlock(block);
+}
+
+
+
+//////////////////////////////
+//
+// MidiEventArena::getBlockCount -- Return the number of blocks which
+//    the arena has allocated.
+//
+
+int MidiEventArena::getBlockCount(void) const {
+	return m_blocks;
+}
+
+
+///////////////////////////////////////////////////////////////////////////
+//
+// protected functions --
+//
+
+//////////////////////////////
+//
+// MidiEventArena::startBlock -- Allocate the next block and release the
+//    arena's reference to the previous one.
+//
+
+void MidiEventArena::startBlock(void) {
+	int capacity = m_capacity == 0 ? ARENA_FIRST_BLOCK : m_capacity * 2;
+	if (capacity > ARENA_LARGEST_BLOCK) {
+		capacity = ARENA_LARGEST_BLOCK;
+	}
+	char* block = (char*)::operator new(ArenaHeaderSize +
+			(size_t)capacity * sizeof(MidiEvent));
+	::new (block) _ArenaBlock;
+	((_ArenaBlock*)block)->references.store(1, std::memory_order_relaxed);
+
+	if (m_block != NULL) {
+		releaseBlock(m_block);
+	}
+	m_block = block;
+	m_used = 0;
+	m_capacity = capacity;
+	m_blocks++;
+}
+
+
+
+//////////////////////////////
+//
+// MidiEventArena::releaseBlock -- Drop one reference to a block, and free
+//    the block when no references are left.
+//
+
+void MidiEventArena::releaseBlock(void* block) {
+	_ArenaBlock* header = (_ArenaBlock*)block;
+	if (header->references.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+		header->~_ArenaBlock();
+		::operator delete(block);
+	}
+}
+
+
+} // end of namespace smf
+
+
+
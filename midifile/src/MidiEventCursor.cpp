@@ -0,0 +1,549 @@
+//
+// Creation Date: Fri Oct 16 16:05:31 JST 2026
+// Last Modified: Fri Oct 16 16:05:31 JST 2026
+// Filename:      midifile/src/MidiEventCursor.cpp
+// Website:       http://midifile.sapp.org
+// Syntax:        C++11
+// vim:           ts=3 noexpandtab
+//
+// Description:   Reads the events of a Standard MIDI File one at a time
+//                in file order, without storing them in a MidiFile.
+//                Memory use does not depend on the size of the file.
+//
+
+#include "MidiEventCursor.h"
+#include "Binasc.h"
+
+#include <algorithm>
+#include <iostream>
+#include <string.h>
+
+
+namespace smf {
+
+// Initial size of the input window.
+#define CURSOR_BUFFER_SIZE 65536
+
+
+//////////////////////////////
+//
+// MidiEventCursor::MidiEventCursor -- Constructor.
+//
+
+MidiEventCursor::MidiEventCursor(void) {
+	// do nothing
+}
+
+
+MidiEventCursor::MidiEventCursor(const std::string& filename) {
+	open(filename);
+}
+
+
+MidiEventCursor::MidiEventCursor(std::istream& input) {
+	open(input);
+}
+
+
+
+//////////////////////////////
+//
+// MidiEventCursor::~MidiEventCursor -- Deconstructor.
+//
+
+MidiEventCursor::~MidiEventCursor() {
+	close();
+}
+
+
+
+//////////////////////////////
+//
+// MidiEventCursor::open -- Open a MIDI file and read its header.  The
+//    first event is available after calling next().  Returns false if
+//    the file cannot be read.
+//
+
+bool MidiEventCursor::open(const std::string& filename) {
+	close();
+	m_file.open(filename.c_str(), std::ios::binary | std::ios::in);
+	if (!m_file.is_open()) {
+		return false;
+	}
+	return open(m_file);
+}
+
+//
+// istream version of open().  The stream must remain valid until the
+// cursor is closed.  Binasc content is converted to binary in memory
+// before iterating.
+//
+
+bool MidiEventCursor::open(std::istream& input) {
+	if (&input != &m_file) {
+		close();
+	}
+	m_input = &input;
+	if (input.peek() != 'M') {
+		Binasc binasc;
+		binasc.writeToBinary(m_binary, input);
+		m_binary.seekg(0, std::ios_base::beg);
+		m_input = &m_binary;
+	}
+	m_buffer.resize(CURSOR_BUFFER_SIZE);
+	m_status = readHeader();
+	return m_status;
+}
+
+
+
+//////////////////////////////
+//
+// MidiEventCursor::close -- Release the input and the buffer.
+//
+
+void MidiEventCursor::close(void) {
+	if (m_file.is_open()) {
+		m_file.close();
+	}
+	m_file.clear();
+	m_binary.str("");
+	m_binary.clear();
+	m_input    = NULL;
+	m_buffer.clear();
+	m_buffer.shrink_to_fit();
+	m_tempos.clear();
+	m_trackTempos = 0;
+	m_begin    = 0;
+	m_end      = 0;
+	m_consumed = 0;
+	m_type     = 0;
+	m_tracks   = 0;
+	m_tpq      = 120;
+	m_track    = -1;
+	m_tick     = 0;
+	m_inTrackQ = false;
+	m_eventQ   = false;
+	m_status   = false;
+}
+
+
+
+//////////////////////////////
+//
+// MidiEventCursor::status -- Returns false if the input could not be
+//    opened or contains an error.
+//
+
+bool MidiEventCursor::status(void) const {
+	return m_status;
+}
+
+
+
+//////////////////////////////
+//
+// MidiEventCursor::getType -- Return the MIDI file type (0 or 1).
+//
+
+int MidiEventCursor::getType(void) const {
+	return m_type;
+}
+
+
+
+//////////////////////////////
+//
+// MidiEventCursor::getTrackCount -- Return the number of tracks given in
+//    the header.
+//
+
+int MidiEventCursor::getTrackCount(void) const {
+	return m_tracks;
+}
+
+
+
+//////////////////////////////
+//
+// MidiEventCursor::getTicksPerQuarterNote -- Return the ticks per quarter
+//    note from the header (calculated in the same way as in MidiFile).
+//
+
+int MidiEventCursor::getTicksPerQuarterNote(void) const {
+	return m_tpq;
+}
+
+//
+// Alias for getTicksPerQuarterNote:
+//
+
+int MidiEventCursor::getTPQ(void) const {
+	return getTicksPerQuarterNote();
+}
+
+
+
+//////////////////////////////
+//
+// MidiEventCursor::next -- Move to the next event in the file.  Events
+//    are returned track by track in the order in which they are stored,
+//    including the end-of-track message of each track.  Returns false
+//    at the end of the file or if there was an error (check status()).
+//    The payload of the previous event is no longer valid after calling
+//    this function.
+//
+
+bool MidiEventCursor::next(void) {
+	m_eventQ = false;
+	if (!m_status) {
+		return false;
+	}
+	m_begin += m_consumed;
+	m_consumed = 0;
+
+	if (!m_inTrackQ) {
+		if (m_track + 1 >= m_tracks) {
+			return false;
+		}
+		if (!fill(8)) {
+			std::cerr << "Error: unexpected end of file." << std::endl;
+			m_status = false;
+			return false;
+		}
+		const uchar* header = m_buffer.data() + m_begin;
+		if (memcmp(header, "MTrk", 4) != 0) {
+			std::cerr << "Error: expecting MTrk chunk for track "
+			          << m_track + 1 << std::endl;
+			m_status = false;
+			return false;
+		}
+		// The chunk size is ignored since the track must end with an
+		// end-of-track message (as in MidiFile::read()).
+		m_begin += 8;
+		m_track++;
+		m_tick = 0;
+		m_inTrackQ = true;
+		m_decoder.clearRunningStatus();
+	}
+
+	while (1) {
+		size_t available = m_end - m_begin;
+		m_decoder.continueData(m_buffer.data() + m_begin, available);
+		int dstatus = m_decoder.next();
+		if (dstatus > 0) {
+			break;
+		}
+		if ((dstatus < 0) || !fill(available + 1)) {
+			std::cerr << "Error: " << m_decoder.getError() << std::endl;
+			m_status = false;
+			return false;
+		}
+	}
+
+	m_consumed = m_decoder.getOffset();
+	m_tick += m_decoder.getDeltaTick();
+	if (m_decoder.isMeta() && (m_decoder.getMetaType() == 0x51) &&
+			(m_decoder.getMetaContentSize() >= 3)) {
+		const uchar* content = m_decoder.getMetaContent();
+		int microseconds = (content[0] << 16) | (content[1] << 8) | content[2];
+		m_tempos.push_back(std::make_pair(m_tick, microseconds / 1000000.0));
+	}
+	if (m_decoder.isEndOfTrack()) {
+		m_inTrackQ = false;
+		mergeTempos(m_tempos, m_trackTempos);
+		m_trackTempos = m_tempos.size();
+	}
+	m_eventQ = true;
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// MidiEventCursor::getTrack -- Return the track of the current event.
+//
+
+int MidiEventCursor::getTrack(void) const {
+	return m_track;
+}
+
+
+
+//////////////////////////////
+//
+// MidiEventCursor::getTick -- Return the absolute tick of the current
+//    event within its track.
+//
+
+int MidiEventCursor::getTick(void) const {
+	return m_tick;
+}
+
+
+
+//////////////////////////////
+//
+// MidiEventCursor::getCommandByte -- Return the command byte of the
+//    current event (running status is resolved).
+//
+
+int MidiEventCursor::getCommandByte(void) const {
+	return m_eventQ ? m_decoder.getCommandByte() : -1;
+}
+
+
+
+//////////////////////////////
+//
+// MidiEventCursor::getPayload -- Return the bytes after the command byte
+//    in the form that they are stored in a MidiMessage.  The data is valid
+//    until the next call to next().
+//
+
+const uchar* MidiEventCursor::getPayload(void) const {
+	return m_decoder.getPayload();
+}
+
+
+int MidiEventCursor::getPayloadSize(void) const {
+	return m_eventQ ? m_decoder.getPayloadSize() : 0;
+}
+
+
+
+//////////////////////////////
+//
+// MidiEventCursor::isMeta -- Returns true if the current event is
+//    a meta message.
+//
+
+bool MidiEventCursor::isMeta(void) const {
+	return m_eventQ && m_decoder.isMeta();
+}
+
+
+
+//////////////////////////////
+//
+// MidiEventCursor::getMetaType -- Return the meta message type, or -1 if
+//    the current event is not a meta message.
+//
+
+int MidiEventCursor::getMetaType(void) const {
+	return m_eventQ ? m_decoder.getMetaType() : -1;
+}
+
+
+
+//////////////////////////////
+//
+// MidiEventCursor::getMetaContent -- Return the content of a meta message.
+//
+
+const uchar* MidiEventCursor::getMetaContent(void) const {
+	return m_decoder.getMetaContent();
+}
+
+
+int MidiEventCursor::getMetaContentSize(void) const {
+	return isMeta() ? m_decoder.getMetaContentSize() : 0;
+}
+
+
+
+//////////////////////////////
+//
+// MidiEventCursor::getMetaText -- Return the content of a meta message
+//    as a string (such as for text and lyric meta messages).
+//
+
+std::string MidiEventCursor::getMetaText(void) const {
+	if (!isMeta()) {
+		return "";
+	}
+	return std::string((const char*)getMetaContent(), getMetaContentSize());
+}
+
+
+
+//////////////////////////////
+//
+// MidiEventCursor::isEndOfTrack -- Returns true if the current event is
+//    an end-of-track message.
+//
+
+bool MidiEventCursor::isEndOfTrack(void) const {
+	return m_eventQ && m_decoder.isEndOfTrack();
+}
+
+
+
+//////////////////////////////
+//
+// MidiEventCursor::getMessage -- Copy the current event into a MidiMessage.
+//
+
+void MidiEventCursor::getMessage(MidiMessage& message) const {
+	if (!m_eventQ) {
+		message.clear();
+		return;
+	}
+	message.resize(m_decoder.getMessageSize());
+	m_decoder.copyMessage(message.data());
+}
+
+
+//////////////////////////////
+//
+// MidiEventCursor::getTempoCount -- Return the number of tempo messages
+//    read so far.
+//
+
+int MidiEventCursor::getTempoCount(void) const {
+	return (int)m_tempos.size();
+}
+
+
+
+//////////////////////////////
+//
+// MidiEventCursor::getTimeInSeconds -- Convert a tick into seconds using
+//    the tempo messages read so far in all tracks, so call it after
+//    reading the whole file.  The tempo is 120 bpm until the first tempo
+//    change, and a tempo change applies after its own tick.
+//
+
+double MidiEventCursor::getTimeInSeconds(int tick) const {
+	const std::vector<std::pair<int, double>>* tempos = &m_tempos;
+	std::vector<std::pair<int, double>> merged;
+	if (m_trackTempos < m_tempos.size()) {
+		// Stopped inside of a track (after an error, for example).
+		merged = m_tempos;
+		mergeTempos(merged, m_trackTempos);
+		tempos = &merged;
+	}
+
+	int tpq = m_tpq > 0 ? m_tpq : 120;
+	double seconds = 0.0;
+	double secondsPerTick = 0.5 / tpq;
+	int lasttick = 0;
+	for (int i=0; i<(int)tempos->size(); i++) {
+		const std::pair<int, double>& tempo = (*tempos)[i];
+		if (tempo.first >= tick) {
+			break;
+		}
+		seconds += (tempo.first - lasttick) * secondsPerTick;
+		secondsPerTick = tempo.second / tpq;
+		lasttick = tempo.first;
+	}
+	return seconds + (tick - lasttick) * secondsPerTick;
+}
+
+
+///////////////////////////////////////////////////////////////////////////
+//
+// protected functions --
+//
+
+//////////////////////////////
+//
+// MidiEventCursor::mergeTempos -- Merge the tempo changes of a track,
+//    which follow the first count entries, into the sorted changes of the
+//    earlier tracks (which stay first at the same tick).  The changes of
+//    a track are only out of order if its ticks have overflowed.
+//
+
+void MidiEventCursor::mergeTempos(std::vector<std::pair<int, double>>& tempos,
+		size_t count) {
+	auto bytick = [](const std::pair<int, double>& a,
+			const std::pair<int, double>& b) {
+		return a.first < b.first;
+	};
+	auto middle = tempos.begin() + count;
+	if (!std::is_sorted(middle, tempos.end(), bytick)) {
+		std::stable_sort(middle, tempos.end(), bytick);
+	}
+	std::inplace_merge(tempos.begin(), middle, tempos.end(), bytick);
+}
+
+
+
+//////////////////////////////
+//
+// MidiEventCursor::readHeader -- Read the MThd chunk.
+//
+
+bool MidiEventCursor::readHeader(void) {
+	if (!fill(14)) {
+		std::cerr << "Error: unexpected end of file." << std::endl;
+		return false;
+	}
+	const uchar* ptr = m_buffer.data() + m_begin;
+	if (memcmp(ptr, "MThd", 4) != 0) {
+		std::cerr << "Error: input is not a MIDI file" << std::endl;
+		return false;
+	}
+	ulong length = ((ulong)ptr[4] << 24) | (ptr[5] << 16) | (ptr[6] << 8) | ptr[7];
+	if (length != 6) {
+		std::cerr << "Error: input is not a MIDI 1.0 Standard MIDI file." << std::endl;
+		std::cerr << "The header size is " << length << " bytes." << std::endl;
+		return false;
+	}
+	m_type = (ptr[8] << 8) | ptr[9];
+	if ((m_type != 0) && (m_type != 1)) {
+		std::cerr << "Error: cannot handle a type-" << m_type
+		          << " MIDI file" << std::endl;
+		return false;
+	}
+	m_tracks = (ptr[10] << 8) | ptr[11];
+	if ((m_type == 0) && (m_tracks != 1)) {
+		std::cerr << "Error: Type 0 MIDI file can only contain one track" << std::endl;
+		return false;
+	}
+	int division = (ptr[12] << 8) | ptr[13];
+	if (division >= 0x8000) {
+		int framespersecond = 255 - ((division >> 8) & 0x00ff) + 1;
+		int subframes       = division & 0x00ff;
+		m_tpq = framespersecond * subframes;
+	} else {
+		m_tpq = division;
+	}
+	m_begin += 14;
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// MidiEventCursor::fill -- Make at least the given number of bytes
+//    available starting at m_begin, reading more input if necessary.
+//    Returns false if the input ends before that.
+//
+
+bool MidiEventCursor::fill(size_t minimum) {
+	if (m_end - m_begin >= minimum) {
+		return true;
+	}
+	if (m_begin > 0) {
+		memmove(m_buffer.data(), m_buffer.data() + m_begin, m_end - m_begin);
+		m_end -= m_begin;
+		m_begin = 0;
+	}
+	if (m_buffer.size() < minimum) {
+		m_buffer.resize(std::max(minimum, m_buffer.size() * 2));
+	}
+	while ((m_end < minimum) && m_input && m_input->good()) {
+		m_input->read((char*)m_buffer.data() + m_end, m_buffer.size() - m_end);
+		m_end += (size_t)m_input->gcount();
+	}
+	return m_end >= minimum;
+}
+
+
+} // end namespace smf
+
+
+
@@ -12,9 +12,11 @@
 
 
 #include "MidiEventList.h"
+#include "MidiEventArena.h"
 
 #include <vector>
 #include <algorithm>
+#include <cstdint>
 #include <iterator>
 #include <utility>
 
@@ -53,7 +55,7 @@ MidiEventList::MidiEventList(const MidiEventList& other) {
 // MidiEventList::MidiEventList(MidiEventList&&) -- Move constructor.
 //
 
-MidiEventList::MidiEventList(MidiEventList&& other) {
+MidiEventList::MidiEventList(MidiEventList&& other) noexcept {
    list = std::move(other.list);
    other.list.clear();
 }
@@ -80,7 +82,7 @@ MidiEventList::~MidiEventList() {
 //
 int MidiEventList::remove(int index) {
    if ( ( index >=0 ) && ( index < (int)list.size() ) ) {
-     delete list[ index ];
+     MidiEventArena::deleteEvent(list[ index ]);
      list.erase(list.begin() + index);
      return (int)list.size()-1;
    } else {
@@ -95,7 +97,7 @@ int MidiEventList::remove(int index) {
 //      the index is invalid then the request is ignored and -1 is returned.
 //      If the index is valid then the new size of the list is returned.
 //
-int MidiEventList::insert(int index, MidiEvent& event) {
+int MidiEventList::insert(int index, const MidiEvent& event) {
   if (index == (int)list.size()) {
     MidiEvent *ptr = new MidiEvent(event);
     list.push_back(ptr);
@@ -110,6 +112,15 @@ int MidiEventList::insert(int index, MidiEvent& event) {
 }
 
 
+int MidiEventList::insert(int index, MidiEvent&& event) {
+	if ((index < 0) || (index > (int)list.size())) {
+		return -1;
+	}
+	list.insert(list.begin() + index, new MidiEvent(std::move(event)));
+	return (int)list.size()-1;
+}
+
+
 
 //////////////////////////////
 //
@@ -182,7 +193,7 @@ const MidiEvent& MidiEventList::getEvent(int index) const {
 void MidiEventList::clear(void) {
 	for (int i=0; i<(int)list.size(); i++) {
 		if (list[i] != NULL) {
-			delete list[i];
+			MidiEventArena::deleteEvent(list[i]);
 			list[i] = NULL;
 		}
 	}
@@ -248,32 +259,50 @@ int MidiEventList::getEventCount(void) const {
 //////////////////////////////
 //
 // MidiEventList::append -- add a MidiEvent at the end of the list.  Returns
-//     the index of the appended event.
+//     the index of the appended event.  The rvalue version moves the
+//     message bytes of the event instead of copying them.
 //
 
-int MidiEventList::append(MidiEvent& event) {
+int MidiEventList::append(const MidiEvent& event) {
 	MidiEvent* ptr = new MidiEvent(event);
 	list.push_back(ptr);
 	return (int)list.size()-1;
 }
 
+
+int MidiEventList::append(MidiEvent&& event) {
+	MidiEvent* ptr = new MidiEvent(std::move(event));
+	list.push_back(ptr);
+	return (int)list.size()-1;
+}
+
 //
 // MidiEventList::push -- Alias for MidiEventList::append().
 //
 
-int MidiEventList::push(MidiEvent& event) {
+int MidiEventList::push(const MidiEvent& event) {
 	return append(event);
 }
 
+
+int MidiEventList::push(MidiEvent&& event) {
+	return append(std::move(event));
+}
+
 //
 // MidiEventList::push_back -- Alias for MidiEventList::append().
 //
 
-int MidiEventList::push_back(MidiEvent& event) {
+int MidiEventList::push_back(const MidiEvent& event) {
 	return append(event);
 }
 
 
+int MidiEventList::push_back(MidiEvent&& event) {
+	return append(std::move(event));
+}
+
+
 
 //////////////////////////////
 //
@@ -286,7 +315,7 @@ void MidiEventList::removeEmpties(void) {
 	int count = 0;
 	for (int i=0; i<(int)list.size(); i++) {
 		if (list[i]->empty()) {
-			delete list[i];
+			MidiEventArena::deleteEvent(list[i]);
 			list[i] = NULL;
 			count++;
 		}
@@ -319,22 +348,29 @@ void MidiEventList::removeEmpties(void) {
 //
 
 int MidiEventList::linkEventPairs(void) {
-	return linkNotePairs();
+	return linkNotePairs(true);
 }
 
 
 int MidiEventList::linkNotePairs(void) {
+	return linkNotePairs(true);
+}
 
-	// Note-on states:
-	// dimension 1: MIDI channel (0-15)
-	// dimension 2: MIDI key     (0-127)  (but 0 not used for note-ons)
-	// dimension 3: List of active note-ons or note-offs.
-	std::vector<std::vector<std::vector<MidiEvent*>>> noteons;
-	noteons.resize(16);
-	int i;
-	for (i=0; i<(int)noteons.size(); i++) {
-		noteons[i].resize(128);
-	}
+//
+// MidiEventList::linkNotePairs -- If unlinkOthers is false, the old links
+//    are only removed from the events of the list, so events in other
+//    lists can still point to them.  MidiFile uses this when it links all
+//    tracks concurrently, since then each track only writes to its own
+//    events (and the other tracks remove their own old links).
+//
+
+int MidiEventList::linkNotePairs(bool unlinkOthers) {
+
+	// Note-on states: the last unpaired note-on of each MIDI channel
+	// (0-15) and key (0-127).  Each unpaired note-on points to the one
+	// before it with its event link, which is not used until the note-on
+	// is paired, so the stacks need no memory beyond this table.
+	MidiEvent* noteons[16][128] = {};
 
 	// Controller linking: The following General MIDI controller numbers are
 	// also monitored for linking within the track (but not between tracks).
@@ -358,43 +394,23 @@ int MidiEventList::linkNotePairs(void) {
 	// 5A  90   Undefined on/off                        0..63=off  64..127=on
 	// 7A 122   Local Keyboard On/Off                   0..63=off  64..127=on
 
-	// first keep track of whether the controller is an on/off switch:
-	std::vector<std::pair<int, int>> contmap;
-	contmap.resize(128);
-	std::pair<int, int> zero(0, 0);
-	std::fill(contmap.begin(), contmap.end(), zero);
-	contmap[64].first  = 1;   contmap[64].second = 0;
-	contmap[65].first  = 1;   contmap[65].second = 1;
-	contmap[66].first  = 1;   contmap[66].second = 2;
-	contmap[67].first  = 1;   contmap[67].second = 3;
-	contmap[68].first  = 1;   contmap[68].second = 4;
-	contmap[69].first  = 1;   contmap[69].second = 5;
-	contmap[80].first  = 1;   contmap[80].second = 6;
-	contmap[81].first  = 1;   contmap[81].second = 7;
-	contmap[82].first  = 1;   contmap[82].second = 8;
-	contmap[83].first  = 1;   contmap[83].second = 9;
-	contmap[84].first  = 1;   contmap[84].second = 10;
-	contmap[85].first  = 1;   contmap[85].second = 11;
-	contmap[86].first  = 1;   contmap[86].second = 12;
-	contmap[87].first  = 1;   contmap[87].second = 13;
-	contmap[88].first  = 1;   contmap[88].second = 14;
-	contmap[89].first  = 1;   contmap[89].second = 15;
-	contmap[90].first  = 1;   contmap[90].second = 16;
-	contmap[122].first = 1;   contmap[122].second = 17;
+	// first keep track of whether the controller is an on/off switch
+	// (contmap is the index of the switch, or -1 for other controllers):
+	static const int switches[18] = {
+		64, 65, 66, 67, 68, 69, 80, 81, 82, 83, 84, 85, 86, 87, 88, 89, 90, 122
+	};
+	int contmap[128];
+	std::fill(contmap, contmap + 128, -1);
+	for (int i=0; i<18; i++) {
+		contmap[switches[i]] = i;
+	}
 
 	// dimensions:
 	// 1: mapped controller (0 to 17)
 	// 2: channel (0 to 15)
-	std::vector<std::vector<MidiEvent*>> contevents;
-	contevents.resize(18);
-	std::vector<std::vector<int>> oldstates;
-	oldstates.resize(18);
-	for (int i=0; i<18; i++) {
-		contevents[i].resize(16);
-		std::fill(contevents[i].begin(), contevents[i].end(), nullptr);
-		oldstates[i].resize(16);
-		std::fill(oldstates[i].begin(), oldstates[i].end(), -1);
-	}
+	MidiEvent* contevents[18][16] = {};
+	int oldstates[18][16];
+	std::fill(&oldstates[0][0], &oldstates[0][0] + 18 * 16, -1);
 
 	// Now iterate through the MidiEventList keeping track of note and
 	// select controller states and linking notes/controllers as needed.
@@ -407,27 +423,39 @@ int MidiEventList::linkNotePairs(void) {
 	int counter = 0;
 	MidiEvent* mev;
 	MidiEvent* noteon;
-	for (i=0; i<getSize(); i++) {
+	MidiEvent* linked;
+	for (int i=0; i<getSize(); i++) {
 		mev = &getEvent(i);
-		mev->unlinkEvent();
-		if (mev->isNoteOn()) {
+		// Remove the old link.  The other event is only unlinked if it
+		// points back, since unpaired note-ons point to the stacks.
+		linked = mev->m_eventlink;
+		if (linked != NULL) {
+			if (unlinkOthers && (linked->m_eventlink == mev)) {
+				linked->m_eventlink = NULL;
+			}
+			mev->m_eventlink = NULL;
+		}
+		int kind = mev->getKind();
+		if (kind == MidiMessage::KIND_NOTE_ON) {
 			// store the note-on to pair later with a note-off message.
 			key = mev->getKeyNumber();
 			channel = mev->getChannel();
-			noteons[channel][key].push_back(mev);
-		} else if (mev->isNoteOff()) {
+			mev->m_eventlink = noteons[channel][key];
+			noteons[channel][key] = mev;
+		} else if (kind == MidiMessage::KIND_NOTE_OFF) {
 			key = mev->getKeyNumber();
 			channel = mev->getChannel();
-			if (noteons[channel][key].size() > 0) {
-				noteon = noteons[channel][key].back();
-				noteons[channel][key].pop_back();
-				noteon->linkEvent(mev);
+			noteon = noteons[channel][key];
+			if (noteon != NULL) {
+				noteons[channel][key] = noteon->m_eventlink;
+				noteon->m_eventlink = mev;
+				mev->m_eventlink = noteon;
 				counter++;
 			}
-		} else if (mev->isController()) {
+		} else if (kind == MidiMessage::KIND_CONTROLLER) {
 			contnum = mev->getP1();
-			if (contmap[contnum].first) {
-				conti     = contmap[contnum].second;
+			if (contmap[contnum] >= 0) {
+				conti     = contmap[contnum];
 				channel   = mev->getChannel();
 				contval   = mev->getP2();
 				contstate = contval < 64 ? 0 : 1;
@@ -453,19 +481,98 @@ int MidiEventList::linkNotePairs(void) {
 			}
 		}
 	}
+
+	// Note-ons which were not paired are left unlinked.  The stacks are
+	// cleared one step at a time together, since following a long stack
+	// on its own waits for each event to be loaded.
+	MidiEvent** stacks = &noteons[0][0];
+	int count = 0;
+	for (int i=0; i<16 * 128; i++) {
+		if (stacks[i] != NULL) {
+			stacks[count++] = stacks[i];
+		}
+	}
+	while (count > 0) {
+		int active = 0;
+		for (int i=0; i<count; i++) {
+			noteon = stacks[i];
+			mev = noteon->m_eventlink;
+			noteon->m_eventlink = NULL;
+			if (mev != NULL) {
+				stacks[active++] = mev;
+			}
+		}
+		count = active;
+	}
 	return counter;
 }
 
 
 
+//////////////////////////////
+//
+// MidiEventList::findNextKind -- Return the index of the first event at or
+//    after index whose kind is in the kinds mask, or the size of the list if
+//    there is none.  Loops over the events of some kinds look like this:
+//       for (int i=list.findNextKind(0, kinds); i<list.size();
+//             i=list.findNextKind(i+1, kinds)) { ... }
+//    Only the kind cached in each event is read, so the message bytes are
+//    not decoded again.
+//
+
+int MidiEventList::findNextKind(int index, unsigned int kinds) const {
+	int count = (int)list.size();
+	for (; index<count; index++) {
+		if (kinds & MidiMessage::kindMask(list[index]->getKind())) {
+			break;
+		}
+	}
+	return index;
+}
+
+
+
+//////////////////////////////
+//
+// MidiEventList::getKindIndex -- Return the indexes of the events whose
+//    kind is in the kinds mask.  The index is not updated when the list
+//    changes, so it is meant for lists which are scanned several times
+//    between edits.
+//
+
+std::vector<int> MidiEventList::getKindIndex(unsigned int kinds) const {
+	std::vector<int> output;
+	for (int i=0; i<(int)list.size(); i++) {
+		if (kinds & MidiMessage::kindMask(list[i]->getKind())) {
+			output.push_back(i);
+		}
+	}
+	return output;
+}
+
+
+
 //////////////////////////////
 //
 // MidiEventList::clearLinks -- remove all note-on/note-off links.
 //
 
 void MidiEventList::clearLinks(void) {
+	clearLinks(true);
+}
+
+//
+// MidiEventList::clearLinks -- If unlinkOthers is false, only the events
+//    of the list are changed (see linkNotePairs(bool)).
+//
+
+void MidiEventList::clearLinks(bool unlinkOthers) {
 	for (int i=0; i<(int)getSize(); i++) {
-		getEvent(i).unlinkEvent();
+		if (unlinkOthers) {
+			getEvent(i).unlinkEvent();
+		} else {
+			getEvent(i).m_eventlink = NULL;
+		}
 	}
 }
 
@@ -545,10 +652,26 @@ int MidiEventList::push_back_no_copy(MidiEvent* event) {
 
 //////////////////////////////
 //
-// MidiEventList::operator=(MidiEventList) -- Assignment.
+// MidiEventList::operator=(MidiEventList) -- Assignment.  Copying makes
+//     new copies of the events (which are not linked); moving takes over
+//     the events of the other list.
 //
 
-MidiEventList& MidiEventList::operator=(MidiEventList& other) {
+MidiEventList& MidiEventList::operator=(const MidiEventList& other) {
+	if (this == &other) {
+		return *this;
+	}
+	MidiEventList copy(other);
+	list.swap(copy.list);
+	return *this;
+}
+
+
+MidiEventList& MidiEventList::operator=(MidiEventList&& other) {
+	if (this == &other) {
+		return *this;
+	}
+	clear();
 	list.swap(other.list);
 	return *this;
 }
@@ -559,6 +682,214 @@ MidiEventList& MidiEventList::operator=(MidiEventList& other) {
 // private functions
 //
 
+// An event and the key it is sorted by: the tick in the high 32 bits, and
+// the sequence number or the sortRank() in the low 32 bits.
+struct SortEntry {
+	uint64_t   key;
+	MidiEvent* event;
+};
+
+// Lists shorter than this are sorted with std::stable_sort instead of a
+// radix sort.
+#define RADIX_SORT_MINIMUM 1024
+
+// Lists made of at most this many sorted runs (such as joined tracks) are
+// sorted with a k-way merge of the runs instead of a radix sort.
+#define MERGE_SORT_MAXIMUM_RUNS 1024
+
+// sortRank() values, in the order of the eventcompare() rules:
+enum {
+	RANK_META        = 0,
+	RANK_OTHER       = 1,   // including controllers
+	RANK_NOTE_OFF    = 2,
+	RANK_NOTE_ON     = 3,
+	RANK_END_OF_TRACK = 4
+};
+
+
+
+//////////////////////////////
+//
+// sortRank -- Return the position of an event among the events at the
+//    same tick according to the eventcompare() rules (without the
+//    controller rule).
+//
+
+static int sortRank(const MidiEvent& event) {
+	int p0 = event.getP0();
+	if (p0 == 0xff) {
+		return event.getP1() == 0x2f ? RANK_END_OF_TRACK : RANK_META;
+	}
+	int command = p0 & 0xf0;
+	if ((command == 0x90) && (event.getP2() != 0)) {
+		return RANK_NOTE_ON;
+	}
+	if ((command == 0x90) || (command == 0x80)) {
+		return RANK_NOTE_OFF;
+	}
+	return RANK_OTHER;
+}
+
+
+
+//////////////////////////////
+//
+// isController -- Returns true for events which eventcompare() orders by
+//    controller number and value.
+//
+
+static bool isController(const MidiEvent* event) {
+	return (event->getP0() & 0xf0) == 0xb0;
+}
+
+
+
+//////////////////////////////
+//
+// radixSort -- Sort entries by key with a stable LSD radix sort, one byte
+//    per pass.  Passes are skipped for bytes which are the same in every
+//    key, such as the high bytes of small ticks.
+//
+
+static void radixSort(std::vector<SortEntry>& entries) {
+	size_t count = entries.size();
+	std::vector<size_t> counts(8 * 256, 0);
+	for (size_t i=0; i<count; i++) {
+		uint64_t key = entries[i].key;
+		for (int b=0; b<8; b++) {
+			counts[b * 256 + ((key >> (8 * b)) & 0xff)]++;
+		}
+	}
+	std::vector<SortEntry> buffer(count);
+	for (int b=0; b<8; b++) {
+		size_t* bucket = counts.data() + b * 256;
+		if (bucket[(entries[0].key >> (8 * b)) & 0xff] == count) {
+			continue;
+		}
+		size_t offset = 0;
+		for (int d=0; d<256; d++) {
+			size_t n = bucket[d];
+			bucket[d] = offset;
+			offset += n;
+		}
+		for (size_t i=0; i<count; i++) {
+			buffer[bucket[(entries[i].key >> (8 * b)) & 0xff]++] = entries[i];
+		}
+		entries.swap(buffer);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// mergeRuns -- Sort entries made of sorted runs, which start at the given
+//    indexes, with a k-way merge.  A heap holds the run whose next entry
+//    comes first on top, so each entry takes O(log k) comparisons.
+//    Entries from an earlier run come first when keys are equal.
+//
+
+static void mergeRuns(std::vector<SortEntry>& entries,
+		const std::vector<size_t>& runs) {
+	// Heap items hold the key of the next entry of their run, so that
+	// comparisons do not need to look at the entries.
+	struct HeapItem {
+		uint64_t key;
+		size_t   run;
+	};
+	auto before = [](const HeapItem& a, const HeapItem& b) {
+		return (a.key < b.key) || ((a.key == b.key) && (a.run < b.run));
+	};
+
+	size_t count = runs.size();
+	std::vector<size_t> next(runs);    // next entry of each run
+	std::vector<size_t> end(count);
+	std::vector<HeapItem> heap(count);
+	for (size_t i=0; i<count; i++) {
+		end[i] = i+1 < count ? runs[i+1] : entries.size();
+		heap[i].key = entries[runs[i]].key;
+		heap[i].run = i;
+	}
+	std::make_heap(heap.begin(), heap.end(),
+			[&](const HeapItem& a, const HeapItem& b) { return before(b, a); });
+
+	std::vector<SortEntry> merged;
+	merged.reserve(entries.size());
+	while (heap.size() > 1) {
+		HeapItem top = heap[0];
+		merged.push_back(entries[next[top.run]++]);
+		if (next[top.run] == end[top.run]) {
+			top = heap.back();
+			heap.pop_back();
+		} else {
+			top.key = entries[next[top.run]].key;
+		}
+		// move the new top item down to its place:
+		size_t i = 0;
+		size_t size = heap.size();
+		while (2 * i + 1 < size) {
+			size_t child = 2 * i + 1;
+			if ((child + 1 < size) && before(heap[child + 1], heap[child])) {
+				child++;
+			}
+			if (!before(heap[child], top)) {
+				break;
+			}
+			heap[i] = heap[child];
+			i = child;
+		}
+		heap[i] = top;
+	}
+	size_t run = heap[0].run;
+	merged.insert(merged.end(), entries.begin() + next[run],
+			entries.begin() + end[run]);
+	entries.swap(merged);
+}
+
+
+
+//////////////////////////////
+//
+// sortTies -- Order events with the same sort key.  When the keys hold
+//    sequence numbers, events which share one are put in sortRank()
+//    order.  Controllers of the same rank are then put in order of
+//    controller number and value in the places that controllers take,
+//    so the other events keep their positions.
+//
+
+static void sortTies(SortEntry* first, SortEntry* last, bool sequenceQ,
+		std::vector<MidiEvent*>& controllers) {
+	if (sequenceQ) {
+		std::stable_sort(first, last, [](const SortEntry& a, const SortEntry& b) {
+			return sortRank(*a.event) < sortRank(*b.event);
+		});
+	}
+	controllers.clear();
+	for (SortEntry* entry=first; entry<last; entry++) {
+		if (isController(entry->event)) {
+			controllers.push_back(entry->event);
+		}
+	}
+	if (controllers.size() < 2) {
+		return;
+	}
+	std::stable_sort(controllers.begin(), controllers.end(),
+			[](const MidiEvent* a, const MidiEvent* b) {
+				if (a->getP1() != b->getP1()) {
+					return a->getP1() < b->getP1();
+				}
+				return a->getP2() < b->getP2();
+			});
+	int next = 0;
+	for (SortEntry* entry=first; entry<last; entry++) {
+		if (isController(entry->event)) {
+			entry->event = controllers[next++];
+		}
+	}
+}
+
+
+
 //////////////////////////////
 //
 // MidiEventList::sort -- Private because the MidiFile class keeps
@@ -566,9 +897,71 @@ MidiEventList& MidiEventList::operator=(MidiEventList& other) {
 //    and sorting is only allowed in absolute tick state (The MidiEventList
 //    does not know about delta/absolute tick states of its contents).
 //
+//    Events are put in eventcompare() order with a stable sort on a 64-bit
+//    key per event, so the bytes of each event are read once rather than
+//    in every comparison.  eventcompare() only compares sequence numbers
+//    when both events have one, so they are used when every event has
+//    one (as after reading a file or markSequence()), and otherwise the
+//    events at the same tick are ordered by type.  Events which
+//    eventcompare() does not order keep their order in the list.
+//
 
 void MidiEventList::sort(void) {
-	qsort(data(), getEventCount(), sizeof(MidiEvent*), eventcompare);
+	int count = getEventCount();
+	if (count < 2) {
+		return;
+	}
+	bool sequenceQ = true;
+	for (int i=0; i<count; i++) {
+		if (list[i]->seq == 0) {
+			sequenceQ = false;
+			break;
+		}
+	}
+
+	// Signed ticks and sequence numbers are offset so that they sort as
+	// unsigned numbers.
+	std::vector<SortEntry> entries(count);
+	std::vector<size_t> runs(1, 0);
+	for (int i=0; i<count; i++) {
+		MidiEvent* event = list[i];
+		uint32_t order = sequenceQ ? (uint32_t)event->seq ^ 0x80000000u
+				: (uint32_t)sortRank(*event);
+		entries[i].key = ((uint64_t)((uint32_t)event->tick ^ 0x80000000u) << 32)
+				| order;
+		entries[i].event = event;
+		if ((i > 0) && (entries[i].key < entries[i-1].key)) {
+			runs.push_back(i);
+		}
+	}
+	if (runs.size() > 1) {
+		if (runs.size() <= MERGE_SORT_MAXIMUM_RUNS) {
+			mergeRuns(entries, runs);
+		} else if (count < RADIX_SORT_MINIMUM) {
+			std::stable_sort(entries.begin(), entries.end(),
+					[](const SortEntry& a, const SortEntry& b) {
+						return a.key < b.key;
+					});
+		} else {
+			radixSort(entries);
+		}
+	}
+
+	std::vector<MidiEvent*> controllers;
+	int start = 0;
+	for (int i=1; i<=count; i++) {
+		if ((i < count) && (entries[i].key == entries[start].key)) {
+			continue;
+		}
+		if (i - start > 1) {
+			sortTies(entries.data() + start, entries.data() + i, sequenceQ,
+					controllers);
+		}
+		start = i;
+	}
+	for (int i=0; i<count; i++) {
+		list[i] = entries[i].event;
+	}
 }
 
 
@@ -14,6 +14,12 @@
 
 #include "MidiFile.h"
 #include "Binasc.h"
+#include "MidiEventArena.h"
+#include "MidiMemoryMap.h"
+#include "MidiTrackDecoder.h"
+#include "MidiThreadPool.h"
+#include "MidiTimeline.h"
+#include "MidiVlv.h"
 
 #include <string>
 #include <vector>
@@ -23,10 +29,62 @@
 #include <sstream>
 #include <iterator>
 #include <algorithm>
+#include <atomic>
+#include <functional>
+#include <unordered_map>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifndef _WIN32
+	#include <sys/uio.h>
+	#include <errno.h>
+	#include <fcntl.h>
+	#include <limits.h>
+	#include <unistd.h>
+#endif
 
 
 namespace smf {
 
+// Identification of the cache files written by MidiFile::writeCache().
+// Increase CACHE_VERSION whenever the layout of the cache changes.
+#define CACHE_MAGIC   "SMFCACHE"
+#define CACHE_VERSION 3
+
+// Optional sections of a cache file:
+#define CACHE_SECONDS      1
+#define CACHE_TRACKS       2
+#define CACHE_SEQUENCES    4
+#define CACHE_ALL_SECTIONS 7
+
+// Header of a cache file:
+class _CacheHeader {
+	public:
+		char     magic[8];      // CACHE_MAGIC without the terminating null
+		uint32_t version;       // CACHE_VERSION
+		uint32_t byteorder;     // 0x01020304 in the writer's byte order
+		uint64_t sourcesize;    // size of the source MIDI file
+		int64_t  sourcetime;    // modification time of the source MIDI file
+		int32_t  tpq;
+		int32_t  tracks;
+		int32_t  trackstate;
+		int32_t  timestate;
+		int32_t  linked;
+		int32_t  timemapvalid;
+		uint32_t sections;      // CACHE_* flags of the optional sections
+		uint32_t reserved;
+		uint64_t events;        // total number of events
+		uint64_t bytes;         // total size of the messages
+		uint64_t pairs;         // number of linked event pairs
+		uint64_t sizes;         // number of messages with a stored size
+		uint64_t timemap;       // number of time map entries (tempo segments)
+};
+static_assert(sizeof(_CacheHeader) == 104, "unexpected cache header padding");
+
+
 //////////////////////////////
 //
 // MidiFile::MidiFile -- Constuctor.
@@ -35,7 +93,7 @@ namespace smf {
 MidiFile::MidiFile(void) {
 	m_events.resize(m_trackCount);
 	for (int i=0; i<m_trackCount; i++) {
-		m_events[i] = new MidiEventList;
+		m_events[i].reset(new MidiEventList);
 	}
 }
 
@@ -43,7 +101,7 @@ MidiFile::MidiFile(void) {
 MidiFile::MidiFile(const std::string& filename) {
 	m_events.resize(m_trackCount);
 	for (int i=0; i<m_trackCount; i++) {
-		m_events[i] = new MidiEventList;
+		m_events[i].reset(new MidiEventList);
 	}
 	read(filename);
 }
@@ -52,7 +110,7 @@ MidiFile::MidiFile(const std::string& filename) {
 MidiFile::MidiFile(std::istream& input) {
 	m_events.resize(m_trackCount);
 	for (int i=0; i<m_trackCount; i++) {
-		m_events[i] = new MidiEventList;
+		m_events[i].reset(new MidiEventList);
 	}
 	read(input);
 }
@@ -80,8 +138,7 @@ MidiFile::~MidiFile() {
 	m_readFileName.clear();
 	clear();
 	if (m_events[0] != NULL) {
-		delete m_events[0];
-		m_events[0] = NULL;
+		m_events[0].reset();
 	}
 	m_events.resize(0);
 	m_rwstatus = false;
@@ -100,13 +157,9 @@ MidiFile& MidiFile::operator=(const MidiFile& other) {
 	if (this == &other) {
 		return *this;
 	}
-	m_events.reserve(other.m_events.size());
-	auto it = other.m_events.begin();
-	std::generate_n(std::back_inserter(m_events), other.m_events.size(),
-		[&]()->MidiEventList* {
-			return new MidiEventList(**it++);
-		}
-	);
+	// The tracks are shared until one of the files changes them.
+	m_events = other.m_events;
+	m_linkedEventsQ = other.m_linkedEventsQ;
 	m_ticksPerQuarterNote = other.m_ticksPerQuarterNote;
 	m_trackCount          = other.m_trackCount;
 	m_theTrackState       = other.m_theTrackState;
@@ -115,9 +168,8 @@ MidiFile& MidiFile::operator=(const MidiFile& other) {
 	m_timemapvalid        = other.m_timemapvalid;
 	m_timemap             = other.m_timemap;
 	m_rwstatus            = other.m_rwstatus;
-	if (other.m_linkedEventsQ) {
-		linkEventPairs();
-	}
+	m_threadCount         = other.m_threadCount;
+	m_arenaQ              = other.m_arenaQ;
 	return *this;
 }
 
@@ -136,6 +188,8 @@ MidiFile& MidiFile::operator=(MidiFile&& other) {
 	m_timemapvalid        = other.m_timemapvalid;
 	m_timemap             = other.m_timemap;
 	m_rwstatus            = other.m_rwstatus;
+	m_threadCount         = other.m_threadCount;
+	m_arenaQ              = other.m_arenaQ;
 	return *this;
 }
 
@@ -156,6 +210,15 @@ bool MidiFile::read(const std::string& filename) {
 	setFilename(filename);
 	m_rwstatus = true;
 
+	// Decode binary files straight from a memory mapping of the file
+	// rather than one byte at a time from a stream.
+	MidiMemoryMap mapping;
+	if (mapping.open(filename) && (mapping.size() > 0) &&
+			(mapping.data()[0] == 'M')) {
+		m_rwstatus = read(mapping.data(), mapping.size());
+		return m_rwstatus;
+	}
+
 	std::fstream input;
 	input.open(filename.c_str(), std::ios::binary | std::ios::in);
 
@@ -169,7 +232,9 @@ bool MidiFile::read(const std::string& filename) {
 }
 
 //
-// istream version of read().
+// istream version of read().  Binary input is read to the end of the
+// stream and decoded by the memory version of read(), so that it is
+// read in the same way as a file (with threads and arena storage).
 //
 
 bool MidiFile::read(std::istream& input) {
@@ -177,22 +242,30 @@ bool MidiFile::read(std::istream& input) {
 	if (input.peek() != 'M') {
 		// If the first byte in the input stream is not 'M', then presume that
 		// the MIDI file is in the binasc format which is an ASCII representation
-		// of the MIDI file.  Convert the binasc content into binary content and
-		// then continue reading with this function.
-		std::stringstream binarydata;
-		Binasc binasc;
-		binasc.writeToBinary(binarydata, input);
-		binarydata.seekg(0, std::ios_base::beg);
-		if (binarydata.peek() != 'M') {
-			std::cerr << "Bad MIDI data input" << std::endl;
-			m_rwstatus = false;
-			return m_rwstatus;
-		} else {
-			m_rwstatus = read(binarydata);
-			return m_rwstatus;
-		}
+		// of the MIDI file.  The binasc content is converted into events
+		// while it is being read.
+		m_rwstatus = readBinasc(input);
+		return m_rwstatus;
 	}
 
+	std::vector<uchar> data((std::istreambuf_iterator<char>(input)),
+			std::istreambuf_iterator<char>());
+	m_rwstatus = read(data.data(), data.size());
+	return m_rwstatus;
+}
+
+
+
+//////////////////////////////
+//
+// MidiFile::readStream -- Read a Standard MIDI File one byte at a time
+//    from a stream.  This is only used for data which cannot be decoded
+//    by decodeFile(), so that problems are reported and the partial
+//    tracks are kept as they have always been.
+//
+
+bool MidiFile::readStream(std::istream& input) {
+	m_rwstatus = true;
 	std::string filename = getFilename();
 
 	int    character;
@@ -292,11 +365,11 @@ bool MidiFile::read(std::istream& input) {
 	}
 	clear();
 	if (m_events[0] != NULL) {
-		delete m_events[0];
+		m_events[0].reset();
 	}
 	m_events.resize(tracks);
 	for (int z=0; z<tracks; z++) {
-		m_events[z] = new MidiEventList;
+		m_events[z].reset(new MidiEventList);
 		m_events[z]->reserve(10000);   // Initialize with 10,000 event storage.
 		m_events[z]->clear();
 	}
@@ -459,6 +532,456 @@ bool MidiFile::read(std::istream& input) {
 
 
 
+//
+// Memory version of read().  The bytes are decoded in place and must
+// contain a complete Standard MIDI File.  Binasc text is passed on to
+// the istream version, and data which cannot be decoded is read again
+// with readStream(), which reports the problem and keeps the partial
+// tracks.  The memory is not referenced after the function returns.
+//
+
+bool MidiFile::read(const uchar* data, size_t length) {
+	m_rwstatus = true;
+	if ((length == 0) || (data[0] != 'M')) {
+		std::stringstream textdata;
+		textdata.write((const char*)data, length);
+		textdata.seekg(0, std::ios_base::beg);
+		m_rwstatus = read(textdata);
+	} else if (!decodeFile(data, length)) {
+		std::stringstream filedata;
+		filedata.write((const char*)data, length);
+		filedata.seekg(0, std::ios_base::beg);
+		m_rwstatus = readStream(filedata);
+	}
+	return m_rwstatus;
+}
+
+
+
+//////////////////////////////
+//
+// MidiFile::decodeFile -- Decode a complete Standard MIDI File from
+//    memory.  Returns false without reporting the problem if the data
+//    is invalid or incomplete.
+//
+
+bool MidiFile::decodeFile(const uchar* data, size_t length) {
+	const uchar* ptr = data;
+	const uchar* end = data + length;
+	int tracks;
+	if (!readHeaderChunk(ptr, end, tracks, false)) {
+		return false;
+	}
+
+	//////////////////////////////////////////////////
+	//
+	// now read individual tracks:
+	//
+
+	// When several threads are allowed, first try to locate every track
+	// by its chunk size and decode the tracks concurrently.  If the chunk
+	// sizes are not consistent with the data, the tracks are decoded
+	// again below by searching for each end-of-track message.
+	if ((getThreadCount() != 1) && (tracks > 1)) {
+		if (readTracksInParallel(ptr, end, tracks)) {
+			m_theTimeState = TIME_STATE_ABSOLUTE;
+			markSequence();
+			return true;
+		}
+	}
+
+	ulong longdata;
+	for (int i=0; i<tracks; i++) {
+		if (!readTrackHeader(ptr, end, longdata, false)) {
+			return false;
+		}
+
+		// The track chunk size is only used to estimate the number of
+		// events: the track MUST end with an end of track meta event,
+		// and many MIDI files found in the wild do not correctly give
+		// the track size.
+		if (longdata > (ulong)(end - ptr)) {
+			longdata = (ulong)(end - ptr);
+		}
+		m_events[i]->reserve((int)(longdata/3));
+
+		// process the track
+		size_t used = 0;
+		if (decodeTrack(i, ptr, (size_t)(end - ptr), used)) {
+			return false;
+		}
+		ptr += used;
+	}
+
+	m_theTimeState = TIME_STATE_ABSOLUTE;
+	markSequence();
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// MidiFile::readBinasc -- Read a MIDI file in the binasc format in one
+//    pass.  Each line is converted into bytes with the same rules as
+//    Binasc::writeToBinary(), and the events are decoded as soon as their
+//    last byte is available, so only the bytes of an incomplete event are
+//    kept between lines.  Problems are reported in the same way as when
+//    reading the equivalent binary file.
+//
+
+bool MidiFile::readBinasc(std::istream& input) {
+	Binasc binasc;
+	std::stringstream linebytes;
+	std::string line;
+	int lineNum = 0;
+	bool moreQ = true;
+
+	std::vector<uchar> bytes;   // converted bytes which are not decoded yet
+	MidiTrackDecoder decoder;
+	MidiEventArena arena;
+	int tracks = -1;            // -1 until the header has been read
+	int track = 0;
+	bool inTrackQ = false;
+	int absticks = 0;
+
+	while (1) {
+		if (moreQ) {
+			// A last line without a newline is ignored, as in
+			// Binasc::writeToBinary().
+			moreQ = std::getline(input, line) && !input.eof();
+			if (moreQ) {
+				lineNum++;
+				linebytes.str(std::string());
+				// Stop reading after a conversion error, but keep the bytes
+				// converted before the error (as in Binasc::writeToBinary).
+				moreQ = binasc.writeLineToBinary(linebytes, line, lineNum);
+				std::string converted = linebytes.str();
+				bytes.insert(bytes.end(), converted.begin(), converted.end());
+			}
+		}
+
+		const uchar* ptr = bytes.data();
+		const uchar* end = ptr + bytes.size();
+		while (1) {
+			if (tracks < 0) {
+				if (moreQ && (end - ptr < 14)) {
+					break;
+				}
+				if ((ptr == end) || (*ptr != 'M')) {
+					std::cerr << "Bad MIDI data input" << std::endl;
+					m_rwstatus = false; return m_rwstatus;
+				}
+				if (!readHeaderChunk(ptr, end, tracks, true)) {
+					return m_rwstatus;
+				}
+			} else if (track >= tracks) {
+				// The rest of the input is ignored.
+				m_theTimeState = TIME_STATE_ABSOLUTE;
+				markSequence();
+				return m_rwstatus;
+			} else if (!inTrackQ) {
+				if (moreQ && (end - ptr < 8)) {
+					break;
+				}
+				ulong chunksize;
+				if (!readTrackHeader(ptr, end, chunksize, true)) {
+					return m_rwstatus;
+				}
+				decoder.clearRunningStatus();
+				absticks = 0;
+				inTrackQ = true;
+			} else {
+				decoder.continueData(ptr, end - ptr);
+				int status = decoder.next();
+				if ((status < 0) || ((status == 0) && !moreQ)) {
+					std::cerr << "Error: " << decoder.getError() << std::endl;
+					m_rwstatus = false; return m_rwstatus;
+				} else if (status == 0) {
+					break;
+				}
+				absticks += decoder.getDeltaTick();
+				MidiEvent* event = m_arenaQ ? arena.newEvent() : new MidiEvent;
+				event->resize(decoder.getMessageSize());
+				decoder.copyMessage(event->data());
+				event->updateKind();
+				event->tick = absticks;
+				event->track = track;
+				m_events[track]->push_back_no_copy(event);
+				ptr += decoder.getOffset();
+				if (decoder.isEndOfTrack()) {
+					inTrackQ = false;
+					track++;
+				}
+			}
+		}
+		bytes.erase(bytes.begin(), bytes.begin() + (ptr - bytes.data()));
+	}
+}
+
+
+
+//////////////////////////////
+//
+// MidiFile::readHeaderChunk -- Read the MThd chunk at the start of the
+//    data, then prepare the tracks and set the ticks per quarter note.
+//    Returns false if the header is invalid or incomplete, after printing
+//    the problem if reportQ is true.
+//
+
+bool MidiFile::readHeaderChunk(const uchar*& ptr, const uchar* end,
+		int& tracks, bool reportQ) {
+	std::string filename = getFilename();
+
+	// Read the MIDI header (4 bytes of ID, 4 byte data size,
+	// anticipated 6 bytes of data.
+
+	const char* headerid = "MThd";
+	for (int i=0; i<4; i++) {
+		if (ptr + i >= end) {
+			if (reportQ) {
+				std::cerr << "In file " << filename << ": unexpected end of file." << std::endl;
+				std::cerr << "Expecting '" << headerid[i] << "' at byte " << i + 1
+				     << ", but found nothing." << std::endl;
+			}
+			m_rwstatus = false; return false;
+		} else if (ptr[i] != headerid[i]) {
+			if (reportQ) {
+				std::cerr << "File " << filename << " is not a MIDI file" << std::endl;
+				std::cerr << "Expecting '" << headerid[i] << "' at byte " << i + 1
+				     << " but got '" << (char)ptr[i] << "'" << std::endl;
+			}
+			m_rwstatus = false; return false;
+		}
+	}
+	ptr += 4;
+
+	if (end - ptr < 10) {
+		if (reportQ) {
+			std::cerr << "Error: unexpected end of file." << std::endl;
+		}
+		m_rwstatus = false; return false;
+	}
+
+	// read header size (allow larger header size?)
+	ulong longdata = ((ulong)ptr[0] << 24) | (ptr[1] << 16) | (ptr[2] << 8) | ptr[3];
+	ptr += 4;
+	if (longdata != 6) {
+		if (reportQ) {
+			std::cerr << "File " << filename
+			     << " is not a MIDI 1.0 Standard MIDI file." << std::endl;
+			std::cerr << "The header size is " << longdata << " bytes." << std::endl;
+		}
+		m_rwstatus = false; return false;
+	}
+
+	// Header parameter #1: format type
+	ushort shortdata = (ptr[0] << 8) | ptr[1];
+	ptr += 2;
+	int type;
+	switch (shortdata) {
+		case 0:
+			type = 0;
+			break;
+		case 1:
+			type = 1;
+			break;
+		default:
+			if (reportQ) {
+				std::cerr << "Error: cannot handle a type-" << shortdata
+				     << " MIDI file" << std::endl;
+			}
+			m_rwstatus = false; return false;
+	}
+
+	// Header parameter #2: track count
+	shortdata = (ptr[0] << 8) | ptr[1];
+	ptr += 2;
+	if (type == 0 && shortdata != 1) {
+		if (reportQ) {
+			std::cerr << "Error: Type 0 MIDI file can only contain one track" << std::endl;
+			std::cerr << "Instead track count is: " << shortdata << std::endl;
+		}
+		m_rwstatus = false; return false;
+	} else {
+		tracks = shortdata;
+	}
+	clear();
+	if (m_events[0] != NULL) {
+		m_events[0].reset();
+	}
+	m_events.resize(tracks);
+	for (int z=0; z<tracks; z++) {
+		m_events[z].reset(new MidiEventList);
+	}
+
+	// Header parameter #3: Ticks per quarter note
+	shortdata = (ptr[0] << 8) | ptr[1];
+	ptr += 2;
+	if (shortdata >= 0x8000) {
+		int framespersecond = 255 - ((shortdata >> 8) & 0x00ff) + 1;
+		int subframes       = shortdata & 0x00ff;
+		switch (framespersecond) {
+			case 25:  framespersecond = 25; break;
+			case 24:  framespersecond = 24; break;
+			case 29:  framespersecond = 29; break;  // really 29.97 for color television
+			case 30:  framespersecond = 30; break;
+			default:
+					std::cerr << "Warning: unknown FPS: " << framespersecond << std::endl;
+					std::cerr << "Using non-standard FPS: " << framespersecond << std::endl;
+		}
+		m_ticksPerQuarterNote = framespersecond * subframes;
+	}  else {
+		m_ticksPerQuarterNote = shortdata;
+	}
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// MidiFile::readTrackHeader -- Read the "MTrk" marker and the chunk size
+//    of a track.  Returns false if the track header is invalid or
+//    incomplete, after printing the problem if reportQ is true.
+//
+
+bool MidiFile::readTrackHeader(const uchar*& ptr, const uchar* end,
+		ulong& chunksize, bool reportQ) {
+	std::string filename = getFilename();
+	const char* trackid = "MTrk";
+	for (int j=0; j<4; j++) {
+		if (ptr + j >= end) {
+			if (reportQ) {
+				std::cerr << "In file " << filename << ": unexpected end of file." << std::endl;
+				std::cerr << "Expecting '" << trackid[j] << "' at byte " << j + 1
+				     << " in track, but found nothing." << std::endl;
+			}
+			m_rwstatus = false; return false;
+		} else if (ptr[j] != trackid[j]) {
+			if (reportQ) {
+				std::cerr << "File " << filename << " is not a MIDI file" << std::endl;
+				std::cerr << "Expecting '" << trackid[j] << "' at byte " << j + 1
+				     << " in track but got '" << (char)ptr[j] << "'" << std::endl;
+			}
+			m_rwstatus = false; return false;
+		}
+	}
+	ptr += 4;
+	if (end - ptr < 4) {
+		if (reportQ) {
+			std::cerr << "Error: unexpected end of file." << std::endl;
+		}
+		m_rwstatus = false; return false;
+	}
+	chunksize = ((ulong)ptr[0] << 24) | (ptr[1] << 16) | (ptr[2] << 8) | ptr[3];
+	ptr += 4;
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// MidiFile::decodeTrack -- Decode MTrk chunk data (after the chunk header)
+//    into the given track, stopping after the end-of-track message.  The
+//    number of bytes decoded is stored in used.  Returns NULL on success,
+//    or a description of the problem.
+//
+
+const char* MidiFile::decodeTrack(int track, const uchar* data, size_t size,
+		size_t& used) {
+	MidiEventList& events = *m_events[track];
+	MidiTrackDecoder decoder(data, size);
+	MidiEventArena arena;
+	int absticks = 0;
+	while (1) {
+		if (decoder.next() <= 0) {
+			used = decoder.getOffset();
+			return decoder.getError();
+		}
+		absticks += decoder.getDeltaTick();
+		MidiEvent* event = m_arenaQ ? arena.newEvent() : new MidiEvent;
+		event->resize(decoder.getMessageSize());
+		decoder.copyMessage(event->data());
+		event->updateKind(); // classify the event while its bytes are cached
+		event->tick = absticks;
+		event->track = track;
+		events.push_back_no_copy(event);
+		if (decoder.isEndOfTrack()) {
+			break;
+		}
+	}
+	used = decoder.getOffset();
+	return NULL;
+}
+
+
+
+//////////////////////////////
+//
+// MidiFile::readTracksInParallel -- Find the MTrk chunks from their
+//    declared sizes and decode them on the thread pool.  Returns false
+//    without reporting errors if the chunk sizes do not exactly match
+//    the track contents (each track has to end with its end-of-track
+//    message), in which case the tracks are left empty so that the
+//    caller can read them sequentially.
+//
+
+bool MidiFile::readTracksInParallel(const uchar* data, const uchar* end,
+		int tracks) {
+	std::vector<const uchar*> starts(tracks);
+	std::vector<size_t> sizes(tracks);
+	const uchar* ptr = data;
+	for (int i=0; i<tracks; i++) {
+		if ((end - ptr < 8) || (ptr[0] != 'M') || (ptr[1] != 'T') ||
+				(ptr[2] != 'r') || (ptr[3] != 'k')) {
+			return false;
+		}
+		ulong chunksize = ((ulong)ptr[4] << 24) | (ptr[5] << 16) |
+				(ptr[6] << 8) | ptr[7];
+		ptr += 8;
+		if (chunksize > (ulong)(end - ptr)) {
+			return false;
+		}
+		starts[i] = ptr;
+		sizes[i] = chunksize;
+		ptr += chunksize;
+	}
+
+	// Start with the largest tracks so that one long track is not left
+	// for the end.
+	std::vector<int> order(tracks);
+	for (int i=0; i<tracks; i++) {
+		order[i] = i;
+	}
+	std::stable_sort(order.begin(), order.end(),
+		[&sizes](int a, int b) { return sizes[a] > sizes[b]; });
+
+	std::vector<char> valid(tracks, 0);
+	std::function<void(int)> task = [&](int index) {
+		int track = order[index];
+		m_events[track]->reserve((int)(sizes[track]/3));
+		size_t used = 0;
+		if (decodeTrack(track, starts[track], sizes[track], used) == NULL) {
+			valid[track] = (used == sizes[track]);
+		}
+	};
+	MidiThreadPool::getSharedPool().run(tracks, task, m_threadCount);
+
+	for (int i=0; i<tracks; i++) {
+		if (!valid[i]) {
+			for (int j=0; j<tracks; j++) {
+				m_events[j]->clear();
+			}
+			return false;
+		}
+	}
+	return true;
+}
+
+
+
 //////////////////////////////
 //
 // MidiFile::write -- write a standard MIDI file to a file or an output
@@ -466,129 +989,729 @@ bool MidiFile::read(std::istream& input) {
 //
 
 bool MidiFile::write(const std::string& filename) {
-	std::fstream output(filename.c_str(), std::ios::binary | std::ios::out);
+	std::vector<std::vector<uchar>> chunks;
+	encodeChunks(chunks);
+	m_rwstatus = writeChunks(filename, chunks);
+	return m_rwstatus;
+}
+
+//
+// ostream version of MidiFile::write().  The MIDI file is not modified,
+// so this function can be used on a const MidiFile.
+//
+
+bool MidiFile::write(std::ostream& out) const {
+	std::vector<std::vector<uchar>> chunks;
+	encodeChunks(chunks);
+	for (int i=0; i<(int)chunks.size(); i++) {
+		out.write((const char*)chunks[i].data(), chunks[i].size());
+	}
+	return true;
+}
+
 
+
+//////////////////////////////
+//
+// MidiFile::encodeChunks -- Convert the MIDI file into the bytes of a
+//    Standard MIDI File: the MThd chunk followed by one MTrk chunk for
+//    each track.  The tracks are encoded concurrently when several threads
+//    are allowed (see setThreadCount()).  Problems are printed in track
+//    order after all tracks have been encoded.
+//
+
+void MidiFile::encodeChunks(std::vector<std::vector<uchar>>& chunks) const {
+	int tracks = getNumTracks();
+	chunks.resize(tracks + 1);
+
+	// write the header of the Standard MIDI File: the characters "MThd",
+	// the size of the header (always 6), the MIDI file format (type 0 or 1),
+	// the number of tracks and the ticks per quarter note (avoiding SMTPE
+	// for now).
+	std::vector<uchar>& header = chunks[0];
+	header.resize(14);
+	int type = (tracks == 1) ? 0 : 1;
+	int tpq = getTicksPerQuarterNote();
+	uchar headerdata[14] = {'M', 'T', 'h', 'd', 0, 0, 0, 6,
+			0, (uchar)type, (uchar)(tracks >> 8), (uchar)tracks,
+			(uchar)(tpq >> 8), (uchar)tpq};
+	std::copy(headerdata, headerdata + 14, header.begin());
+
+	std::vector<std::string> messages(tracks);
+	runTrackTasks([&](int track) {
+		encodeTrackChunk(track, chunks[track + 1], messages[track]);
+	});
+
+	for (int i=0; i<tracks; i++) {
+		std::cerr << messages[i];
+	}
+}
+
+
+
+//////////////////////////////
+//
+// MidiFile::encodeTrackChunk -- Convert a track into an MTrk chunk.  Delta
+//    ticks are calculated from the event ticks while encoding (in the same
+//    way as makeDeltaTicks()), so the tick state of the MIDI file does not
+//    change.  The size of the chunk is calculated before encoding so that
+//    the bytes are stored without resizing.  Problems are appended to
+//    messages.
+//
+
+void MidiFile::encodeTrackChunk(int track, std::vector<uchar>& chunk,
+		std::string& messages) const {
+	const MidiEventList& events = *m_events[track];
+	bool deltaQ = (getTickState() == TIME_STATE_DELTA);
+	int count = events.size();
+
+	// First pass: calculate the size of the track data, including space
+	// for an end-of-track message which may have to be added.
+	size_t size = 4;
+	int lasttick = 0;
+	for (int i=0; i<count; i++) {
+		const MidiEvent& event = events[i];
+		int delta = deltaQ ? event.tick : event.tick - lasttick;
+		lasttick = event.tick;
+		if (event.empty() || event.isEndOfTrack()) {
+			continue;
+		}
+		size += MidiVlv::getEncodedSize(getWritableVLV(delta));
+		int command = event.getCommandByte();
+		if ((command == 0xf0) || (command == 0xf7)) {
+			size += 1 + MidiVlv::getEncodedSize(getWritableVLV(
+					(long)event.size() - 1)) + event.size() - 1;
+		} else {
+			size += event.size();
+		}
+	}
+	chunk.resize(8 + size);
+
+	// Second pass: store the chunk header and the events.
+	uchar* start = chunk.data();
+	uchar* ptr = start + 8;
+	std::ostringstream errors;
+	lasttick = 0;
+	for (int i=0; i<count; i++) {
+		const MidiEvent& event = events[i];
+		int delta = deltaQ ? event.tick : event.tick - lasttick;
+		if (!deltaQ && (i > 0) && (delta < 0)) {
+			errors << "Error: negative delta tick value: " << delta << std::endl
+			       << "Timestamps must be sorted first"
+			       << " (use MidiFile::sortTracks() before writing)." << std::endl;
+		}
+		lasttick = event.tick;
+		if (event.empty()) {
+			// Don't write empty events (probably a delete message).
+			continue;
+		}
+		if (event.isEndOfTrack()) {
+			// Suppress end-of-track meta messages (one will be added
+			// automatically after all track data has been written).
+			continue;
+		}
+		ptr += MidiVlv::encode(getWritableVLV(delta, &errors), ptr);
+		int command = event.getCommandByte();
+		if ((command == 0xf0) || (command == 0xf7)) {
+			// 0xf0 == Complete sysex message (0xf0 is part of the raw MIDI).
+			// 0xf7 == Raw byte message (0xf7 not part of the raw MIDI).
+			// Print the first byte of the message (0xf0 or 0xf7), then
+			// print a VLV length for the rest of the bytes in the message.
+			// In other words, when creating a 0xf0 or 0xf7 MIDI message,
+			// do not insert the VLV byte length yourself, as this code will
+			// do it for you automatically.
+			*ptr++ = event[0];
+			ptr += MidiVlv::encode(getWritableVLV((long)event.size() - 1,
+					&errors), ptr);
+			std::copy(event.begin() + 1, event.end(), ptr);
+			ptr += event.size() - 1;
+		} else {
+			// non-sysex type of message, so just output the
+			// bytes of the message:
+			std::copy(event.begin(), event.end(), ptr);
+			ptr += event.size();
+		}
+	}
+	if ((ptr - start < 8 + 3) || !((ptr[-3] == 0xff) && (ptr[-2] == 0x2f))) {
+		uchar endoftrack[4] = {0, 0xff, 0x2f, 0x00};
+		ptr = std::copy(endoftrack, endoftrack + 4, ptr);
+	}
+	chunk.resize(ptr - start);
+
+	// the track ID marker "MTrk" and the size of the MIDI data to follow:
+	ulong datasize = (ulong)(chunk.size() - 8);
+	start[0] = 'M';
+	start[1] = 'T';
+	start[2] = 'r';
+	start[3] = 'k';
+	start[4] = (uchar)(datasize >> 24);
+	start[5] = (uchar)(datasize >> 16);
+	start[6] = (uchar)(datasize >> 8);
+	start[7] = (uchar)datasize;
+
+	messages = errors.str();
+}
+
+
+
+//////////////////////////////
+//
+// MidiFile::getWritableVLV -- Limit a number to the largest value which
+//    can be stored as a VLV in a MIDI file.  If errors is not NULL, then
+//    a message is added when the value is out of range.
+//
+
+ulong MidiFile::getWritableVLV(long value, std::ostream* errors) {
+	if ((unsigned long)value >= (1 << 28)) {
+		if (errors) {
+			*errors << "Error: number too large to convert to VLV" << std::endl;
+		}
+		return 0x0FFFffff;
+	}
+	return (ulong)value;
+}
+
+
+
+//////////////////////////////
+//
+// MidiFile::writeChunks -- Write the encoded chunks of a MIDI file into a
+//    file.  On POSIX systems all chunks are given to the operating system
+//    in a single scatter write.
+//
+
+bool MidiFile::writeChunks(const std::string& filename,
+		const std::vector<std::vector<uchar>>& chunks) {
+#ifndef _WIN32
+	int fd = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+	if (fd < 0) {
+		std::cerr << "Error: could not write: " << filename << std::endl;
+		return false;
+	}
+	std::vector<struct iovec> buffers;
+	buffers.reserve(chunks.size());
+	for (int i=0; i<(int)chunks.size(); i++) {
+		if (!chunks[i].empty()) {
+			struct iovec buffer;
+			buffer.iov_base = (void*)chunks[i].data();
+			buffer.iov_len = chunks[i].size();
+			buffers.push_back(buffer);
+		}
+	}
+	// writev() may write fewer bytes than requested, and it accepts at
+	// most IOV_MAX buffers at a time.
+	size_t index = 0;
+	bool status = true;
+	while (index < buffers.size()) {
+		int count = (int)std::min(buffers.size() - index, (size_t)IOV_MAX);
+		ssize_t written = ::writev(fd, &buffers[index], count);
+		if (written < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			status = false;
+			break;
+		}
+		while ((index < buffers.size()) &&
+				((size_t)written >= buffers[index].iov_len)) {
+			written -= buffers[index].iov_len;
+			index++;
+		}
+		if (written > 0) {
+			buffers[index].iov_base = (char*)buffers[index].iov_base + written;
+			buffers[index].iov_len -= written;
+		}
+	}
+	if (::close(fd) != 0) {
+		status = false;
+	}
+	if (!status) {
+		std::cerr << "Error: could not write: " << filename << std::endl;
+	}
+	return status;
+#else
+	std::fstream output(filename.c_str(), std::ios::binary | std::ios::out);
 	if (!output.is_open()) {
 		std::cerr << "Error: could not write: " << filename << std::endl;
 		return false;
 	}
-	m_rwstatus = write(output);
+	for (int i=0; i<(int)chunks.size(); i++) {
+		output.write((const char*)chunks[i].data(), chunks[i].size());
+	}
 	output.close();
-	return m_rwstatus;
+	return true;
+#endif
 }
 
+
+
+//////////////////////////////
 //
-// ostream version of MidiFile::write().
+// MidiFile::writeCache -- Store the MIDI file in a binary cache file which
+//    readCache() can load without decoding any MIDI data.  The cache holds
+//    the absolute ticks, messages and note links of the events, and the
+//    time map if doTimeAnalysis() has been done.  It is identified by
+//    the size and modification time of the source file, which should be
+//    the file that this MidiFile was read from.  An existing cache is
+//    replaced only once the new one has been written.  Returns false if
+//    the source file does not exist or the cache cannot be written.
+//
+//    Cache layout (all values in the byte order of the computer which
+//    wrote the cache, 8-byte arrays before 4-byte arrays so that no
+//    padding is needed):
+//       header (_CacheHeader, 104 bytes)
+//       uint64 first event, message byte, pair and stored size of each
+//              track, and the totals (4 x (tracks + 1))
+//       double seconds of each event (events, only with CACHE_SECONDS)
+//       double seconds and seconds per tick of each time map entry
+//              (2 x timemap)
+//       int32  tick of each event (events)
+//       int32  track of each event (events, only with CACHE_TRACKS)
+//       int32  sequence of each event (events, only with CACHE_SEQUENCES)
+//       uint32 event indexes (within the track) of the two events of each
+//              linked pair (2 x pairs)
+//       uint32 event index (within the track) and size of each message
+//              whose size does not follow from its status byte
+//              (2 x sizes)
+//       int32  tick of each time map entry (timemap)
+//       bytes  messages (bytes)
+//    Without CACHE_SECONDS the seconds are 0, without CACHE_TRACKS the
+//    track of each event is its track number, and without CACHE_SEQUENCES
+//    the sequence numbers are those given by markSequence().
+//
+
+bool MidiFile::writeCache(const std::string& cachefile,
+		const std::string& sourcefile) const {
+	_CacheHeader header;
+	memset(&header, 0, sizeof(header));
+	if (!getSourceKey(sourcefile, header.sourcesize, header.sourcetime)) {
+		return false;
+	}
+	if (m_theTimeState != TIME_STATE_ABSOLUTE) {
+		std::cerr << "Error: the cache can only be written with absolute ticks"
+		          << std::endl;
+		return false;
+	}
+
+	int tracks = getTrackCount();
+	std::vector<int> sequences(tracks);  // first sequence of markSequence()
+	int sequence = 1;
+	for (int i=0; i<tracks; i++) {
+		sequences[i] = sequence;
+		sequence += m_events[i]->getEventCount();
+	}
+
+	// Chunks in file order: the header and the track index, one chunk per
+	// track for each per-event section, and single chunks for the time map.
+	std::vector<std::vector<uchar>> chunks(3 + 7 * tracks);
+	int secondschunk = 1;
+	int tickchunk    = 2 + tracks;
+	int trackchunk   = 2 + 2 * tracks;
+	int seqchunk     = 2 + 3 * tracks;
+	int pairchunk    = 2 + 4 * tracks;
+	int sizechunk    = 2 + 5 * tracks;
+	int bytechunk    = 3 + 6 * tracks;
+
+	// Sections which are only needed if they cannot be worked out:
+	std::vector<uint32_t> needed(tracks, 0);
+
+	std::function<void(int)> task = [&](int track) {
+		const MidiEventList& events = *m_events[track];
+		int count = events.size();
+		std::vector<uchar>& seconds = chunks[secondschunk + track];
+		std::vector<uchar>& ticks   = chunks[tickchunk + track];
+		std::vector<uchar>& values  = chunks[trackchunk + track];
+		std::vector<uchar>& seqs    = chunks[seqchunk + track];
+		std::vector<uchar>& pairs   = chunks[pairchunk + track];
+		std::vector<uchar>& sizes   = chunks[sizechunk + track];
+		std::vector<uchar>& bytes   = chunks[bytechunk + track];
+		seconds.resize(8 * count);
+		ticks.resize(4 * count);
+		values.resize(4 * count);
+		seqs.resize(4 * count);
+		bytes.reserve(3 * count);
+
+		// Links are stored as event indexes within the track.
+		std::unordered_map<const MidiEvent*, int> indexes;
+		for (int j=0; j<count; j++) {
+			if (events[j].isLinked()) {
+				indexes.reserve(count);
+				for (int k=0; k<count; k++) {
+					indexes[&events[k]] = k;
+				}
+				break;
+			}
+		}
+
+		uint32_t sections = 0;
+		for (int j=0; j<count; j++) {
+			const MidiEvent& event = events[j];
+			int32_t fields[3] = {event.tick, event.track, event.seq};
+			memcpy(seconds.data() + 8 * j, &event.seconds, 8);
+			memcpy(ticks.data() + 4 * j, &fields[0], 4);
+			memcpy(values.data() + 4 * j, &fields[1], 4);
+			memcpy(seqs.data() + 4 * j, &fields[2], 4);
+			if (event.seconds != 0.0) {
+				sections |= CACHE_SECONDS;
+			}
+			if (event.track != track) {
+				sections |= CACHE_TRACKS;
+			}
+			if (event.seq != sequences[track] + j) {
+				sections |= CACHE_SEQUENCES;
+			}
+			if (event.isLinked()) {
+				auto found = indexes.find(event.getLinkedEvent());
+				if ((found != indexes.end()) && (found->second > j)) {
+					uint32_t pair[2] = {(uint32_t)j, (uint32_t)found->second};
+					pairs.insert(pairs.end(), (uchar*)pair, (uchar*)pair + 8);
+				}
+			}
+			if (event.empty() || ((int)event.size() != getCacheSize(event[0]))) {
+				uint32_t size[2] = {(uint32_t)j, (uint32_t)event.size()};
+				sizes.insert(sizes.end(), (uchar*)size, (uchar*)size + 8);
+			}
+			bytes.insert(bytes.end(), event.begin(), event.end());
+		}
+		needed[track] = sections;
+	};
+	MidiThreadPool::getSharedPool().run(tracks, task, m_threadCount);
+
+	for (int i=0; i<tracks; i++) {
+		header.sections |= needed[i];
+	}
+	for (int i=0; i<tracks; i++) {
+		if (!(header.sections & CACHE_SECONDS)) {
+			chunks[secondschunk + i].clear();
+		}
+		if (!(header.sections & CACHE_TRACKS)) {
+			chunks[trackchunk + i].clear();
+		}
+		if (!(header.sections & CACHE_SEQUENCES)) {
+			chunks[seqchunk + i].clear();
+		}
+	}
+
+	// Index of the first event, message byte, pair and stored size of each
+	// track:
+	std::vector<uint64_t> starts(4 * (tracks + 1), 0);
+	for (int i=0; i<tracks; i++) {
+		uint64_t* start = starts.data() + 4 * i;
+		start[4] = start[0] + m_events[i]->size();
+		start[5] = start[1] + chunks[bytechunk + i].size();
+		start[6] = start[2] + chunks[pairchunk + i].size() / 8;
+		start[7] = start[3] + chunks[sizechunk + i].size() / 8;
+	}
+
+	memcpy(header.magic, CACHE_MAGIC, 8);
+	header.version      = CACHE_VERSION;
+	header.byteorder    = 0x01020304;
+	header.tpq          = m_ticksPerQuarterNote;
+	header.tracks       = tracks;
+	header.trackstate   = m_theTrackState;
+	header.timestate    = m_theTimeState;
+	header.linked       = m_linkedEventsQ;
+	header.timemapvalid = m_timemapvalid;
+	header.events       = starts[4 * tracks];
+	header.bytes        = starts[4 * tracks + 1];
+	header.pairs        = starts[4 * tracks + 2];
+	header.sizes        = starts[4 * tracks + 3];
+	header.timemap      = m_timemapvalid ? m_timemap.size() : 0;
+
+	std::vector<uchar>& head = chunks[0];
+	head.resize(sizeof(header) + 8 * starts.size());
+	memcpy(head.data(), &header, sizeof(header));
+	memcpy(head.data() + sizeof(header), starts.data(), 8 * starts.size());
+
+	std::vector<uchar>& timeseconds = chunks[secondschunk + tracks];
+	std::vector<uchar>& timeticks = chunks[bytechunk - 1];
+	timeseconds.resize(16 * header.timemap);
+	timeticks.resize(4 * header.timemap);
+	for (uint64_t i=0; i<header.timemap; i++) {
+		int32_t tick = m_timemap[i].tick;
+		memcpy(timeseconds.data() + 16 * i, &m_timemap[i].seconds, 8);
+		memcpy(timeseconds.data() + 16 * i + 8, &m_timemap[i].secondsPerTick, 8);
+		memcpy(timeticks.data() + 4 * i, &tick, 4);
+	}
+
+	// The cache is written to a new file next to the old one and then
+	// renamed over it, so that a reader never sees a partly written cache,
+	// and two writers of the same cache do not share a temporary file.
+	std::string tempfile = cachefile + ".XXXXXX";
+#ifndef _WIN32
+	int fd = ::mkstemp(&tempfile[0]);
+	if (fd < 0) {
+		std::cerr << "Error: could not write: " << cachefile << std::endl;
+		return false;
+	}
+	::close(fd);
+#else
+	tempfile = cachefile + ".tmp";
+#endif
+	if (!writeChunks(tempfile, chunks)) {
+		remove(tempfile.c_str());
+		return false;
+	}
+#ifdef _WIN32
+	remove(cachefile.c_str());
+#endif
+	if (rename(tempfile.c_str(), cachefile.c_str()) != 0) {
+		std::cerr << "Error: could not write: " << cachefile << std::endl;
+		remove(tempfile.c_str());
+		return false;
+	}
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// MidiFile::readCache -- Load a cache file written by writeCache() for
+//    the given source file.  Returns false without changing the MidiFile
+//    if the cache does not exist, is damaged, was written by a different
+//    version of this class or on a computer with a different byte order,
+//    or if the size or modification time of the source file has changed
+//    since the cache was written.  Tracks are loaded concurrently (see
+//    setThreadCount()).
 //
 
-bool MidiFile::write(std::ostream& out) {
-	int oldTimeState = getTickState();
-	if (oldTimeState == TIME_STATE_ABSOLUTE) {
-		makeDeltaTicks();
+bool MidiFile::readCache(const std::string& cachefile,
+		const std::string& sourcefile) {
+	MidiMemoryMap mapping(cachefile);
+	if (!mapping.isOpen() || (mapping.size() < sizeof(_CacheHeader))) {
+		return false;
+	}
+	_CacheHeader header;
+	memcpy(&header, mapping.data(), sizeof(header));
+	if ((memcmp(header.magic, CACHE_MAGIC, 8) != 0) ||
+			(header.version != CACHE_VERSION) ||
+			(header.byteorder != 0x01020304) ||
+			(header.tracks < 1) || (header.tracks > 0xffff) ||
+			(header.sections & ~(uint32_t)CACHE_ALL_SECTIONS)) {
+		return false;
 	}
 
-	// write the header of the Standard MIDI File
-	char ch;
-	// 1. The characters "MThd"
-	ch = 'M'; out << ch;
-	ch = 'T'; out << ch;
-	ch = 'h'; out << ch;
-	ch = 'd'; out << ch;
+	uint64_t sourcesize = 0;
+	int64_t sourcetime = 0;
+	if (!getSourceKey(sourcefile, sourcesize, sourcetime) ||
+			(sourcesize != header.sourcesize) ||
+			(sourcetime != header.sourcetime)) {
+		return false;
+	}
 
-	// 2. write the size of the header (always a "6" stored in unsigned long
-	//    (4 bytes).
-	ulong longdata = 6;
-	writeBigEndianULong(out, longdata);
+	// Check that the sizes of the sections match the file size (without
+	// overflowing for bad counts).
+	uint64_t filesize = mapping.size();
+	if ((header.events > filesize) || (header.bytes > filesize) ||
+			(header.pairs > filesize) || (header.sizes > filesize) ||
+			(header.timemap > filesize)) {
+		return false;
+	}
+	uint64_t tracks = header.tracks;
+	uint64_t secondsq = (header.sections & CACHE_SECONDS) ? 1 : 0;
+	uint64_t tracksq = (header.sections & CACHE_TRACKS) ? 1 : 0;
+	uint64_t seqsq = (header.sections & CACHE_SEQUENCES) ? 1 : 0;
+	uint64_t expected = sizeof(header) + 32 * (tracks + 1) +
+			8 * secondsq * header.events + 16 * header.timemap +
+			4 * (1 + tracksq + seqsq) * header.events + 8 * header.pairs +
+			8 * header.sizes + 4 * header.timemap + header.bytes;
+	if (expected != filesize) {
+		return false;
+	}
 
-	// 3. MIDI file format, type 0, 1, or 2
-	ushort shortdata;
-	shortdata = (getNumTracks() == 1) ? 0 : 1;
-	writeBigEndianUShort(out,shortdata);
-
-	// 4. write out the number of tracks.
-	shortdata = getNumTracks();
-	writeBigEndianUShort(out, shortdata);
-
-	// 5. write out the number of ticks per quarternote. (avoiding SMTPE for now)
-	shortdata = getTicksPerQuarterNote();
-	writeBigEndianUShort(out, shortdata);
-
-	// now write each track.
-	std::vector<uchar> trackdata;
-	uchar endoftrack[4] = {0, 0xff, 0x2f, 0x00};
-	int i, j, k;
-	int size;
-	for (i=0; i<getNumTracks(); i++) {
-		trackdata.reserve(123456);   // make the track data larger than
-		                             // expected data input
-		trackdata.clear();
-		for (j=0; j<(int)m_events[i]->size(); j++) {
-			if ((*m_events[i])[j].empty()) {
-				// Don't write empty m_events (probably a delete message).
-				continue;
-			}
-			if ((*m_events[i])[j].isEndOfTrack()) {
-				// Suppress end-of-track meta messages (one will be added
-				// automatically after all track data has been written).
-				continue;
+	const uchar* index       = mapping.data() + sizeof(header);
+	const uchar* seconds     = index + 32 * (tracks + 1);
+	const uchar* timeseconds = seconds + 8 * secondsq * header.events;
+	const uchar* ticks       = timeseconds + 16 * header.timemap;
+	const uchar* trackvalues = ticks + 4 * header.events;
+	const uchar* seqs        = trackvalues + 4 * tracksq * header.events;
+	const uchar* pairs       = seqs + 4 * seqsq * header.events;
+	const uchar* sizes       = pairs + 8 * header.pairs;
+	const uchar* timeticks   = sizes + 8 * header.sizes;
+	const uchar* bytes       = timeticks + 4 * header.timemap;
+
+	std::vector<uint64_t> starts(4 * (tracks + 1));
+	memcpy(starts.data(), index, 8 * starts.size());
+	const uint64_t totals[4] = {header.events, header.bytes, header.pairs,
+			header.sizes};
+	for (int k=0; k<4; k++) {
+		if ((starts[k] != 0) || (starts[4 * tracks + k] != totals[k])) {
+			return false;
+		}
+		for (uint64_t i=0; i<tracks; i++) {
+			if (starts[4 * (i + 1) + k] < starts[4 * i + k]) {
+				return false;
 			}
-			writeVLValue((*m_events[i])[j].tick, trackdata);
-			if (((*m_events[i])[j].getCommandByte() == 0xf0) ||
-					((*m_events[i])[j].getCommandByte() == 0xf7)) {
-				// 0xf0 == Complete sysex message (0xf0 is part of the raw MIDI).
-				// 0xf7 == Raw byte message (0xf7 not part of the raw MIDI).
-				// Print the first byte of the message (0xf0 or 0xf7), then
-				// print a VLV length for the rest of the bytes in the message.
-				// In other words, when creating a 0xf0 or 0xf7 MIDI message,
-				// do not insert the VLV byte length yourself, as this code will
-				// do it for you automatically.
-				trackdata.push_back((*m_events[i])[j][0]); // 0xf0 or 0xf7;
-				writeVLValue(((int)(*m_events[i])[j].size())-1, trackdata);
-				for (k=1; k<(int)(*m_events[i])[j].size(); k++) {
-					trackdata.push_back((*m_events[i])[j][k]);
+		}
+	}
+	std::vector<int> sequences(tracks);  // first sequence of markSequence()
+	for (uint64_t i=0; i<tracks; i++) {
+		if (starts[4 * (i + 1)] - starts[4 * i] > 0x7fffffff) {
+			return false;
+		}
+		sequences[i] = (int)starts[4 * i] + 1;
+	}
+
+	std::vector<MidiEventList*> lists(tracks);
+	for (uint64_t i=0; i<tracks; i++) {
+		lists[i] = new MidiEventList;
+	}
+	std::vector<char> valid(tracks, 0);
+	std::function<void(int)> task = [&](int track) {
+		MidiEventList& events = *lists[track];
+		MidiEventArena arena;
+		const uint64_t* start = starts.data() + 4 * track;
+		uint64_t first = start[0];
+		int count = (int)(start[4] - first);
+		const uchar* message = bytes + start[1];
+		const uchar* end = bytes + start[5];
+		uint64_t sized = start[3];
+		uint32_t size[2] = {0, 0};  // index and size of the next stored size
+		if (sized < start[7]) {
+			memcpy(size, sizes + 8 * sized, 8);
+		}
+		events.reserve(count);
+		for (int j=0; j<count; j++) {
+			int length;
+			if ((sized < start[7]) && (size[0] == (uint32_t)j)) {
+				length = (int)size[1];
+				sized++;
+				if (sized < start[7]) {
+					memcpy(size, sizes + 8 * sized, 8);
+					if (size[0] <= (uint32_t)j) {
+						return;
+					}
 				}
+			} else if (message < end) {
+				length = getCacheSize(*message);
 			} else {
-				// non-sysex type of message, so just output the
-				// bytes of the message:
-				for (k=0; k<(int)(*m_events[i])[j].size(); k++) {
-					trackdata.push_back((*m_events[i])[j][k]);
-				}
+				return;
+			}
+			if ((length < 0) || (length > end - message)) {
+				return;
+			}
+			uint64_t eventindex = first + j;
+			MidiEvent* event = m_arenaQ ? arena.newEvent() : new MidiEvent;
+			events.push_back_no_copy(event);
+			event->assign(message, message + length);
+			event->getKind(); // classify the event while its bytes are cached
+			message += length;
+			int32_t value;
+			memcpy(&value, ticks + 4 * eventindex, 4);
+			event->tick = value;
+			if (tracksq) {
+				memcpy(&value, trackvalues + 4 * eventindex, 4);
+				event->track = value;
+			} else {
+				event->track = track;
 			}
+			if (seqsq) {
+				memcpy(&value, seqs + 4 * eventindex, 4);
+				event->seq = value;
+			} else {
+				event->seq = sequences[track] + j;
+			}
+			if (secondsq) {
+				memcpy(&event->seconds, seconds + 8 * eventindex, 8);
+			}
+		}
+		if ((message != end) || (sized != start[7])) {
+			return;
 		}
-		size = (int)trackdata.size();
-		if ((size < 3) || !((trackdata[size-3] == 0xff)
-				&& (trackdata[size-2] == 0x2f))) {
-			trackdata.push_back(endoftrack[0]);
-			trackdata.push_back(endoftrack[1]);
-			trackdata.push_back(endoftrack[2]);
-			trackdata.push_back(endoftrack[3]);
+		for (uint64_t i=start[2]; i<start[6]; i++) {
+			uint32_t pair[2];
+			memcpy(pair, pairs + 8 * i, 8);
+			if ((pair[0] >= pair[1]) || (pair[1] >= (uint32_t)count)) {
+				return;
+			}
+			events[pair[0]].linkEvent(events[pair[1]]);
+		}
+		valid[track] = 1;
+	};
+	MidiThreadPool::getSharedPool().run((int)tracks, task, m_threadCount);
+
+	for (uint64_t i=0; i<tracks; i++) {
+		if (!valid[i]) {
+			for (uint64_t j=0; j<tracks; j++) {
+				delete lists[j];
+			}
+			return false;
 		}
+	}
 
-		// now ready to write to MIDI file.
+	clear();
+	m_events.resize(tracks);
+	for (uint64_t i=0; i<tracks; i++) {
+		m_events[i].reset(lists[i]);
+	}
+	m_ticksPerQuarterNote = header.tpq;
+	m_theTrackState = header.trackstate;
+	m_theTimeState = header.timestate;
+	m_linkedEventsQ = header.linked;
+	m_timemap.resize(header.timemap);
+	for (uint64_t i=0; i<header.timemap; i++) {
+		int32_t tick;
+		memcpy(&tick, timeticks + 4 * i, 4);
+		m_timemap[i].tick = tick;
+		memcpy(&m_timemap[i].seconds, timeseconds + 16 * i, 8);
+		memcpy(&m_timemap[i].secondsPerTick, timeseconds + 16 * i + 8, 8);
+	}
+	m_timemapvalid = header.timemapvalid && !m_timemap.empty();
+	setFilename(sourcefile);
+	m_rwstatus = true;
+	return true;
+}
 
-		// first write the track ID marker "MTrk":
-		ch = 'M'; out << ch;
-		ch = 'T'; out << ch;
-		ch = 'r'; out << ch;
-		ch = 'k'; out << ch;
 
-		// A. write the size of the MIDI data to follow:
-		longdata = (int)trackdata.size();
-		writeBigEndianULong(out, longdata);
 
-		// B. write the actual data
-		out.write((char*)trackdata.data(), trackdata.size());
-	}
+//////////////////////////////
+//
+// MidiFile::getSourceKey -- Return the size and the modification time
+//    (in nanoseconds where the system records them) of a file, used to
+//    identify the source file of a cache.
+//
 
-	if (oldTimeState == TIME_STATE_ABSOLUTE) {
-		makeAbsoluteTicks();
+bool MidiFile::getSourceKey(const std::string& filename, uint64_t& size,
+		int64_t& time) {
+	struct stat info;
+	if (stat(filename.c_str(), &info) != 0) {
+		return false;
 	}
-
+	size = (uint64_t)info.st_size;
+#if defined(_WIN32)
+	time = (int64_t)info.st_mtime * 1000000000;
+#elif defined(__APPLE__)
+	time = (int64_t)info.st_mtimespec.tv_sec * 1000000000 +
+			info.st_mtimespec.tv_nsec;
+#else
+	time = (int64_t)info.st_mtim.tv_sec * 1000000000 + info.st_mtim.tv_nsec;
+#endif
 	return true;
 }
 
 
 
+//////////////////////////////
+//
+// MidiFile::getCacheSize -- Return the size of a message which starts with
+//    the given status byte, if writeCache() does not store it: 3 bytes for
+//    most channel messages, 2 bytes for patch changes and channel
+//    pressure, and -1 (stored) for any other message.
+//
+
+int MidiFile::getCacheSize(int status) {
+	if ((status < 0x80) || (status >= 0xf0)) {
+		return -1;
+	}
+	if ((status & 0xe0) == 0xc0) {
+		return 2;
+	}
+	return 3;
+}
+
+
+
 //////////////////////////////
 //
 // MidiFile::writeHex -- print the Standard MIDI file as a list of
@@ -723,12 +1846,115 @@ bool MidiFile::writeBinascWithComments(std::ostream& output) {
 
 //////////////////////////////
 //
-// MidiFile::status -- return the success flag from the last read or
-//    write (writeHex, writeBinasc).
+// MidiFile::status -- return the success flag from the last read or
+//    write (writeHex, writeBinasc).
+//
+
+bool MidiFile::status(void) const {
+	return m_rwstatus;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////
+//
+// multi-threading functions --
+//
+
+//////////////////////////////
+//
+// MidiFile::setThreadCount -- Set the number of threads which may be
+//    used to process tracks at the same time.  The default of 1 processes
+//    tracks one after another in the calling thread.  A count of 0 uses
+//    one thread for each hardware thread.  Used when reading and writing
+//    multi-track files, and by the functions which work on each track on
+//    its own: linkNotePairs(), clearLinks(), sortTracks() and
+//    markSequence().
+//
+
+void MidiFile::setThreadCount(int count) {
+	m_threadCount = count < 0 ? 0 : count;
+}
+
+
+
+//////////////////////////////
+//
+// MidiFile::getThreadCount -- Return the number of threads which may
+//    be used to process tracks (0 = all hardware threads).
+//
+
+int MidiFile::getThreadCount(void) const {
+	return m_threadCount;
+}
+
+
+
+//////////////////////////////
+//
+// MidiFile::runTrackTasks -- Call task(track) for every track.  When
+//    several threads are allowed, the tracks are processed concurrently
+//    on the shared thread pool, starting with the largest tracks so that
+//    one long track is not left for the end.  Otherwise the tracks are
+//    processed in order in the calling thread.  Tasks must only change
+//    their own track.
+//
+
+void MidiFile::runTrackTasks(const std::function<void(int)>& task) const {
+	int tracks = getTrackCount();
+	if ((getThreadCount() == 1) || (tracks < 2)) {
+		for (int i=0; i<tracks; i++) {
+			task(i);
+		}
+		return;
+	}
+	std::vector<int> order(tracks);
+	for (int i=0; i<tracks; i++) {
+		order[i] = i;
+	}
+	std::stable_sort(order.begin(), order.end(),
+		[this](int a, int b) {
+			return m_events[a]->size() > m_events[b]->size();
+		});
+	std::function<void(int)> ordered = [&](int index) {
+		task(order[index]);
+	};
+	MidiThreadPool::getSharedPool().run(tracks, ordered, m_threadCount);
+}
+
+
+///////////////////////////////////////////////////////////////////////////
+//
+// event storage functions --
+//
+
+//////////////////////////////
+//
+// MidiFile::setArenaStorage -- Place the events of files read after this
+//    call in large blocks (see MidiEventArena) rather than allocating each
+//    event separately.  This makes reading large files much faster, and
+//    deleting them somewhat faster (each event is still destroyed on its
+//    own).  The memory of deleted events is only returned when all of
+//    the events in their block have been deleted, so this is best suited
+//    to files which are not heavily edited.  Events added later, and the
+//    events of a file which can only be read partially, are always
+//    allocated separately.
+//
+
+void MidiFile::setArenaStorage(bool state) {
+	m_arenaQ = state;
+}
+
+
+
+//////////////////////////////
+//
+// MidiFile::getArenaStorage -- Returns true if events are read into
+//    blocks.
 //
 
-bool MidiFile::status(void) const {
-	return m_rwstatus;
+bool MidiFile::getArenaStorage(void) const {
+	return m_arenaQ;
 }
 
 
@@ -743,6 +1969,7 @@ bool MidiFile::status(void) const {
 //
 
 MidiEventList& MidiFile::operator[](int aTrack) {
+	unshareTrack(aTrack);
 	return *m_events[aTrack];
 }
 
@@ -751,6 +1978,20 @@ const MidiEventList& MidiFile::operator[](int aTrack) const {
 }
 
 
+
+//////////////////////////////
+//
+// MidiFile::isTrackShared -- Returns true if the track is shared with a
+//    copy of this MidiFile.  Copies of a MidiFile share their tracks until
+//    one of the files changes a track (or gets non-const access to it),
+//    at which point that file gets its own copy of the track.
+//
+
+bool MidiFile::isTrackShared(int aTrack) const {
+	return m_events[aTrack].use_count() > 1;
+}
+
+
 //////////////////////////////
 //
 // MidiFile::getTrackCount -- return the number of tracks in
@@ -787,6 +2028,7 @@ int MidiFile::size(void) const {
 
 void MidiFile::removeEmpties(void) {
 	for (int i=0; i<(int)m_events.size(); i++) {
+		unshareTrack(i);
 		m_events[i]->removeEmpties();
 	}
 }
@@ -803,14 +2045,22 @@ void MidiFile::removeEmpties(void) {
 //   be done automatically when a MIDI file is read, in case the
 //   ordering of m_events occuring at the same time is important.
 //   Use clearSequence() to use the default sorting behavior of
-//   sortTracks().
+//   sortTracks().  The numbers of each track start after those of the
+//   previous track, so the tracks can be numbered concurrently when
+//   several threads are allowed (see setThreadCount()).
 //
 
 void MidiFile::markSequence(void) {
+	// the first serial number of each track:
+	std::vector<int> sequences(getTrackCount());
 	int sequence = 1;
 	for (int i=0; i<getTrackCount(); i++) {
-		sequence = operator[](i).markSequence(sequence);
+		sequences[i] = sequence;
+		sequence += m_events[i]->getEventCount();
 	}
+	runTrackTasks([&](int track) {
+		operator[](track).markSequence(sequences[track]);
+	});
 }
 
 //
@@ -860,7 +2110,9 @@ void MidiFile::clearSequence(int track) {
 //   tracks into separate units again.  The style of the
 //   MidiFile when read from a file is with tracks split.
 //   The original track index is stored in the MidiEvent::track
-//   variable.
+//   variable.  Since each track is already in order, the events are
+//   put in order by a k-way merge of the tracks (see
+//   MidiEventList::sort()).
 //
 
 void MidiFile::joinTracks(void) {
@@ -872,6 +2124,7 @@ void MidiFile::joinTracks(void) {
 		return;
 	}
 
+	unshareTracks();
 	MidiEventList* joinedTrack;
 	joinedTrack = new MidiEventList;
 
@@ -895,9 +2148,9 @@ void MidiFile::joinTracks(void) {
 
 	clear_no_deallocate();
 
-	delete m_events[0];
+	m_events[0].reset();
 	m_events.resize(0);
-	m_events.push_back(joinedTrack);
+	m_events.emplace_back(joinedTrack);
 	sortTracks();
 	if (oldTimeState == TIME_STATE_DELTA) {
 		makeDeltaTicks();
@@ -937,11 +2190,12 @@ void MidiFile::splitTracks(void) {
 		return;
 	}
 
-	MidiEventList* olddata = m_events[0];
-	m_events[0] = NULL;
+	unshareTrack(0);
+	std::shared_ptr<MidiEventList> olddata = m_events[0];
+	m_events[0].reset();
 	m_events.resize(m_trackCount);
 	for (i=0; i<m_trackCount; i++) {
-		m_events[i] = new MidiEventList;
+		m_events[i].reset(new MidiEventList);
 	}
 
 	for (i=0; i<length; i++) {
@@ -950,7 +2204,6 @@ void MidiFile::splitTracks(void) {
 	}
 
 	olddata->detach();
-	delete olddata;
 
 	if (oldTimeState == TIME_STATE_DELTA) {
 		makeDeltaTicks();
@@ -980,8 +2233,9 @@ void MidiFile::splitTracksByChannel(void) {
 
 	int maxTrack = 0;
 	int i;
-	MidiEventList& eventlist = *m_events[0];
-	MidiEventList* olddata = &eventlist;
+	unshareTrack(0);
+	std::shared_ptr<MidiEventList> olddata = m_events[0];
+	MidiEventList& eventlist = *olddata;
 	int length = eventlist.size();
 	for (i=0; i<length; i++) {
 		if (eventlist[i].size() == 0) {
@@ -1002,10 +2256,10 @@ void MidiFile::splitTracksByChannel(void) {
 		return;
 	}
 
-	m_events[0] = NULL;
+	m_events[0].reset();
 	m_events.resize(m_trackCount);
 	for (i=0; i<m_trackCount; i++) {
-		m_events[i] = new MidiEventList;
+		m_events[i].reset(new MidiEventList);
 	}
 
 	for (i=0; i<length; i++) {
@@ -1019,7 +2273,6 @@ void MidiFile::splitTracksByChannel(void) {
 	}
 
 	olddata->detach();
-	delete olddata;
 
 	if (oldTimeState == TIME_STATE_DELTA) {
 		makeDeltaTicks();
@@ -1118,6 +2371,7 @@ void MidiFile::makeDeltaTicks(void) {
 	int i, j;
 	int temp;
 	int length = getNumTracks();
+	unshareTracks();
 	int *timedata = new int[length];
 	for (i=0; i<length; i++) {
 		timedata[i] = 0;
@@ -1168,6 +2422,7 @@ void MidiFile::makeAbsoluteTicks(void) {
 	}
 	int i, j;
 	int length = getNumTracks();
+	unshareTracks();
 	int* timedata = new int[length];
 	for (i=0; i<length; i++) {
 		timedata[i] = 0;
@@ -1238,25 +2493,29 @@ bool MidiFile::isAbsoluteTicks(void) const {
 //    before calling this function, since this function
 //    assumes that the last MidiEvent in the track has the
 //    highest tick timestamp.  The file state can be in delta
-//    ticks since this function will temporarily go to absolute
-//    tick mode for the calculation of the max tick.
+//    ticks, in which case the delta ticks of each track are
+//    added up (the file is not changed).
 //
 
 int MidiFile::getFileDurationInTicks(void) {
-	bool revertToDelta = false;
-	if (isDeltaTicks()) {
-		makeAbsoluteTicks();
-		revertToDelta = true;
-	}
 	const MidiFile& mf = *this;
 	int output = 0;
 	for (int i=0; i<mf.getTrackCount(); i++) {
-		if (mf[i].back().tick > output) {
-			output = mf[i].back().tick;
+		const MidiEventList& events = mf[i];
+		if (events.getEventCount() == 0) {
+			continue;
+		}
+		int tick = 0;
+		if (isDeltaTicks()) {
+			for (int j=0; j<events.getEventCount(); j++) {
+				tick += events[j].tick;
+			}
+		} else {
+			tick = events.back().tick;
+		}
+		if (tick > output) {
+			output = tick;
 		}
-	}
-	if (revertToDelta) {
-		deltaTicks();
 	}
 	return output;
 }
@@ -1281,12 +2540,9 @@ double MidiFile::getFileDurationInQuarters(void) {
 //////////////////////////////
 //
 // MidiFile::getFileDurationInSeconds -- returns the duration of the
-//    logest track in the file.  The tracks must be sorted before
-//    calling this function, since this function assumes that the
-//    last MidiEvent in the track has the highest timestamp.
-//    The file state can be in delta ticks since this function
-//    will temporarily go to absolute tick mode for the calculation
-//    of the max time.
+//    logest track in the file: the time of the last tick in the
+//    time map, which is built from a MidiTimeline over the tracks.
+//    The file state can be in delta ticks, and is not changed.
 
 double MidiFile::getFileDurationInSeconds(void) {
 	if (m_timemapvalid == 0) {
@@ -1295,22 +2551,10 @@ double MidiFile::getFileDurationInSeconds(void) {
 			return -1.0;    // something went wrong
 		}
 	}
-	bool revertToDelta = false;
-	if (isDeltaTicks()) {
-		makeAbsoluteTicks();
-		revertToDelta = true;
-	}
-	const MidiFile& mf = *this;
-	double output = 0.0;
-	for (int i=0; i<mf.getTrackCount(); i++) {
-		if (mf[i].back().seconds > output) {
-			output = mf[i].back().seconds;
-		}
-	}
-	if (revertToDelta) {
-		deltaTicks();
+	if (m_timemap.empty()) {
+		return 0.0;
 	}
-	return output;
+	return m_timemap.back().seconds;
 }
 
 
@@ -1335,11 +2579,17 @@ void MidiFile::doTimeAnalysis(void) {
 //////////////////////////////
 //
 // MidiFile::getTimeInSeconds -- return the time in seconds for
-//     the current message.
+//     the current message.  The tempo segment of the tick is found by
+//     binary search, and the time is calculated exactly from its tempo,
+//     giving the same value as the seconds of the events at that tick.
+//     Returns -1 for ticks before the start or after the end of the file.
 //
 
 double MidiFile::getTimeInSeconds(int aTrack, int anIndex) {
-	return getTimeInSeconds(getEvent(aTrack, anIndex).tick);
+	// Read the event through a const reference so that a track shared with
+	// a copy of the file is not copied.
+	const MidiFile& file = *this;
+	return getTimeInSeconds(file.getEvent(aTrack, anIndex).tick);
 }
 
 
@@ -1351,62 +2601,83 @@ double MidiFile::getTimeInSeconds(int tickvalue) {
 		}
 	}
 
-	_TickTime key;
-	key.tick    = tickvalue;
-	key.seconds = -1;
-
-	void* ptr = bsearch(&key, m_timemap.data(), m_timemap.size(),
-			sizeof(_TickTime), ticksearch);
-
-	if (ptr == NULL) {
-		// The specific tick value was not found, so do a linear
-		// search for the two tick values which occur before and
-		// after the tick value, and do a linear interpolation of
-		// the time in seconds values to figure out the final
-		// time in seconds.
-		// Since the code is not yet written, kill the program at this point:
-		return linearSecondInterpolationAtTick(tickvalue);
-	} else {
-		return ((_TickTime*)ptr)->seconds;
+	// give an error value of -1 if time is out of range of data.
+	if ((tickvalue < 0) || (tickvalue > m_timemap.back().tick)) {
+		return -1.0;
 	}
+	const _TempoSegment& segment = m_timemap[getSegmentAtTick(tickvalue)];
+	return segment.seconds + (tickvalue - segment.tick) * segment.secondsPerTick;
 }
 
 
 
 //////////////////////////////
 //
-// MidiFile::getAbsoluteTickTime -- return the tick value represented
-//    by the input time in seconds.  If there is not tick entry at
-//    the given time in seconds, then interpolate between two values.
+// MidiFile::getTimesInSeconds -- Convert a list of ticks into seconds in
+//    one pass over the time map, giving the same values as calling
+//    getTimeInSeconds() for each tick.  The ticks should be in ascending
+//    order; a tick which is smaller than the one before it is looked up
+//    again by binary search.
 //
 
-double MidiFile::getAbsoluteTickTime(double starttime) {
+void MidiFile::getTimesInSeconds(const std::vector<int>& ticks,
+		std::vector<double>& seconds) {
+	seconds.resize(ticks.size());
 	if (m_timemapvalid == 0) {
 		buildTimeMap();
 		if (m_timemapvalid == 0) {
-			if (m_timemapvalid == 0) {
-				return -1.0;    // something went wrong
+			std::fill(seconds.begin(), seconds.end(), -1.0);
+			return;
+		}
+	}
+
+	int last = (int)m_timemap.size() - 1;
+	int endtick = m_timemap[last].tick;
+	int index = 0;
+	for (int i=0; i<(int)ticks.size(); i++) {
+		int tick = ticks[i];
+		if ((tick < 0) || (tick > endtick)) {
+			seconds[i] = -1.0;
+			continue;
+		}
+		if (tick < m_timemap[index].tick) {
+			index = getSegmentAtTick(tick);
+		} else {
+			while ((index < last) && (m_timemap[index+1].tick <= tick)) {
+				index++;
 			}
 		}
+		const _TempoSegment& segment = m_timemap[index];
+		seconds[i] = segment.seconds + (tick - segment.tick) * segment.secondsPerTick;
 	}
+}
 
-	_TickTime key;
-	key.tick    = -1;
-	key.seconds = starttime;
 
-	void* ptr = bsearch(&key, m_timemap.data(), m_timemap.size(),
-			sizeof(_TickTime), secondsearch);
 
-	if (ptr == NULL) {
-		// The specific seconds value was not found, so do a linear
-		// search for the two time values which occur before and
-		// after the given time value, and do a linear interpolation of
-		// the time in tick values to figure out the final time in ticks.
-		return linearTickInterpolationAtSecond(starttime);
-	} else {
-		return ((_TickTime*)ptr)->tick;
+//////////////////////////////
+//
+// MidiFile::getAbsoluteTickTime -- return the tick value represented
+//    by the input time in seconds.  Times between ticks give fractional
+//    tick values, calculated from the tempo at that time.  Returns -1
+//    for times before the start or after the end of the file.
+//
+
+double MidiFile::getAbsoluteTickTime(double starttime) {
+	if (m_timemapvalid == 0) {
+		buildTimeMap();
+		if (m_timemapvalid == 0) {
+			return -1.0;    // something went wrong
+		}
 	}
 
+	if ((starttime < 0.0) || (starttime > m_timemap.back().seconds)) {
+		return -1.0;
+	}
+	const _TempoSegment& segment = m_timemap[getSegmentAtSeconds(starttime)];
+	if (segment.secondsPerTick <= 0.0) {
+		return segment.tick;
+	}
+	return segment.tick + (starttime - segment.seconds) / segment.secondsPerTick;
 }
 
 
@@ -1420,17 +2691,25 @@ double MidiFile::getAbsoluteTickTime(double starttime) {
 //
 // MidiFile::linkNotePairs --  Link note-ons to note-offs separately
 //     for each track.  Returns the total number of note message pairs
-//     that were linked.
+//     that were linked.  The tracks are linked concurrently when several
+//     threads are allowed (see setThreadCount()), with the same result.
 //
 
 int MidiFile::linkNotePairs(void) {
-	int i;
-	int sum = 0;
-	for (i=0; i<getTrackCount(); i++) {
-		if (m_events[i] == NULL) {
-			continue;
+	// Events may be linked to events in other tracks (after splitTracks()
+	// for example), so each track only removes the old links of its own
+	// events.
+	std::vector<int> counts(getTrackCount(), 0);
+	runTrackTasks([&](int track) {
+		if (m_events[track] == NULL) {
+			return;
 		}
-		sum += m_events[i]->linkNotePairs();
+		unshareTrack(track);
+		counts[track] = m_events[track]->linkNotePairs(false);
+	});
+	int sum = 0;
+	for (int i=0; i<(int)counts.size(); i++) {
+		sum += counts[i];
 	}
 	m_linkedEventsQ = true;
 	return sum;
@@ -1445,6 +2724,32 @@ int MidiFile::linkEventPairs(void) {
 }
 
 
+
+//////////////////////////////
+//
+// MidiFile::setLinkedNotePairs -- Record that the note pairs of all tracks
+//     have been linked by the caller (with the same pairing as
+//     linkNotePairs()), so that writeCache() stores the links without the
+//     tracks being linked again.
+//
+
+void MidiFile::setLinkedNotePairs(bool state) {
+	m_linkedEventsQ = state;
+}
+
+
+
+//////////////////////////////
+//
+// MidiFile::hasLinkedNotePairs -- Returns true if the note pairs of all
+//     tracks are linked (by linkNotePairs(), readCache() or the caller).
+//
+
+bool MidiFile::hasLinkedNotePairs(void) const {
+	return m_linkedEventsQ;
+}
+
+
 ///////////////////////////////////////////////////////////////////////////
 //
 // filename functions --
@@ -1491,6 +2796,7 @@ MidiEvent* MidiFile::addEvent(int aTrack, int aTick,
 	me->tick = aTick;
 	me->track = aTrack;
 	me->setMessage(midiData);
+	unshareTrack(aTrack);
 	m_events[aTrack]->push_back_no_copy(me);
 	return me;
 }
@@ -1502,30 +2808,35 @@ MidiEvent* MidiFile::addEvent(int aTrack, int aTick,
 // MidiFile::addEvent -- Some bug here when joinedTracks(), but track==1...
 //
 
-MidiEvent* MidiFile::addEvent(MidiEvent& mfevent) {
-	if (getTrackState() == TRACK_STATE_JOINED) {
-		m_events[0]->push_back(mfevent);
-		return &m_events[0]->back();
-	} else {
-		m_events.at(mfevent.track)->push_back(mfevent);
-		return &m_events.at(mfevent.track)->back();
-	}
+MidiEvent* MidiFile::addEvent(const MidiEvent& mfevent) {
+	return addEvent(mfevent.track, MidiEvent(mfevent));
 }
 
 //
-// Variant where the track is an input parameter:
+// Rvalue variant, which moves the message of mfevent into the track:
 //
 
-MidiEvent* MidiFile::addEvent(int aTrack, MidiEvent& mfevent) {
-	if (getTrackState() == TRACK_STATE_JOINED) {
-		m_events[0]->push_back(mfevent);
-      m_events[0]->back().track = aTrack;
-		return &m_events[0]->back();
-	} else {
-		m_events.at(aTrack)->push_back(mfevent);
-		m_events.at(aTrack)->back().track = aTrack;
-		return &m_events.at(aTrack)->back();
-	}
+MidiEvent* MidiFile::addEvent(MidiEvent&& mfevent) {
+	int aTrack = mfevent.track;
+	return addEvent(aTrack, std::move(mfevent));
+}
+
+//
+// Variants where the track is an input parameter:
+//
+
+MidiEvent* MidiFile::addEvent(int aTrack, const MidiEvent& mfevent) {
+	return addEvent(aTrack, MidiEvent(mfevent));
+}
+
+
+MidiEvent* MidiFile::addEvent(int aTrack, MidiEvent&& mfevent) {
+	int index = (getTrackState() == TRACK_STATE_JOINED) ? 0 : aTrack;
+	unshareTrack(index);
+	MidiEventList& events = *m_events.at(index);
+	events.push_back(std::move(mfevent));
+	events.back().track = aTrack;
+	return &events.back();
 }
 
 
@@ -1581,6 +2892,7 @@ MidiEvent* MidiFile::addText(int aTrack, int aTick, const std::string& text) {
 	MidiEvent* me = new MidiEvent;
 	me->makeText(text);
 	me->tick = aTick;
+	unshareTrack(aTrack);
 	m_events[aTrack]->push_back_no_copy(me);
 	return me;
 }
@@ -1596,6 +2908,7 @@ MidiEvent* MidiFile::addCopyright(int aTrack, int aTick, const std::string& text
 	MidiEvent* me = new MidiEvent;
 	me->makeCopyright(text);
 	me->tick = aTick;
+	unshareTrack(aTrack);
 	m_events[aTrack]->push_back_no_copy(me);
 	return me;
 }
@@ -1611,6 +2924,7 @@ MidiEvent* MidiFile::addTrackName(int aTrack, int aTick, const std::string& name
 	MidiEvent* me = new MidiEvent;
 	me->makeTrackName(name);
 	me->tick = aTick;
+	unshareTrack(aTrack);
 	m_events[aTrack]->push_back_no_copy(me);
 	return me;
 }
@@ -1627,6 +2941,7 @@ MidiEvent* MidiFile::addInstrumentName(int aTrack, int aTick,
 	MidiEvent* me = new MidiEvent;
 	me->makeInstrumentName(name);
 	me->tick = aTick;
+	unshareTrack(aTrack);
 	m_events[aTrack]->push_back_no_copy(me);
 	return me;
 }
@@ -1642,6 +2957,7 @@ MidiEvent* MidiFile::addLyric(int aTrack, int aTick, const std::string& text) {
 	MidiEvent* me = new MidiEvent;
 	me->makeLyric(text);
 	me->tick = aTick;
+	unshareTrack(aTrack);
 	m_events[aTrack]->push_back_no_copy(me);
 	return me;
 }
@@ -1657,6 +2973,7 @@ MidiEvent* MidiFile::addMarker(int aTrack, int aTick, const std::string& text) {
 	MidiEvent* me = new MidiEvent;
 	me->makeMarker(text);
 	me->tick = aTick;
+	unshareTrack(aTrack);
 	m_events[aTrack]->push_back_no_copy(me);
 	return me;
 }
@@ -1672,6 +2989,7 @@ MidiEvent* MidiFile::addCue(int aTrack, int aTick, const std::string& text) {
 	MidiEvent* me = new MidiEvent;
 	me->makeCue(text);
 	me->tick = aTick;
+	unshareTrack(aTrack);
 	m_events[aTrack]->push_back_no_copy(me);
 	return me;
 }
@@ -1687,6 +3005,7 @@ MidiEvent* MidiFile::addTempo(int aTrack, int aTick, double aTempo) {
 	MidiEvent* me = new MidiEvent;
 	me->makeTempo(aTempo);
 	me->tick = aTick;
+	unshareTrack(aTrack);
 	m_events[aTrack]->push_back_no_copy(me);
 	return me;
 }
@@ -1721,6 +3040,7 @@ MidiEvent* MidiFile::addTimeSignature(int aTrack, int aTick, int top, int bottom
 	MidiEvent* me = new MidiEvent;
 	me->makeTimeSignature(top, bottom, clocksPerClick, num32ndsPerQuarter);
 	me->tick = aTick;
+	unshareTrack(aTrack);
 	m_events[aTrack]->push_back_no_copy(me);
 	return me;
 }
@@ -1768,37 +3088,7 @@ int MidiFile::makeVLV(uchar *buffer, int number) {
 		return 1;
 	}
 
-	buffer[0] = (value >> 21) & 0x7f;
-	buffer[1] = (value >> 14) & 0x7f;
-	buffer[2] = (value >>  7) & 0x7f;
-	buffer[3] = (value >>  0) & 0x7f;
-
-	int i;
-	int flag = 0;
-	int length = -1;
-	for (i=0; i<3; i++) {
-		if (buffer[i] != 0) {
-			flag = 1;
-		}
-		if (flag) {
-			buffer[i] |= 0x80;
-		}
-		if (length == -1 && buffer[i] >= 0x80) {
-			length = 4-i;
-		}
-	}
-
-	if (length == -1) {
-		length = 1;
-	}
-
-	if (length < 4) {
-		for (i=0; i<length; i++) {
-			buffer[i] = buffer[4-length+i];
-		}
-	}
-
-	return length;
+	return MidiVlv::encode(value, buffer);
 }
 
 
@@ -1813,6 +3103,7 @@ MidiEvent* MidiFile::addNoteOn(int aTrack, int aTick, int aChannel, int key, int
 	MidiEvent* me = new MidiEvent;
 	me->makeNoteOn(aChannel, key, vel);
 	me->tick = aTick;
+	unshareTrack(aTrack);
 	m_events[aTrack]->push_back_no_copy(me);
 	return me;
 }
@@ -1829,6 +3120,7 @@ MidiEvent* MidiFile::addNoteOff(int aTrack, int aTick, int aChannel, int key,
 	MidiEvent* me = new MidiEvent;
 	me->makeNoteOff(aChannel, key, vel);
 	me->tick = aTick;
+	unshareTrack(aTrack);
 	m_events[aTrack]->push_back_no_copy(me);
 	return me;
 }
@@ -1845,6 +3137,7 @@ MidiEvent* MidiFile::addNoteOff(int aTrack, int aTick, int aChannel, int key) {
 	MidiEvent* me = new MidiEvent;
 	me->makeNoteOff(aChannel, key);
 	me->tick = aTick;
+	unshareTrack(aTrack);
 	m_events[aTrack]->push_back_no_copy(me);
 	return me;
 }
@@ -1862,6 +3155,7 @@ MidiEvent* MidiFile::addController(int aTrack, int aTick, int aChannel,
 	MidiEvent* me = new MidiEvent;
 	me->makeController(aChannel, num, value);
 	me->tick = aTick;
+	unshareTrack(aTrack);
 	m_events[aTrack]->push_back_no_copy(me);
 	return me;
 }
@@ -1879,6 +3173,7 @@ MidiEvent* MidiFile::addPatchChange(int aTrack, int aTick, int aChannel,
 	MidiEvent* me = new MidiEvent;
 	me->makePatchChange(aChannel, patchnum);
 	me->tick = aTick;
+	unshareTrack(aTrack);
 	m_events[aTrack]->push_back_no_copy(me);
 	return me;
 }
@@ -2011,7 +3306,7 @@ MidiEvent* MidiFile::addSustainPedalOff(int aTrack, int aTick, int aChannel) {
 int MidiFile::addTrack(void) {
 	int length = getNumTracks();
 	m_events.resize(length+1);
-	m_events[length] = new MidiEventList;
+	m_events[length].reset(new MidiEventList);
 	m_events[length]->reserve(10000);
 	m_events[length]->clear();
 	return length;
@@ -2022,7 +3317,7 @@ int MidiFile::addTrack(int count) {
 	m_events.resize(length+count);
 	int i;
 	for (i=0; i<count; i++) {
-		m_events[length + i] = new MidiEventList;
+		m_events[length + i].reset(new MidiEventList);
 		m_events[length + i]->reserve(10000);
 		m_events[length + i]->clear();
 	}
@@ -2048,6 +3343,7 @@ int MidiFile::addTracks(int count) {
 void MidiFile::allocateEvents(int track, int aSize) {
 	int oldsize = m_events[track]->size();
 	if (oldsize < aSize) {
+		unshareTrack(track);
 		m_events[track]->reserve(aSize);
 	}
 }
@@ -2068,12 +3364,12 @@ void MidiFile::deleteTrack(int aTrack) {
 	if (length == 1) {
 		return;
 	}
-	delete m_events[aTrack];
+	m_events[aTrack].reset();
 	for (int i=aTrack; i<length-1; i++) {
 		m_events[i] = m_events[i+1];
 	}
 
-	m_events[length-1] = NULL;
+	m_events[length-1].reset();
 	m_events.resize(length-1);
 }
 
@@ -2088,11 +3384,10 @@ void MidiFile::deleteTrack(int aTrack) {
 void MidiFile::clear(void) {
 	int length = getNumTracks();
 	for (int i=0; i<length; i++) {
-		delete m_events[i];
-		m_events[i] = NULL;
+		m_events[i].reset();
 	}
 	m_events.resize(1);
-	m_events[0] = new MidiEventList;
+	m_events[0].reset(new MidiEventList);
 	m_timemapvalid=0;
 	m_timemap.clear();
 	m_theTrackState = TRACK_STATE_SPLIT;
@@ -2113,6 +3408,7 @@ void MidiFile::erase(void) {
 //
 
 MidiEvent& MidiFile::getEvent(int aTrack, int anIndex) {
+	unshareTrack(aTrack);
 	return (*m_events[aTrack])[anIndex];
 }
 
@@ -2175,10 +3471,15 @@ int MidiFile::getNumEvents(int aTrack) const {
 //   track location listed, and Moving the other tracks
 //   in the file around to fill in the spot where Track2
 //   used to be.  The results of this function call cannot
-//   be reversed.
+//   be reversed.  The events are moved rather than copied, and
+//   the two tracks are merged in order (see MidiEventList::sort()).
 //
 
 void MidiFile::mergeTracks(int aTrack1, int aTrack2) {
+	if (aTrack1 == aTrack2) {
+		return;
+	}
+	unshareTracks();
 	MidiEventList* mergedTrack;
 	mergedTrack = new MidiEventList;
 	int oldTimeState = getTickState();
@@ -2186,19 +3487,23 @@ void MidiFile::mergeTracks(int aTrack1, int aTrack2) {
 		makeAbsoluteTicks();
 	}
 	int length = getNumTracks();
-	for (int i=0; i<(int)m_events[aTrack1]->size(); i++) {
-		mergedTrack->push_back((*m_events[aTrack1])[i]);
+	MidiEventList& track1 = *m_events[aTrack1];
+	MidiEventList& track2 = *m_events[aTrack2];
+	mergedTrack->reserve(track1.size() + track2.size());
+	for (int i=0; i<track1.size(); i++) {
+		mergedTrack->push_back_no_copy(&track1[i]);
 	}
-	for (int j=0; j<(int)m_events[aTrack2]->size(); j++) {
-		(*m_events[aTrack2])[j].track = aTrack1;
-		mergedTrack->push_back((*m_events[aTrack2])[j]);
+	for (int j=0; j<track2.size(); j++) {
+		track2[j].track = aTrack1;
+		mergedTrack->push_back_no_copy(&track2[j]);
 	}
+	// the events now belong to mergedTrack:
+	track1.detach();
+	track2.detach();
 
 	mergedTrack->sort();
 
-	delete m_events[aTrack1];
-
-	m_events[aTrack1] = mergedTrack;
+	m_events[aTrack1].reset(mergedTrack);
 
 	for (int i=aTrack2; i<length-1; i++) {
 		m_events[i] = m_events[i+1];
@@ -2207,7 +3512,7 @@ void MidiFile::mergeTracks(int aTrack1, int aTrack2) {
 		}
 	}
 
-	m_events[length-1] = NULL;
+	m_events[length-1].reset();
 	m_events.resize(length-1);
 
 	if (oldTimeState == TIME_STATE_DELTA) {
@@ -2267,6 +3572,7 @@ void MidiFile::setMillisecondTicks(void) {
 
 void MidiFile::sortTrack(int track) {
 	if ((track >= 0) && (track < getTrackCount())) {
+		unshareTrack(track);
 		m_events.at(track)->sort();
 	} else {
 		std::cerr << "Warning: track " << track << " does not exist." << std::endl;
@@ -2277,14 +3583,17 @@ void MidiFile::sortTrack(int track) {
 
 //////////////////////////////
 //
-// MidiFile::sortTracks -- sort all tracks in the MidiFile.
+// MidiFile::sortTracks -- sort all tracks in the MidiFile.  The tracks
+//     are sorted concurrently when several threads are allowed (see
+//     setThreadCount()).
 //
 
 void MidiFile::sortTracks(void) {
 	if (m_theTimeState == TIME_STATE_ABSOLUTE) {
-		for (int i=0; i<getTrackCount(); i++) {
-			m_events.at(i)->sort();
-		}
+		runTrackTasks([this](int track) {
+			unshareTrack(track);
+			m_events[track]->sort();
+		});
 	} else {
 		std::cerr << "Warning: Sorting only allowed in absolute tick mode.";
 	}
@@ -2319,16 +3628,19 @@ int MidiFile::getTrackCountAsType1(void) {
 
 //////////////////////////////
 //
-// MidiFile::clearLinks --
+// MidiFile::clearLinks -- remove the links of the events in all tracks,
+//     concurrently when several threads are allowed (see setThreadCount()).
 //
 
 void MidiFile::clearLinks(void) {
-	for (int i=0; i<getTrackCount(); i++) {
-		if (m_events[i] == NULL) {
-			continue;
+	// Each track only clears its own events (see linkNotePairs()).
+	runTrackTasks([this](int track) {
+		if (m_events[track] == NULL) {
+			return;
 		}
-		m_events[i]->clearLinks();
-	}
+		unshareTrack(track);
+		m_events[track]->clearLinks(false);
+	});
 	m_linkedEventsQ = false;
 }
 
@@ -2341,151 +3653,53 @@ void MidiFile::clearLinks(void) {
 
 //////////////////////////////
 //
-// MidiFile::linearTickInterpolationAtSecond -- return the tick value at the
-//    given input time.
+// MidiFile::getSegmentAtTick -- Return the index of the last entry of the
+//    time map which starts at or before the given tick (0 for earlier
+//    ticks).
 //
 
-double MidiFile::linearTickInterpolationAtSecond(double seconds) {
-	if (m_timemapvalid == 0) {
-		buildTimeMap();
-		if (m_timemapvalid == 0) {
-			return -1.0;    // something went wrong
-		}
-	}
-
-	int i;
-	double lasttime = m_timemap[m_timemap.size()-1].seconds;
-	// give an error value of -1 if time is out of range of data.
-	if (seconds < 0.0) {
-		return -1.0;
-	}
-	if (seconds > m_timemap[m_timemap.size()-1].seconds) {
-		return -1.0;
-	}
-
-	// Guess which side of the list is closest to target:
-	// Could do a more efficient algorithm since time values are sorted,
-	// but good enough for now...
-	int startindex = -1;
-	if (seconds < lasttime / 2) {
-		for (i=0; i<(int)m_timemap.size(); i++) {
-			if (m_timemap[i].seconds > seconds) {
-				startindex = i-1;
-				break;
-			} else if (m_timemap[i].seconds == seconds) {
-				startindex = i;
-				break;
-			}
-		}
-	} else {
-		for (i=(int)m_timemap.size()-1; i>0; i--) {
-			if (m_timemap[i].seconds < seconds) {
-				startindex = i+1;
-				break;
-			} else if (m_timemap[i].seconds == seconds) {
-				startindex = i;
-				break;
-			}
-		}
-	}
-
-	if (startindex < 0) {
-		return -1.0;
-	}
-	if (startindex >= (int)m_timemap.size()-1) {
-		return -1.0;
+int MidiFile::getSegmentAtTick(int tick) const {
+	auto after = std::upper_bound(m_timemap.begin(), m_timemap.end(), tick,
+			[](int value, const _TempoSegment& segment) {
+				return value < segment.tick;
+			});
+	if (after == m_timemap.begin()) {
+		return 0;
 	}
-
-	double x1 = m_timemap[startindex].seconds;
-	double x2 = m_timemap[startindex+1].seconds;
-	double y1 = m_timemap[startindex].tick;
-	double y2 = m_timemap[startindex+1].tick;
-	double xi = seconds;
-
-	return (xi-x1) * ((y2-y1)/(x2-x1)) + y1;
+	return (int)(after - m_timemap.begin()) - 1;
 }
 
 
 
 //////////////////////////////
 //
-// MidiFile::linearSecondInterpolationAtTick -- return the time in seconds
-//    value at the given input tick time. (Ticks input could be made double).
+// MidiFile::getSegmentAtSeconds -- Return the index of the last entry of
+//    the time map which starts at or before the given time in seconds
+//    (0 for earlier times).
 //
 
-double MidiFile::linearSecondInterpolationAtTick(int ticktime) {
-	if (m_timemapvalid == 0) {
-		buildTimeMap();
-		if (m_timemapvalid == 0) {
-			return -1.0;    // something went wrong
-		}
-	}
-
-	int i;
-	double lasttick = m_timemap[m_timemap.size()-1].tick;
-	// give an error value of -1 if time is out of range of data.
-	if (ticktime < 0.0) {
-		return -1;
-	}
-	if (ticktime > m_timemap.back().tick) {
-		return -1;  // don't try to extrapolate
-	}
-
-	// Guess which side of the list is closest to target:
-	// Could do a more efficient algorithm since time values are sorted,
-	// but good enough for now...
-	int startindex = -1;
-	if (ticktime < lasttick / 2) {
-		for (i=0; i<(int)m_timemap.size(); i++) {
-			if (m_timemap[i].tick > ticktime) {
-				startindex = i-1;
-				break;
-			} else if (m_timemap[i].tick == ticktime) {
-				startindex = i;
-				break;
-			}
-		}
-	} else {
-		for (i=(int)m_timemap.size()-1; i>0; i--) {
-			if (m_timemap[i].tick < ticktime) {
-				startindex = i;
-				break;
-			} else if (m_timemap[i].tick == ticktime) {
-				startindex = i;
-				break;
-			}
-		}
-	}
-
-	if (startindex < 0) {
-		return -1;
-	}
-	if (startindex >= (int)m_timemap.size()-1) {
-		return -1;
-	}
-
-	if (m_timemap[startindex].tick == ticktime) {
-		return m_timemap[startindex].seconds;
+int MidiFile::getSegmentAtSeconds(double seconds) const {
+	auto after = std::upper_bound(m_timemap.begin(), m_timemap.end(), seconds,
+			[](double value, const _TempoSegment& segment) {
+				return value < segment.seconds;
+			});
+	if (after == m_timemap.begin()) {
+		return 0;
 	}
-
-	double x1 = m_timemap[startindex].tick;
-	double x2 = m_timemap[startindex+1].tick;
-	double y1 = m_timemap[startindex].seconds;
-	double y2 = m_timemap[startindex+1].seconds;
-	double xi = ticktime;
-
-	return (xi-x1) * ((y2-y1)/(x2-x1)) + y1;
+	return (int)(after - m_timemap.begin()) - 1;
 }
 
 
 
 //////////////////////////////
 //
-// MidiFile::buildTimeMap -- build an index of the absolute tick values
-//      found in a MIDI file, and their corresponding time values in
-//      seconds, taking into consideration tempo change messages.  If no
+// MidiFile::buildTimeMap -- build the table of tempo segments of the
+//      MIDI file, and set the time in seconds of each event.  A segment
+//      starts at tick 0 and after each tempo change, and the ticks in it
+//      are converted exactly from the tempo of the segment.  If no
 //      tempo messages are given (or untill they are given, then the
-//      tempo is set to 120 beats per minute).  If SMPTE time code is
+//      tempo is set to 120 beats per minute).  A tempo message changes
+//      the tempo after its own tick.  If SMPTE time code is
 //      used, then ticks are actually time values.  So don't build
 //      a time map for SMPTE ticks, and just calculate the time in
 //      seconds from the tick value (1000 ticks per second SMPTE
@@ -2495,67 +3709,55 @@ double MidiFile::linearSecondInterpolationAtTick(int ticktime) {
 
 void MidiFile::buildTimeMap(void) {
 
-	// convert the MIDI file to absolute time representation
-	// in single track mode (and undo if the MIDI file was not
-	// in that state when this function was called.
-	//
-	int trackstate = getTrackState();
-	int timestate  = getTickState();
-
-	makeAbsoluteTicks();
-	joinTracks();
+	// The timeline merges the tracks in time order without joining them
+	// or changing the tick mode.  Tracks which are out of tick order are
+	// sorted first (joining and splitting the tracks used to do this).
+	for (int i=0; i<getTrackCount(); i++) {
+		if (isDeltaTicks()) {
+			break;
+		}
+		const MidiEventList& events = *m_events[i];
+		int count = events.getEventCount();
+		int j = 1;
+		while ((j < count) && (events[j-1].tick <= events[j].tick)) {
+			j++;
+		}
+		if (j < count) {
+			sortTrack(i);
+		}
+	}
+	unshareTracks();
 
-	int allocsize = getNumEvents(0);
-	m_timemap.reserve(allocsize+10);
 	m_timemap.clear();
-
-	_TickTime value;
-
-	int lasttick = 0;
-	int tickinit = 0;
-
-	int i;
-	int tpq = getTicksPerQuarterNote();
-	double defaultTempo = 120.0;
-	double secondsPerTick = 60.0 / (defaultTempo * tpq);
-
-	double lastsec = 0.0;
-	double cursec = 0.0;
-
-	for (i=0; i<getNumEvents(0); i++) {
-		int curtick = getEvent(0, i).tick;
-		getEvent(0, i).seconds = cursec;
-		if ((curtick > lasttick) || !tickinit) {
-			tickinit = 1;
-
-			// calculate the current time in seconds:
-			cursec = lastsec + (curtick - lasttick) * secondsPerTick;
-			getEvent(0, i).seconds = cursec;
-
-			// store the new tick to second mapping
-			value.tick = curtick;
-			value.seconds = cursec;
-			m_timemap.push_back(value);
-			lasttick   = curtick;
-			lastsec    = cursec;
+	MidiTimeline timeline(*this);
+	_TempoSegment segment;
+	segment.tick           = 0;
+	segment.seconds        = 0.0;
+	segment.secondsPerTick = timeline.getSecondsPerTick();
+	m_timemap.push_back(segment);
+
+	while (timeline.next()) {
+		segment.tick    = timeline.getTick();
+		segment.seconds = timeline.getSeconds();
+		MidiEvent& event = (*m_events[timeline.getTrack()])[timeline.getIndex()];
+		event.seconds = segment.seconds;
+		if (!event.isTempo()) {
+			continue;
 		}
-
-		// update the tempo if needed:
-		if (getEvent(0,i).isTempo()) {
-			secondsPerTick = getEvent(0,i).getTempoSPT(getTicksPerQuarterNote());
+		segment.secondsPerTick = timeline.getSecondsPerTick();
+		// Only the first entry can be after the tempo (when ticks have
+		// overflowed to negative values), and then it is not needed.
+		if (m_timemap.back().tick >= segment.tick) {
+			m_timemap.back() = segment;
+		} else {
+			m_timemap.push_back(segment);
 		}
 	}
 
-	// reset the states of the tracks or time values if necessary here:
-	if (timestate == TIME_STATE_DELTA) {
-		deltaTicks();
-	}
-	if (trackstate == TRACK_STATE_SPLIT) {
-		splitTracks();
-	}
+	// The end of the file (the last tick seen above):
+	m_timemap.push_back(segment);
 
 	m_timemapvalid = 1;
-
 }
 
 
@@ -2742,17 +3944,20 @@ int MidiFile::extractMidiData(std::istream& input, std::vector<uchar>& array,
 //
 
 ulong MidiFile::readVLValue(std::istream& input) {
-	uchar b[5] = {0};
+	ulong output = 0;
 
 	for (int i=0; i<5; i++) {
-		b[i] = readByte(input);
+		uchar byte = readByte(input);
 		if (!status()) { return m_rwstatus; }
-		if (b[i] < 0x80) {
-			break;
+		output = (output << 7) | (byte & 0x7f);
+		if (byte < 0x80) {
+			return output;
 		}
 	}
 
-	return unpackVLV(b[0], b[1], b[2], b[3], b[4]);
+	std::cerr << "VLV number is too large" << std::endl;
+	m_rwstatus = false;
+	return 0;
 }
 
 
@@ -2798,91 +4003,97 @@ ulong MidiFile::unpackVLV(uchar a, uchar b, uchar c, uchar d, uchar e) {
 //
 
 void MidiFile::writeVLValue(long aValue, std::vector<uchar>& outdata) {
-	uchar bytes[4] = {0};
-
+	if ((unsigned long)aValue < 0x80) {
+		outdata.push_back((uchar)aValue);
+		return;
+	}
 	if ((unsigned long)aValue >= (1 << 28)) {
 		std::cerr << "Error: number too large to convert to VLV" << std::endl;
 		aValue = 0x0FFFffff;
 	}
 
-	bytes[0] = (uchar)(((ulong)aValue >> 21) & 0x7f);  // most significant 7 bits
-	bytes[1] = (uchar)(((ulong)aValue >> 14) & 0x7f);
-	bytes[2] = (uchar)(((ulong)aValue >> 7)  & 0x7f);
-	bytes[3] = (uchar)(((ulong)aValue)       & 0x7f);  // least significant 7 bits
-
-	int start = 0;
-	while ((start<4) && (bytes[start] == 0))  start++;
-
-	for (int i=start; i<3; i++) {
-		bytes[i] = bytes[i] | 0x80;
-		outdata.push_back(bytes[i]);
-	}
-	outdata.push_back(bytes[3]);
+	uchar bytes[5];
+	int length = MidiVlv::encode((ulong)aValue, bytes);
+	outdata.insert(outdata.end(), bytes, bytes + length);
 }
 
 
 
 //////////////////////////////
 //
-// MidiFile::clear_no_deallocate -- Similar to clear() but does not
-//   delete the Events in the lists.  This is primarily used internally
-//   to the MidiFile class, so don't use unless you really know what you
-//   are doing (otherwise you will end up with memory leaks or
-//   segmentation faults).
+// MidiFile::unshareTrack -- Give this file its own copy of a track which
+//    is shared with other copies of the file, so that it can be changed.
+//    Links between events of the track are kept.
 //
 
-void MidiFile::clear_no_deallocate(void) {
-	for (int i=0; i<getTrackCount(); i++) {
-		m_events[i]->detach();
-		delete m_events[i];
-		m_events[i] = NULL;
+void MidiFile::unshareTrack(int aTrack) {
+	std::shared_ptr<MidiEventList>& track = m_events.at(aTrack);
+	if (track.use_count() <= 1) {
+		// Make the other files' last accesses to the track visible
+		// before it is changed.
+		std::atomic_thread_fence(std::memory_order_acquire);
+		return;
 	}
-	m_events.resize(1);
-	m_events[0] = new MidiEventList;
-	m_timemapvalid=0;
-	m_timemap.clear();
-	// m_events.resize(0);   // causes a memory leak [20150205 Jorden Thatcher]
+	const MidiEventList& events = *track;
+	std::shared_ptr<MidiEventList> copy(new MidiEventList(events));
+
+	// MidiEvent copies are not linked, so link the copies in the same way.
+	std::unordered_map<const MidiEvent*, int> indexes;
+	for (int i=0; i<events.size(); i++) {
+		if (events[i].isLinked()) {
+			indexes[&events[i]] = i;
+		}
+	}
+	for (auto& entry : indexes) {
+		auto found = indexes.find(events[entry.second].getLinkedEvent());
+		if ((found != indexes.end()) && (found->second > entry.second)) {
+			(*copy)[entry.second].linkEvent((*copy)[found->second]);
+		}
+	}
+	track = copy;
 }
 
 
 
 //////////////////////////////
 //
-// MidiFile::ticksearch -- for finding a tick entry in the time map.
+// MidiFile::unshareTracks -- Give this file its own copy of every shared
+//    track.
 //
 
-int MidiFile::ticksearch(const void* A, const void* B) {
-	_TickTime& a = *((_TickTime*)A);
-	_TickTime& b = *((_TickTime*)B);
-
-	if (a.tick < b.tick) {
-		return -1;
-	} else if (a.tick > b.tick) {
-		return 1;
+void MidiFile::unshareTracks(void) {
+	for (int i=0; i<getTrackCount(); i++) {
+		unshareTrack(i);
 	}
-	return 0;
 }
 
 
 
 //////////////////////////////
 //
-// MidiFile::secondsearch -- for finding a second entry in the time map.
+// MidiFile::clear_no_deallocate -- Similar to clear() but does not
+//   delete the Events in the lists.  This is primarily used internally
+//   to the MidiFile class, so don't use unless you really know what you
+//   are doing (otherwise you will end up with memory leaks or
+//   segmentation faults).
 //
 
-int MidiFile::secondsearch(const void* A, const void* B) {
-	_TickTime& a = *((_TickTime*)A);
-	_TickTime& b = *((_TickTime*)B);
-
-	if (a.seconds < b.seconds) {
-		return -1;
-	} else if (a.seconds > b.seconds) {
-		return 1;
+void MidiFile::clear_no_deallocate(void) {
+	// Events of shared tracks belong to the other files as well.
+	unshareTracks();
+	for (int i=0; i<getTrackCount(); i++) {
+		m_events[i]->detach();
+		m_events[i].reset();
 	}
-	return 0;
+	m_events.resize(1);
+	m_events[0].reset(new MidiEventList);
+	m_timemapvalid=0;
+	m_timemap.clear();
+	// m_events.resize(0);   // causes a memory leak [20150205 Jorden Thatcher]
 }
 
 
+
 ///////////////////////////////////////////////////////////////////////////
 //
 // Static functions:
@@ -0,0 +1,183 @@
+//
+// Creation Date: Fri Oct 16 09:12:40 JST 2026
+// Last Modified: Fri Oct 16 09:12:40 JST 2026
+// Filename:      midifile/src/MidiMemoryMap.cpp
+// Website:       http://midifile.sapp.org
+// Syntax:        C++11
+// vim:           ts=3 noexpandtab
+//
+// Description:   Read-only view of the bytes of a file on disk.  The file
+//                is memory-mapped where the operating system allows it,
+//                otherwise its contents are loaded into a private buffer.
+//
+
+#include "MidiMemoryMap.h"
+
+#include <fstream>
+
+#ifndef _WIN32
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+
+
+namespace smf {
+
+//////////////////////////////
+//
+// MidiMemoryMap::MidiMemoryMap -- Constructor.
+//
+
+MidiMemoryMap::MidiMemoryMap(void) {
+	// do nothing
+}
+
+
+MidiMemoryMap::MidiMemoryMap(const std::string& filename) {
+	open(filename);
+}
+
+
+
+//////////////////////////////
+//
+// MidiMemoryMap::~MidiMemoryMap -- Deconstructor.  Release the mapping.
+//
+
+MidiMemoryMap::~MidiMemoryMap() {
+	close();
+}
+
+
+
+//////////////////////////////
+//
+// MidiMemoryMap::open -- Attach the contents of a file.  Returns false if
+//    the file could not be opened.  An empty file is opened successfully
+//    with a size of zero.
+//
+
+bool MidiMemoryMap::open(const std::string& filename) {
+	close();
+
+#ifndef _WIN32
+	int fd = ::open(filename.c_str(), O_RDONLY);
+	if (fd < 0) {
+		return false;
+	}
+	struct stat info;
+	if ((fstat(fd, &info) != 0) || !S_ISREG(info.st_mode)) {
+		::close(fd);
+		return false;
+	}
+	m_size = (size_t)info.st_size;
+	if (m_size == 0) {
+		::close(fd);
+		m_openQ = true;
+		return true;
+	}
+	void* pages = mmap(NULL, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if (pages != MAP_FAILED) {
+		madvise(pages, m_size, MADV_SEQUENTIAL);
+		m_data    = (const uchar*)pages;
+		m_mappedQ = true;
+		m_openQ   = true;
+		return true;
+	}
+	m_size = 0;
+#endif
+
+	// The file cannot be mapped, so read it into memory instead.
+	std::ifstream input(filename.c_str(), std::ios::binary | std::ios::in);
+	if (!input.is_open()) {
+		return false;
+	}
+	input.seekg(0, std::ios::end);
+	std::streamoff length = input.tellg();
+	input.seekg(0, std::ios::beg);
+	if (length > 0) {
+		m_buffer.resize((size_t)length);
+		input.read((char*)m_buffer.data(), length);
+		m_buffer.resize((size_t)input.gcount());
+	}
+	m_data  = m_buffer.data();
+	m_size  = m_buffer.size();
+	m_openQ = true;
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// MidiMemoryMap::close -- Detach the current file, if any.
+//
+
+void MidiMemoryMap::close(void) {
+#ifndef _WIN32
+	if (m_mappedQ) {
+		munmap((void*)m_data, m_size);
+	}
+#endif
+	m_buffer.clear();
+	m_buffer.shrink_to_fit();
+	m_data    = NULL;
+	m_size    = 0;
+	m_mappedQ = false;
+	m_openQ   = false;
+}
+
+
+
+//////////////////////////////
+//
+// MidiMemoryMap::isOpen -- Returns true if a file is attached.
+//
+
+bool MidiMemoryMap::isOpen(void) const {
+	return m_openQ;
+}
+
+
+
+//////////////////////////////
+//
+// MidiMemoryMap::isMapped -- Returns true if the file contents are
+//    memory-mapped rather than copied into a buffer.
+//
+
+bool MidiMemoryMap::isMapped(void) const {
+	return m_mappedQ;
+}
+
+
+
+//////////////////////////////
+//
+// MidiMemoryMap::data -- Returns the first byte of the file (NULL if
+//    the file is empty or not open).
+//
+
+const uchar* MidiMemoryMap::data(void) const {
+	return m_data;
+}
+
+
+
+//////////////////////////////
+//
+// MidiMemoryMap::size -- Returns the number of bytes in the file.
+//
+
+size_t MidiMemoryMap::size(void) const {
+	return m_size;
+}
+
+
+} // end namespace smf
+
+
+
@@ -25,45 +25,51 @@ namespace smf {
 // MidiMessage::MidiMessage -- Constructor.
 //
 
-MidiMessage::MidiMessage(void) : vector<uchar>() {
+MidiMessage::MidiMessage(void) : MidiByteVector() {
 	// do nothing
 }
 
 
-MidiMessage::MidiMessage(int command) : vector<uchar>(1, (uchar)command) {
+MidiMessage::MidiMessage(int command) : MidiByteVector(1, (uchar)command) {
 	// do nothing
 }
 
 
-MidiMessage::MidiMessage(int command, int p1) : vector<uchar>(2) {
+MidiMessage::MidiMessage(int command, int p1) : MidiByteVector(2) {
 	(*this)[0] = (uchar)command;
 	(*this)[1] = (uchar)p1;
 }
 
 
-MidiMessage::MidiMessage(int command, int p1, int p2) : vector<uchar>(3) {
+MidiMessage::MidiMessage(int command, int p1, int p2) : MidiByteVector(3) {
 	(*this)[0] = (uchar)command;
 	(*this)[1] = (uchar)p1;
 	(*this)[2] = (uchar)p2;
 }
 
 
-MidiMessage::MidiMessage(const MidiMessage& message) : vector<uchar>() {
-	(*this) = message;
+MidiMessage::MidiMessage(const MidiMessage& message) : MidiByteVector(message) {
+	// do nothing
+}
+
+
+MidiMessage::MidiMessage(MidiMessage&& message) noexcept
+		: MidiByteVector(std::move(message)) {
+	// do nothing
 }
 
 
-MidiMessage::MidiMessage(const std::vector<uchar>& message) : vector<uchar>() {
+MidiMessage::MidiMessage(const std::vector<uchar>& message) : MidiByteVector() {
 	setMessage(message);
 }
 
 
-MidiMessage::MidiMessage(const std::vector<char>& message) : vector<uchar>() {
+MidiMessage::MidiMessage(const std::vector<char>& message) : MidiByteVector() {
 	setMessage(message);
 }
 
 
-MidiMessage::MidiMessage(const std::vector<int>& message) : vector<uchar>() {
+MidiMessage::MidiMessage(const std::vector<int>& message) : MidiByteVector() {
 	setMessage(message);
 }
 
@@ -86,18 +92,18 @@ MidiMessage::~MidiMessage() {
 //
 
 MidiMessage& MidiMessage::operator=(const MidiMessage& message) {
-	if (this == &message) {
-		return *this;
-	}
-    (*this) = std::vector<uchar>(message);
+	MidiByteVector::operator=(message);
+	return *this;
+}
+
+
+MidiMessage& MidiMessage::operator=(MidiMessage&& message) noexcept {
+	MidiByteVector::operator=(std::move(message));
 	return *this;
 }
 
 
 MidiMessage& MidiMessage::operator=(const std::vector<uchar>& bytes) {
-	if (this == &bytes) {
-		return *this;
-	}
 	setMessage(bytes);
 	return *this;
 }
@@ -276,6 +282,70 @@ double MidiMessage::getTempoSPT(int tpq) const {
 
 
 
+//////////////////////////////
+//
+// MidiMessage::classify -- Work out the KIND_* value of the message from
+//     its bytes.  Use getKind(), which remembers the result.
+//
+
+int MidiMessage::classify(void) const {
+	if (empty()) {
+		return KIND_EMPTY;
+	}
+	const uchar* bytes = data();
+	int status = bytes[0];
+	if (status == 0xff) {
+		if (size() < 3) {
+			// meta message is ill-formed.
+			// meta messages must have at least three bytes:
+			//    0: 0xff == meta message marker
+			//    1: meta message type
+			//    2: meta message data bytes to follow
+			return KIND_OTHER;
+		}
+		switch (bytes[1]) {
+			case 0x01: return KIND_TEXT;
+			case 0x02: return KIND_COPYRIGHT;
+			case 0x03: return KIND_TRACK_NAME;
+			case 0x04: return KIND_INSTRUMENT_NAME;
+			case 0x05: return KIND_LYRIC;
+			case 0x06: return KIND_MARKER;
+			case 0x2f: return KIND_END_OF_TRACK;
+			// tempo, time signature and key signature messages have a
+			// fixed length:
+			case 0x51: return size() == 6 ? KIND_TEMPO : KIND_META;
+			case 0x58: return size() == 7 ? KIND_TIME_SIGNATURE : KIND_META;
+			case 0x59: return size() == 5 ? KIND_KEY_SIGNATURE : KIND_META;
+		}
+		return KIND_META;
+	}
+	if ((status == 0xf0) || (status == 0xf7)) {
+		return KIND_SYSEX;
+	}
+	switch (status & 0xf0) {
+		case 0x80:
+			return size() == 3 ? KIND_NOTE_OFF : KIND_OTHER;
+		case 0x90:
+			if (size() != 3) {
+				return KIND_OTHER;
+			}
+			return bytes[2] == 0 ? KIND_NOTE_OFF : KIND_NOTE_ON;
+		case 0xa0:
+			return size() == 3 ? KIND_AFTERTOUCH : KIND_OTHER;
+		case 0xb0:
+			return size() == 3 ? KIND_CONTROLLER : KIND_OTHER;
+		case 0xc0:
+			return size() == 2 ? KIND_PATCH_CHANGE : KIND_OTHER;
+		case 0xd0:
+			return size() == 2 ? KIND_PRESSURE : KIND_OTHER;
+		case 0xe0:
+			return size() == 3 ? KIND_PITCHBEND : KIND_OTHER;
+	}
+	return KIND_OTHER;
+}
+
+
+
 //////////////////////////////
 //
 // MidiMessage::isMeta -- Returns true if message is a Meta message
@@ -283,20 +353,7 @@ double MidiMessage::getTempoSPT(int tpq) const {
 //
 
 bool MidiMessage::isMeta(void) const {
-	if (size() == 0) {
-		return false;
-	} else if ((*this)[0] != 0xff) {
-		return false;
-	} else if (size() < 3) {
-		// meta message is ill-formed.
-		// meta messages must have at least three bytes:
-		//    0: 0xff == meta message marker
-		//    1: meta message type
-		//    2: meta message data bytes to follow
-		return false;
-	} else {
-		return true;
-	}
+	return getKind() >= KIND_META;
 }
 
 
@@ -313,15 +370,7 @@ bool MidiMessage::isMetaMessage(void) const {
 //
 
 bool MidiMessage::isNoteOff(void) const {
-	if (size() != 3) {
-		return false;
-	} else if (((*this)[0] & 0xf0) == 0x80) {
-		return true;
-	} else if ((((*this)[0] & 0xf0) == 0x90) && ((*this)[2] == 0)) {
-		return true;
-	} else {
-		return false;
-	}
+	return getKind() == KIND_NOTE_OFF;
 }
 
 
@@ -333,15 +382,7 @@ bool MidiMessage::isNoteOff(void) const {
 //
 
 bool MidiMessage::isNoteOn(void) const {
-	if (size() != 3) {
-		return false;
-	} else if (((*this)[0] & 0xf0) != 0x90) {
-		return false;
-	} else if ((*this)[2] == 0) {
-		return false;
-	} else {
-		return true;
-	}
+	return getKind() == KIND_NOTE_ON;
 }
 
 
@@ -353,7 +394,8 @@ bool MidiMessage::isNoteOn(void) const {
 //
 
 bool MidiMessage::isNote(void) const {
-	return isNoteOn() || isNoteOff();
+	int kind = getKind();
+	return (kind == KIND_NOTE_ON) || (kind == KIND_NOTE_OFF);
 }
 
 
@@ -365,13 +407,7 @@ bool MidiMessage::isNote(void) const {
 //
 
 bool MidiMessage::isAftertouch(void) const {
-	if (size() != 3) {
-		return false;
-	} else if (((*this)[0] & 0xf0) != 0xA0) {
-		return false;
-	} else {
-		return true;
-	}
+	return getKind() == KIND_AFTERTOUCH;
 }
 
 
@@ -383,13 +419,7 @@ bool MidiMessage::isAftertouch(void) const {
 //
 
 bool MidiMessage::isController(void) const {
-	if (size() != 3) {
-		return false;
-	} else if (((*this)[0] & 0xf0) != 0xB0) {
-		return false;
-	} else {
-		return true;
-	}
+	return getKind() == KIND_CONTROLLER;
 }
 
 
@@ -515,13 +545,7 @@ bool MidiMessage::isSoftOff(void) const {
 //
 
 bool MidiMessage::isTimbre(void) const {
-	if (((*this)[0] & 0xf0) != 0xc0) {
-		return false;
-	} else if (size() != 2) {
-		return false;
-	} else {
-		return true;
-	}
+	return getKind() == KIND_PATCH_CHANGE;
 }
 
 
@@ -538,13 +562,7 @@ bool MidiMessage::isPatchChange(void) const {
 //
 
 bool MidiMessage::isPressure(void) const {
-	if (((*this)[0] & 0xf0) != 0xd0) {
-		return false;
-	} else if (size() != 2) {
-		return false;
-	} else {
-		return true;
-	}
+	return getKind() == KIND_PRESSURE;
 }
 
 
@@ -556,13 +574,7 @@ bool MidiMessage::isPressure(void) const {
 //
 
 bool MidiMessage::isPitchbend(void) const {
-	if (((*this)[0] & 0xf0) != 0xe0) {
-		return false;
-	} else if (size() != 3) {
-		return false;
-	} else {
-		return true;
-	}
+	return getKind() == KIND_PITCHBEND;
 }
 
 
@@ -602,13 +614,7 @@ int MidiMessage::getMetaType(void) const {
 //
 
 bool MidiMessage::isText(void) const {
-	if (!isMetaMessage()) {
-		return false;
-	} else if ((*this)[1] != 0x01) {
-		return false;
-	} else {
-		return true;
-	}
+	return getKind() == KIND_TEXT;
 }
 
 
@@ -623,13 +629,7 @@ bool MidiMessage::isText(void) const {
 //
 
 bool MidiMessage::isCopyright(void) const {
-	if (!isMetaMessage()) {
-		return false;
-	} else if ((*this)[1] != 0x02) {
-		return false;
-	} else {
-		return true;
-	}
+	return getKind() == KIND_COPYRIGHT;
 }
 
 
@@ -641,13 +641,7 @@ bool MidiMessage::isCopyright(void) const {
 //
 
 bool MidiMessage::isTrackName(void) const {
-	if (!isMetaMessage()) {
-		return false;
-	} else if ((*this)[1] != 0x03) {
-		return false;
-	} else {
-		return true;
-	}
+	return getKind() == KIND_TRACK_NAME;
 }
 
 
@@ -660,13 +654,7 @@ bool MidiMessage::isTrackName(void) const {
 //
 
 bool MidiMessage::isInstrumentName(void) const {
-	if (!isMetaMessage()) {
-		return false;
-	} else if ((*this)[1] != 0x04) {
-		return false;
-	} else {
-		return true;
-	}
+	return getKind() == KIND_INSTRUMENT_NAME;
 }
 
 
@@ -679,13 +667,7 @@ bool MidiMessage::isInstrumentName(void) const {
 //
 
 bool MidiMessage::isLyricText(void) const {
-	if (!isMetaMessage()) {
-		return false;
-	} else if ((*this)[1] != 0x05) {
-		return false;
-	} else {
-		return true;
-	}
+	return getKind() == KIND_LYRIC;
 }
 
 
@@ -697,13 +679,7 @@ bool MidiMessage::isLyricText(void) const {
 //
 
 bool MidiMessage::isMarkerText(void) const {
-	if (!isMetaMessage()) {
-		return false;
-	} else if ((*this)[1] != 0x06) {
-		return false;
-	} else {
-		return true;
-	}
+	return getKind() == KIND_MARKER;
 }
 
 
@@ -715,16 +691,7 @@ bool MidiMessage::isMarkerText(void) const {
 //
 
 bool MidiMessage::isTempo(void) const {
-	if (!isMetaMessage()) {
-		return false;
-	} else if ((*this)[1] != 0x51) {
-		return false;
-	} else if (size() != 6) {
-		// Meta tempo message can only be 6 bytes long.
-		return false;
-	} else {
-		return true;
-	}
+	return getKind() == KIND_TEMPO;
 }
 
 
@@ -737,17 +704,7 @@ bool MidiMessage::isTempo(void) const {
 //
 
 bool MidiMessage::isTimeSignature(void) const {
-	if (!isMetaMessage()) {
-		return false;
-	} else if ((*this)[1] != 0x58) {
-		return false;
-	} else if (size() != 7) {
-		// Meta time signature message can only be 7 bytes long:
-		// FF 58 <size> <top> <bot-log-2> <clocks-per-beat> <32nds>
-		return false;
-	} else {
-		return true;
-	}
+	return getKind() == KIND_TIME_SIGNATURE;
 }
 
 
@@ -760,17 +717,7 @@ bool MidiMessage::isTimeSignature(void) const {
 //
 
 bool MidiMessage::isKeySignature(void) const {
-	if (!isMetaMessage()) {
-		return false;
-	} else if ((*this)[1] != 0x59) {
-		return false;
-	} else if (size() != 5) {
-		// Meta key signature message can only be 5 bytes long:
-		// FF 59 <size> <accid> <mode>
-		return false;
-	} else {
-		return true;
-	}
+	return getKind() == KIND_KEY_SIGNATURE;
 }
 
 
@@ -781,7 +728,7 @@ bool MidiMessage::isKeySignature(void) const {
 //
 
 bool MidiMessage::isEndOfTrack(void) const {
-	return getMetaType() == 0x2f ? 1 : 0;
+	return getKind() == KIND_END_OF_TRACK;
 }
 
 
@@ -1199,10 +1146,7 @@ void MidiMessage::setParameters(int p1, int p2) {
 //
 
 void MidiMessage::setMessage(const std::vector<uchar>& message) {
-	this->resize(message.size());
-	for (int i=0; i<(int)this->size(); i++) {
-		(*this)[i] = message[i];
-	}
+	assign(message.data(), message.data() + message.size());
 }
 
 
@@ -1491,7 +1435,7 @@ void MidiMessage::getSpelling(int& base7, int& accidental) {
 //   message after the length (which is a variable-length-value).
 //
 
-std::string MidiMessage::getMetaContent(void) {
+std::string MidiMessage::getMetaContent(void) const {
 	std::string output;
 	if (!isMetaMessage()) {
 		return output;
@@ -0,0 +1,481 @@
+//
+// Creation Date: Sat Oct 17 10:12:48 JST 2026
+// Last Modified: Sat Oct 17 10:12:48 JST 2026
+// Filename:      midifile/src/MidiNoteTable.cpp
+// Website:       http://midifile.sapp.org
+// Syntax:        C++11
+// vim:           ts=3 noexpandtab
+//
+// Description:   Table of the notes in a MidiEventList or MidiFile, with
+//                one array per field (start tick, end tick, key, velocity,
+//                channel, track and note-on event index).  Notes are
+//                ordered by start tick, and lists of note indexes (views)
+//                can be selected and sorted without touching the events.
+//
+
+#include "MidiNoteTable.h"
+#include "MidiFile.h"
+
+#include <algorithm>
+#include <numeric>
+
+
+namespace smf {
+
+//////////////////////////////
+//
+// reorderColumn -- Put the elements of a column in the given order.
+//
+
+template <class T>
+static void reorderColumn(std::vector<T>& column,
+		const std::vector<int>& order) {
+	std::vector<T> sorted(column.size());
+	for (int i=0; i<(int)order.size(); i++) {
+		sorted[i] = column[order[i]];
+	}
+	column.swap(sorted);
+}
+
+
+
+//////////////////////////////
+//
+// MidiNoteTable::MidiNoteTable -- Constructor.
+//
+
+MidiNoteTable::MidiNoteTable(void) {
+	// do nothing
+}
+
+
+MidiNoteTable::MidiNoteTable(const MidiEventList& events) {
+	build(events);
+}
+
+
+MidiNoteTable::MidiNoteTable(const MidiFile& midifile) {
+	build(midifile);
+}
+
+
+
+//////////////////////////////
+//
+// MidiNoteTable::build -- Fill the table with the notes of a track or of
+//    all tracks in a file, which must be in absolute tick mode.  Note-offs
+//    are paired with note-ons in the same way as
+//    MidiEventList::linkNotePairs() (the last unmatched note-on of the same
+//    key and channel), but the events are not modified.  Note-ons without
+//    a note-off get a duration of 0, and isMatched() tells them apart
+//    from notes which really have a duration of 0.
+//
+
+void MidiNoteTable::build(const MidiEventList& events) {
+	clear();
+	addNotes(events);
+}
+
+
+void MidiNoteTable::build(const MidiFile& midifile) {
+	clear();
+	for (int i=0; i<midifile.getTrackCount(); i++) {
+		addNotes(midifile[i]);
+	}
+	if (midifile.getTrackCount() > 1) {
+		sortByStart();
+	}
+}
+
+
+
+//////////////////////////////
+//
+// MidiNoteTable::clear -- Remove all notes.
+//
+
+void MidiNoteTable::clear(void) {
+	m_start.clear();
+	m_end.clear();
+	m_key.clear();
+	m_velocity.clear();
+	m_channel.clear();
+	m_track.clear();
+	m_event.clear();
+	m_matched.clear();
+	m_maxDuration = 0;
+}
+
+
+
+//////////////////////////////
+//
+// MidiNoteTable::getNoteCount -- Return the number of notes.
+//
+
+int MidiNoteTable::getNoteCount(void) const {
+	return (int)m_start.size();
+}
+
+
+int MidiNoteTable::size(void) const {
+	return getNoteCount();
+}
+
+
+
+//////////////////////////////
+//
+// MidiNoteTable::empty -- Returns true if there are no notes.
+//
+
+bool MidiNoteTable::empty(void) const {
+	return m_start.empty();
+}
+
+
+
+//////////////////////////////
+//
+// MidiNoteTable::getStartTick -- Return the tick of the note-on.
+//
+
+int MidiNoteTable::getStartTick(int index) const {
+	return m_start[index];
+}
+
+
+
+//////////////////////////////
+//
+// MidiNoteTable::getEndTick -- Return the tick of the note-off (or of
+//    the note-on if there is no note-off).
+//
+
+int MidiNoteTable::getEndTick(int index) const {
+	return m_end[index];
+}
+
+
+
+//////////////////////////////
+//
+// MidiNoteTable::getTickDuration -- Return the length of the note in
+//    ticks.
+//
+
+int MidiNoteTable::getTickDuration(int index) const {
+	return m_end[index] - m_start[index];
+}
+
+
+
+//////////////////////////////
+//
+// MidiNoteTable::getKey -- Return the key number of the note.
+//
+
+int MidiNoteTable::getKey(int index) const {
+	return m_key[index];
+}
+
+
+
+//////////////////////////////
+//
+// MidiNoteTable::getVelocity -- Return the velocity of the note-on.
+//
+
+int MidiNoteTable::getVelocity(int index) const {
+	return m_velocity[index];
+}
+
+
+
+//////////////////////////////
+//
+// MidiNoteTable::getChannel -- Return the channel (0-15) of the note.
+//
+
+int MidiNoteTable::getChannel(int index) const {
+	return m_channel[index];
+}
+
+
+
+//////////////////////////////
+//
+// MidiNoteTable::getTrack -- Return the track of the note-on event.
+//
+
+int MidiNoteTable::getTrack(int index) const {
+	return m_track[index];
+}
+
+
+
+//////////////////////////////
+//
+// MidiNoteTable::getEventIndex -- Return the index of the note-on in its
+//    MidiEventList (in the track given by getTrack() when the table was
+//    built from a MidiFile).
+//
+
+int MidiNoteTable::getEventIndex(int index) const {
+	return m_event[index];
+}
+
+
+
+//////////////////////////////
+//
+// MidiNoteTable::isMatched -- Returns true if the note-on was paired with
+//    a note-off, and false if the note was left sounding.
+//
+
+bool MidiNoteTable::isMatched(int index) const {
+	return m_matched[index] != 0;
+}
+
+
+
+//////////////////////////////
+//
+// MidiNoteTable::getStartTicks -- Return the column of note-on ticks.
+//    The other column functions are similar.
+//
+
+const std::vector<int>& MidiNoteTable::getStartTicks(void) const {
+	return m_start;
+}
+
+
+const std::vector<int>& MidiNoteTable::getEndTicks(void) const {
+	return m_end;
+}
+
+
+const std::vector<uchar>& MidiNoteTable::getKeys(void) const {
+	return m_key;
+}
+
+
+const std::vector<uchar>& MidiNoteTable::getVelocities(void) const {
+	return m_velocity;
+}
+
+
+const std::vector<uchar>& MidiNoteTable::getChannels(void) const {
+	return m_channel;
+}
+
+
+const std::vector<int>& MidiNoteTable::getTracks(void) const {
+	return m_track;
+}
+
+
+const std::vector<int>& MidiNoteTable::getEventIndexes(void) const {
+	return m_event;
+}
+
+
+
+//////////////////////////////
+//
+// MidiNoteTable::getAllNotes -- Return a view of every note, in start
+//    tick order.
+//
+
+std::vector<int> MidiNoteTable::getAllNotes(void) const {
+	std::vector<int> view(m_start.size());
+	std::iota(view.begin(), view.end(), 0);
+	return view;
+}
+
+
+
+//////////////////////////////
+//
+// MidiNoteTable::getNotesInRange -- Return a view of the notes sounding
+//    between starttick and endtick (not including endtick), in start tick
+//    order.  Notes of zero duration are included if they start in the
+//    range.
+//
+
+std::vector<int> MidiNoteTable::getNotesInRange(int starttick,
+		int endtick) const {
+	std::vector<int> view;
+	// Notes starting before starttick - m_maxDuration have ended.
+	long earliest = (long)starttick - m_maxDuration;
+	auto first = std::lower_bound(m_start.begin(), m_start.end(), earliest);
+	auto last = std::lower_bound(first, m_start.end(), endtick);
+	int start = (int)(first - m_start.begin());
+	int stop = (int)(last - m_start.begin());
+	for (int i=start; i<stop; i++) {
+		if ((m_end[i] > starttick) || (m_start[i] >= starttick)) {
+			view.push_back(i);
+		}
+	}
+	return view;
+}
+
+
+
+//////////////////////////////
+//
+// MidiNoteTable::filter -- Return the notes (of a view, or of the whole
+//    table) for which test(index) is true, keeping their order.
+//
+
+std::vector<int> MidiNoteTable::filter(
+		const std::function<bool(int)>& test) const {
+	std::vector<int> view;
+	for (int i=0; i<(int)m_start.size(); i++) {
+		if (test(i)) {
+			view.push_back(i);
+		}
+	}
+	return view;
+}
+
+
+std::vector<int> MidiNoteTable::filter(const std::vector<int>& view,
+		const std::function<bool(int)>& test) const {
+	std::vector<int> output;
+	for (int i=0; i<(int)view.size(); i++) {
+		if (test(view[i])) {
+			output.push_back(view[i]);
+		}
+	}
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// MidiNoteTable::sort -- Sort a view by one of the NOTE_* fields.  Notes
+//    with the same value keep their order.
+//
+
+void MidiNoteTable::sort(std::vector<int>& view, int field,
+		bool descendingQ) const {
+	if (field == NOTE_START) {
+		// Avoid the switch in getField() for the most common case.
+		if (descendingQ) {
+			std::stable_sort(view.begin(), view.end(), [&](int a, int b) {
+				return m_start[a] > m_start[b];
+			});
+		} else {
+			std::stable_sort(view.begin(), view.end(), [&](int a, int b) {
+				return m_start[a] < m_start[b];
+			});
+		}
+		return;
+	}
+	if (descendingQ) {
+		std::stable_sort(view.begin(), view.end(), [&](int a, int b) {
+			return getField(a, field) > getField(b, field);
+		});
+	} else {
+		std::stable_sort(view.begin(), view.end(), [&](int a, int b) {
+			return getField(a, field) < getField(b, field);
+		});
+	}
+}
+
+
+///////////////////////////////////////////////////////////////////////////
+//
+// protected functions --
+//
+
+//////////////////////////////
+//
+// MidiNoteTable::addNotes -- Append the notes of a time-sorted list of
+//    events.
+//
+
+void MidiNoteTable::addNotes(const MidiEventList& events) {
+	// Table rows of the unmatched note-ons for each channel and key.
+	std::vector<std::vector<int>> noteons(16 * 128);
+
+	int count = events.getEventCount();
+	for (int i=0; i<count; i++) {
+		const MidiEvent& event = events[i];
+		int kind = event.getKind();
+		if ((kind != MidiMessage::KIND_NOTE_ON) &&
+				(kind != MidiMessage::KIND_NOTE_OFF)) {
+			continue;
+		}
+		int channel = event[0] & 0x0f;
+		int key = event[1] & 0x7f;
+		std::vector<int>& active = noteons[channel * 128 + key];
+		if (kind == MidiMessage::KIND_NOTE_ON) {
+			active.push_back((int)m_start.size());
+			m_start.push_back(event.tick);
+			m_end.push_back(event.tick);
+			m_key.push_back((uchar)key);
+			m_velocity.push_back(event[2]);
+			m_channel.push_back((uchar)channel);
+			m_track.push_back(event.track);
+			m_event.push_back(i);
+			m_matched.push_back(0);
+		} else if (!active.empty()) {
+			int row = active.back();
+			active.pop_back();
+			m_end[row] = event.tick;
+			m_matched[row] = 1;
+			m_maxDuration = std::max(m_maxDuration, event.tick - m_start[row]);
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// MidiNoteTable::sortByStart -- Put the rows in start tick order after
+//    appending several tracks.
+//
+
+void MidiNoteTable::sortByStart(void) {
+	std::vector<int> order = getAllNotes();
+	sort(order, NOTE_START);
+	reorderColumn(m_start, order);
+	reorderColumn(m_end, order);
+	reorderColumn(m_key, order);
+	reorderColumn(m_velocity, order);
+	reorderColumn(m_channel, order);
+	reorderColumn(m_track, order);
+	reorderColumn(m_event, order);
+	reorderColumn(m_matched, order);
+}
+
+
+
+//////////////////////////////
+//
+// MidiNoteTable::getField -- Return a field of a note by its NOTE_*
+//    number.
+//
+
+int MidiNoteTable::getField(int index, int field) const {
+	switch (field) {
+		case NOTE_START:    return m_start[index];
+		case NOTE_END:      return m_end[index];
+		case NOTE_DURATION: return m_end[index] - m_start[index];
+		case NOTE_KEY:      return m_key[index];
+		case NOTE_VELOCITY: return m_velocity[index];
+		case NOTE_CHANNEL:  return m_channel[index];
+		case NOTE_TRACK:    return m_track[index];
+	}
+	return 0;
+}
+
+
+} // end of namespace smf
+
+
+
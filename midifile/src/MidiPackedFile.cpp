@@ -0,0 +1,480 @@
+//
+// Creation Date: Sat Oct 17 15:02:37 JST 2026
+// Last Modified: Sat Oct 17 15:02:37 JST 2026
+// Filename:      midifile/src/MidiPackedFile.cpp
+// Website:       http://midifile.sapp.org
+// Syntax:        C++11
+// vim:           ts=3 noexpandtab
+//
+// Description:   Read-only, compact copy of the events of a MIDI file for
+//                keeping many files in memory at once.  Each event takes
+//                12 bytes (absolute tick, up to three message bytes and a
+//                note link); longer messages such as meta and system
+//                exclusive messages are kept in a side table.  Note-ons
+//                and note-offs are paired when the file is packed.
+//
+
+#include "MidiPackedFile.h"
+#include "MidiEventCursor.h"
+#include "MidiFile.h"
+
+#include <string.h>
+
+
+namespace smf {
+
+//////////////////////////////
+//
+// MidiPackedFile::MidiPackedFile -- Constructor.
+//
+
+MidiPackedFile::MidiPackedFile(void) {
+	clear();
+}
+
+
+MidiPackedFile::MidiPackedFile(const std::string& filename) {
+	read(filename);
+}
+
+
+MidiPackedFile::MidiPackedFile(const MidiFile& midifile) {
+	pack(midifile);
+}
+
+
+
+//////////////////////////////
+//
+// MidiPackedFile::read -- Pack the events of a MIDI file, read with a
+//    MidiEventCursor so that the file is never stored in a MidiFile.
+//    Returns false if the file cannot be read, in which case the object
+//    is left empty.
+//
+
+bool MidiPackedFile::read(const std::string& filename) {
+	clear();
+	MidiEventCursor cursor;
+	if (!cursor.open(filename)) {
+		return false;
+	}
+	m_tpq = cursor.getTicksPerQuarterNote();
+	MidiMessage message;
+	while (cursor.next()) {
+		while (getTrackCount() < cursor.getTrack()) {
+			endTrack();
+		}
+		cursor.getMessage(message);
+		appendEvent(cursor.getTick(), message.data(), (int)message.size());
+	}
+	if (!cursor.status()) {
+		clear();
+		return false;
+	}
+	while (getTrackCount() < cursor.getTrackCount()) {
+		endTrack();
+	}
+	// The number of events was not known while reading.
+	m_events.shrink_to_fit();
+	m_long.shrink_to_fit();
+	m_offsets.shrink_to_fit();
+	m_status = true;
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// MidiPackedFile::pack -- Replace the contents with the events of a
+//    MidiFile, in either tick mode.  The events of each track keep their
+//    order.  Joined tracks are packed as a single track.
+//
+
+void MidiPackedFile::pack(const MidiFile& midifile) {
+	clear();
+	m_tpq = midifile.getTicksPerQuarterNote();
+	int tracks = midifile.getTrackCount();
+	int total = 0;
+	for (int i=0; i<tracks; i++) {
+		total += midifile.getEventCount(i);
+	}
+	m_events.reserve(total);
+	m_tracks.reserve(tracks + 1);
+
+	bool absoluteQ = midifile.isAbsoluteTicks();
+	for (int i=0; i<tracks; i++) {
+		const MidiEventList& events = midifile[i];
+		int tick = 0;
+		for (int j=0; j<events.getEventCount(); j++) {
+			const MidiEvent& event = events[j];
+			tick = absoluteQ ? event.tick : tick + event.tick;
+			appendEvent(tick, event.data(), (int)event.size());
+		}
+		endTrack();
+	}
+	m_status = true;
+}
+
+
+
+//////////////////////////////
+//
+// MidiPackedFile::unpack -- Replace the contents of a MidiFile with the
+//    packed events, in absolute tick mode.  Note pairs are linked as they
+//    are in the packed file.
+//
+
+void MidiPackedFile::unpack(MidiFile& midifile) const {
+	midifile.clear();
+	midifile.setTicksPerQuarterNote(m_tpq);
+	if (getTrackCount() > 1) {
+		midifile.addTracks(getTrackCount() - 1);
+	}
+	for (int i=0; i<getTrackCount(); i++) {
+		MidiEventList& events = midifile[i];
+		int count = getEventCount(i);
+		events.reserve(count);
+		for (int j=0; j<count; j++) {
+			MidiEvent event;
+			const uchar* bytes = getBytes(i, j);
+			event.assign(bytes, bytes + getSize(i, j));
+			event.tick = getTick(i, j);
+			event.track = i;
+			events.push_back(std::move(event));
+		}
+		for (int j=0; j<count; j++) {
+			int link = getLinkedIndex(i, j);
+			if (link > j) {
+				events[j].linkEvent(events[link]);
+			}
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// MidiPackedFile::clear -- Remove all tracks and events.
+//
+
+void MidiPackedFile::clear(void) {
+	m_events.clear();
+	m_tracks.assign(1, 0);
+	m_long.clear();
+	m_offsets.assign(1, 0);
+	m_tpq = 120;
+	m_status = false;
+}
+
+
+
+//////////////////////////////
+//
+// MidiPackedFile::status -- Returns true if the last read() succeeded.
+//
+
+bool MidiPackedFile::status(void) const {
+	return m_status;
+}
+
+
+
+//////////////////////////////
+//
+// MidiPackedFile::getMemoryUsage -- Return the number of bytes allocated
+//    for the object.
+//
+
+size_t MidiPackedFile::getMemoryUsage(void) const {
+	return sizeof(*this)
+			+ m_events.capacity() * sizeof(PackedEvent)
+			+ m_tracks.capacity() * sizeof(uint32_t)
+			+ m_long.capacity()
+			+ m_offsets.capacity() * sizeof(uint32_t);
+}
+
+
+
+//////////////////////////////
+//
+// MidiPackedFile::getTrackCount -- Return the number of tracks.
+//
+
+int MidiPackedFile::getTrackCount(void) const {
+	return (int)m_tracks.size() - 1;
+}
+
+
+
+//////////////////////////////
+//
+// MidiPackedFile::getTicksPerQuarterNote -- Return the time division of
+//    the file.
+//
+
+int MidiPackedFile::getTicksPerQuarterNote(void) const {
+	return m_tpq;
+}
+
+
+int MidiPackedFile::getTPQ(void) const {
+	return getTicksPerQuarterNote();
+}
+
+
+
+//////////////////////////////
+//
+// MidiPackedFile::getEventCount -- Return the number of events in all
+//    tracks, or in one track.
+//
+
+int MidiPackedFile::getEventCount(void) const {
+	return (int)m_events.size();
+}
+
+
+int MidiPackedFile::getEventCount(int track) const {
+	return (int)(m_tracks[track + 1] - m_tracks[track]);
+}
+
+
+
+//////////////////////////////
+//
+// MidiPackedFile::getTick -- Return the absolute tick of an event.
+//
+
+int MidiPackedFile::getTick(int track, int index) const {
+	return (int)getEvent(track, index).m_tick;
+}
+
+
+
+//////////////////////////////
+//
+// MidiPackedFile::getSize -- Return the number of bytes in the message of
+//    an event.
+//
+
+int MidiPackedFile::getSize(int track, int index) const {
+	const PackedEvent& event = getEvent(track, index);
+	if (event.m_size != LONG_EVENT) {
+		return event.m_size;
+	}
+	return (int)(m_offsets[event.m_link + 1] - m_offsets[event.m_link]);
+}
+
+
+
+//////////////////////////////
+//
+// MidiPackedFile::getBytes -- Return the message bytes of an event.  The
+//    pointer is valid until the object is changed.
+//
+
+const uchar* MidiPackedFile::getBytes(int track, int index) const {
+	const PackedEvent& event = getEvent(track, index);
+	if (event.m_size != LONG_EVENT) {
+		return event.m_bytes;
+	}
+	return m_long.data() + m_offsets[event.m_link];
+}
+
+
+
+//////////////////////////////
+//
+// MidiPackedFile::getCommandByte -- Return the first byte of the message,
+//    or -1 if the message is empty.
+//
+
+int MidiPackedFile::getCommandByte(int track, int index) const {
+	if (getSize(track, index) < 1) {
+		return -1;
+	}
+	return getBytes(track, index)[0];
+}
+
+
+
+//////////////////////////////
+//
+// MidiPackedFile::getMessage -- Copy the message of an event.
+//
+
+void MidiPackedFile::getMessage(int track, int index,
+		MidiMessage& message) const {
+	const uchar* bytes = getBytes(track, index);
+	message.assign(bytes, bytes + getSize(track, index));
+}
+
+
+
+//////////////////////////////
+//
+// MidiPackedFile::isNoteOn -- Returns true for note-on messages with a
+//    velocity greater than 0, as MidiMessage::isNoteOn() does.
+//
+
+bool MidiPackedFile::isNoteOn(int track, int index) const {
+	const PackedEvent& event = getEvent(track, index);
+	return (event.m_size == 3) && ((event.m_bytes[0] & 0xf0) == 0x90)
+			&& (event.m_bytes[2] > 0);
+}
+
+
+
+//////////////////////////////
+//
+// MidiPackedFile::isNoteOff -- Returns true for note-off messages and
+//    note-ons with a velocity of 0, as MidiMessage::isNoteOff() does.
+//
+
+bool MidiPackedFile::isNoteOff(int track, int index) const {
+	const PackedEvent& event = getEvent(track, index);
+	if (event.m_size != 3) {
+		return false;
+	}
+	int command = event.m_bytes[0] & 0xf0;
+	return (command == 0x80) || ((command == 0x90) && (event.m_bytes[2] == 0));
+}
+
+
+
+//////////////////////////////
+//
+// MidiPackedFile::isMeta -- Returns true for meta messages.
+//
+
+bool MidiPackedFile::isMeta(int track, int index) const {
+	return (getSize(track, index) >= 3) && (getBytes(track, index)[0] == 0xff);
+}
+
+
+
+//////////////////////////////
+//
+// MidiPackedFile::getLinkedIndex -- Return the index of the note-off of a
+//    note-on (or of the note-on of a note-off) in the same track, or -1 if
+//    the note is not paired.  Notes are paired in the same way as
+//    MidiEventList::linkNotePairs(), but controllers are not linked.
+//
+
+int MidiPackedFile::getLinkedIndex(int track, int index) const {
+	const PackedEvent& event = getEvent(track, index);
+	if ((event.m_size == LONG_EVENT) || (event.m_link == 0)) {
+		return -1;
+	}
+	return index + event.m_link;
+}
+
+
+
+//////////////////////////////
+//
+// MidiPackedFile::getTickDuration -- Return the number of ticks between
+//    a note event and its pair, or 0 if it is not paired.
+//
+
+int MidiPackedFile::getTickDuration(int track, int index) const {
+	int link = getLinkedIndex(track, index);
+	if (link < 0) {
+		return 0;
+	}
+	int tick1 = getTick(track, index);
+	int tick2 = getTick(track, link);
+	return tick2 > tick1 ? tick2 - tick1 : tick1 - tick2;
+}
+
+
+///////////////////////////////////////////////////////////////////////////
+//
+// protected functions --
+//
+
+//////////////////////////////
+//
+// MidiPackedFile::appendEvent -- Add an event to the track being packed.
+//
+
+void MidiPackedFile::appendEvent(int tick, const uchar* bytes, int size) {
+	static_assert(sizeof(PackedEvent) == 12, "packed events take 12 bytes");
+	PackedEvent event;
+	memset(&event, 0, sizeof(event));
+	event.m_tick = (uint32_t)tick;
+	if (size <= 3) {
+		memcpy(event.m_bytes, bytes, size);
+		event.m_size = (uchar)size;
+	} else {
+		event.m_size = LONG_EVENT;
+		event.m_link = (int32_t)m_offsets.size() - 1;
+		m_long.insert(m_long.end(), bytes, bytes + size);
+		m_offsets.push_back((uint32_t)m_long.size());
+	}
+	m_events.push_back(event);
+}
+
+
+
+//////////////////////////////
+//
+// MidiPackedFile::endTrack -- Finish the track being packed, and pair
+//    its notes.
+//
+
+void MidiPackedFile::endTrack(void) {
+	m_tracks.push_back((uint32_t)m_events.size());
+	linkTrack(getTrackCount() - 1);
+}
+
+
+
+//////////////////////////////
+//
+// MidiPackedFile::linkTrack -- Pair each note-off with the last unpaired
+//    note-on of the same channel and key.
+//
+
+void MidiPackedFile::linkTrack(int track) {
+	// Indexes of the unpaired note-ons for each channel and key.
+	std::vector<std::vector<int>> noteons(16 * 128);
+
+	int count = getEventCount(track);
+	PackedEvent* events = m_events.data() + m_tracks[track];
+	for (int i=0; i<count; i++) {
+		if (isNoteOn(track, i)) {
+			int slot = (events[i].m_bytes[0] & 0x0f) * 128 + (events[i].m_bytes[1] & 0x7f);
+			noteons[slot].push_back(i);
+		} else if (isNoteOff(track, i)) {
+			int slot = (events[i].m_bytes[0] & 0x0f) * 128 + (events[i].m_bytes[1] & 0x7f);
+			if (noteons[slot].empty()) {
+				continue;
+			}
+			int noteon = noteons[slot].back();
+			noteons[slot].pop_back();
+			events[noteon].m_link = i - noteon;
+			events[i].m_link = noteon - i;
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// MidiPackedFile::getEvent -- Return an event by track and index.
+//
+
+const MidiPackedFile::PackedEvent& MidiPackedFile::getEvent(int track,
+		int index) const {
+	return m_events[m_tracks[track] + index];
+}
+
+
+} // end of namespace smf
+
+
+
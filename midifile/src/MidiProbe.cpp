@@ -0,0 +1,538 @@
+//
+// Creation Date: Fri Oct 16 19:48:10 JST 2026
+// Last Modified: Fri Oct 16 19:48:10 JST 2026
+// Filename:      midifile/src/MidiProbe.cpp
+// Website:       http://midifile.sapp.org
+// Syntax:        C++11
+// vim:           ts=3 noexpandtab
+//
+// Description:   Reads the header information of a Standard MIDI File
+//                (type, tracks, track names and sizes, first tempo and
+//                time signature) without storing its events.  Reading
+//                stops as soon as the requested information is found.
+//
+
+#include "MidiProbe.h"
+#include "Binasc.h"
+#include "MidiMemoryMap.h"
+#include "MidiTrackDecoder.h"
+
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string.h>
+
+
+namespace smf {
+
+//////////////////////////////
+//
+// MidiProbe::MidiProbe -- Constructor.
+//
+
+MidiProbe::MidiProbe(void) {
+	// do nothing
+}
+
+
+MidiProbe::MidiProbe(const std::string& filename, int fields) {
+	probe(filename, fields);
+}
+
+
+
+//////////////////////////////
+//
+// MidiProbe::probe -- Read the header of a MIDI file and the requested
+//    fields (a combination of the PROBE_* values).  Returns false if the
+//    file cannot be read.  Track names are only searched for at tick 0,
+//    and each track is only read until the requested tempo and time
+//    signature cannot occur any earlier, so usually only the start of
+//    each track is read.  Track sizes only require the chunk headers.
+//    default value: fields = PROBE_ALL.
+//
+//    The file is memory-mapped, so the skipped parts of the file are not
+//    read from the disk.
+//
+
+bool MidiProbe::probe(const std::string& filename, int fields) {
+	MidiMemoryMap mapping(filename);
+	if (!mapping.isOpen()) {
+		clear();
+		std::cerr << "Error: cannot read " << filename << std::endl;
+		return false;
+	}
+	if ((mapping.size() > 0) && (mapping.data()[0] == 'M')) {
+		return probe(mapping.data(), mapping.size(), fields);
+	}
+	std::ifstream input(filename.c_str(), std::ios::binary | std::ios::in);
+	return probe(input, fields);
+}
+
+//
+// istream version of probe().  The stream is read to the end (the
+// input may not be seekable), and binasc content is converted to
+// binary first.
+//
+
+bool MidiProbe::probe(std::istream& input, int fields) {
+	std::string contents;
+	if (input.peek() != 'M') {
+		std::stringstream binary;
+		Binasc binasc;
+		binasc.writeToBinary(binary, input);
+		contents = binary.str();
+	} else {
+		contents.assign(std::istreambuf_iterator<char>(input),
+				std::istreambuf_iterator<char>());
+	}
+	return probe((const uchar*)contents.data(), contents.size(), fields);
+}
+
+//
+// Memory version of probe().
+//
+
+bool MidiProbe::probe(const uchar* data, size_t size, int fields) {
+	clear();
+	m_fields = fields;
+	const uchar* ptr = data;
+	const uchar* end = data + size;
+	if (!readHeader(ptr, end)) {
+		return false;
+	}
+	m_trackSizes.resize(m_tracks, 0);
+	m_trackNames.resize(m_tracks);
+
+	for (int i=0; i<m_tracks; i++) {
+		if (!needTrack()) {
+			break;
+		}
+		if ((end - ptr < 8) || (memcmp(ptr, "MTrk", 4) != 0)) {
+			std::cerr << "Error: cannot find the header of track " << i
+			          << std::endl;
+			return false;
+		}
+		ulong chunksize = ((ulong)ptr[4] << 24) | (ptr[5] << 16) |
+				(ptr[6] << 8) | ptr[7];
+		ptr += 8;
+		size_t available = (size_t)(end - ptr);
+
+		// Check that the chunk ends with an end-of-track message and is
+		// followed by the next track.  Otherwise the chunk size is wrong,
+		// and the end of the track has to be found from its contents
+		// as in MidiFile::read().
+		bool validQ = (chunksize >= 4) && (chunksize <= available) &&
+				(memcmp(ptr + chunksize - 3, "\xff\x2f\x00", 3) == 0);
+		if (validQ && (i < m_tracks - 1)) {
+			validQ = (available - chunksize >= 4) &&
+					(memcmp(ptr + chunksize, "MTrk", 4) == 0);
+		}
+		if (!validQ) {
+			size_t used = 0;
+			if (!findTrackEnd(ptr, available, used)) {
+				std::cerr << "Error: cannot find the end of track " << i
+				          << std::endl;
+				return false;
+			}
+			chunksize = used;
+		}
+		if (m_fields & (PROBE_TRACK_NAMES | PROBE_TEMPO | PROBE_TIME_SIGNATURE)) {
+			scanTrack(i, ptr, chunksize);
+		}
+		m_trackSizes[i] = chunksize;
+		ptr += chunksize;
+	}
+
+	m_status = true;
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// MidiProbe::clear -- Forget the information of the last probed file.
+//
+
+void MidiProbe::clear(void) {
+	m_fields  = 0;
+	m_status  = false;
+	m_type    = 0;
+	m_tracks  = 0;
+	m_tpq     = 120;
+	m_trackSizes.clear();
+	m_trackNames.clear();
+	m_tempoQ        = false;
+	m_tempoTick     = 0;
+	m_tempo         = 500000;
+	m_timeSigQ      = false;
+	m_timeSigTick   = 0;
+	m_timeSigTop    = 4;
+	m_timeSigBottom = 4;
+}
+
+
+
+//////////////////////////////
+//
+// MidiProbe::status -- Returns true if the last file was probed
+//    successfully.
+//
+
+bool MidiProbe::status(void) const {
+	return m_status;
+}
+
+
+
+//////////////////////////////
+//
+// MidiProbe::getType -- Return the type of the MIDI file (0 or 1).
+//
+
+int MidiProbe::getType(void) const {
+	return m_type;
+}
+
+
+
+//////////////////////////////
+//
+// MidiProbe::getTrackCount -- Return the number of tracks given in the
+//    header of the file.
+//
+
+int MidiProbe::getTrackCount(void) const {
+	return m_tracks;
+}
+
+
+
+//////////////////////////////
+//
+// MidiProbe::getTicksPerQuarterNote -- Return the ticks per quarter note
+//    value from the header (SMPTE divisions are converted as in the
+//    MidiFile class).
+//
+
+int MidiProbe::getTicksPerQuarterNote(void) const {
+	return m_tpq;
+}
+
+//
+// Alias for getTicksPerQuarterNote().
+//
+
+int MidiProbe::getTPQ(void) const {
+	return getTicksPerQuarterNote();
+}
+
+
+
+//////////////////////////////
+//
+// MidiProbe::getTrackSize -- Return the number of bytes of track data
+//    (without the chunk header).  Returns 0 for tracks which were not
+//    reached.
+//
+
+ulong MidiProbe::getTrackSize(int track) const {
+	if ((track < 0) || (track >= (int)m_trackSizes.size())) {
+		return 0;
+	}
+	return m_trackSizes[track];
+}
+
+
+
+//////////////////////////////
+//
+// MidiProbe::getTrackName -- Return the first track name at tick 0 in
+//    the track, or an empty string if there is none.
+//
+
+std::string MidiProbe::getTrackName(int track) const {
+	if ((track < 0) || (track >= (int)m_trackNames.size())) {
+		return "";
+	}
+	return m_trackNames[track];
+}
+
+
+
+//////////////////////////////
+//
+// MidiProbe::hasTempo -- Returns true if a tempo message was found.  The
+//    first tempo is the one with the smallest tick (the one in the lowest
+//    track if there are several at the same tick).
+//
+
+bool MidiProbe::hasTempo(void) const {
+	return m_tempoQ;
+}
+
+
+
+//////////////////////////////
+//
+// MidiProbe::getTempoTick -- Return the tick of the first tempo message.
+//
+
+int MidiProbe::getTempoTick(void) const {
+	return m_tempoTick;
+}
+
+
+
+//////////////////////////////
+//
+// MidiProbe::getTempoMicroseconds -- Return the first tempo in
+//    microseconds per quarter note (500000 if there is no tempo message).
+//
+
+int MidiProbe::getTempoMicroseconds(void) const {
+	return m_tempo;
+}
+
+
+
+//////////////////////////////
+//
+// MidiProbe::getTempoBPM -- Return the first tempo in quarter notes per
+//    minute (120 if there is no tempo message).
+//
+
+double MidiProbe::getTempoBPM(void) const {
+	if (m_tempo <= 0) {
+		return 120.0;
+	}
+	return 60000000.0 / m_tempo;
+}
+
+
+
+//////////////////////////////
+//
+// MidiProbe::hasTimeSignature -- Returns true if a time signature message
+//    was found.
+//
+
+bool MidiProbe::hasTimeSignature(void) const {
+	return m_timeSigQ;
+}
+
+
+
+//////////////////////////////
+//
+// MidiProbe::getTimeSignatureTick -- Return the tick of the first time
+//    signature message.
+//
+
+int MidiProbe::getTimeSignatureTick(void) const {
+	return m_timeSigTick;
+}
+
+
+
+//////////////////////////////
+//
+// MidiProbe::getTimeSignatureTop -- Return the top number of the first
+//    time signature (4 if there is no time signature message).
+//
+
+int MidiProbe::getTimeSignatureTop(void) const {
+	return m_timeSigTop;
+}
+
+
+
+//////////////////////////////
+//
+// MidiProbe::getTimeSignatureBottom -- Return the bottom number of the
+//    first time signature (4 if there is no time signature message).
+//
+
+int MidiProbe::getTimeSignatureBottom(void) const {
+	return m_timeSigBottom;
+}
+
+
+///////////////////////////////////////////////////////////////////////////
+//
+// protected functions --
+//
+
+//////////////////////////////
+//
+// MidiProbe::readHeader -- Read the MThd chunk.  Returns false after
+//    printing the problem if it is not a valid header.
+//
+
+bool MidiProbe::readHeader(const uchar*& ptr, const uchar* end) {
+	if (end - ptr < 14) {
+		std::cerr << "Error: unexpected end of file." << std::endl;
+		return false;
+	}
+	if (memcmp(ptr, "MThd", 4) != 0) {
+		std::cerr << "Error: input is not a MIDI file" << std::endl;
+		return false;
+	}
+	ulong length = ((ulong)ptr[4] << 24) | (ptr[5] << 16) | (ptr[6] << 8) | ptr[7];
+	if (length != 6) {
+		std::cerr << "Error: input is not a MIDI 1.0 Standard MIDI file." << std::endl;
+		std::cerr << "The header size is " << length << " bytes." << std::endl;
+		return false;
+	}
+	m_type = (ptr[8] << 8) | ptr[9];
+	if ((m_type != 0) && (m_type != 1)) {
+		std::cerr << "Error: cannot handle a type-" << m_type
+		          << " MIDI file" << std::endl;
+		return false;
+	}
+	m_tracks = (ptr[10] << 8) | ptr[11];
+	if ((m_type == 0) && (m_tracks != 1)) {
+		std::cerr << "Error: Type 0 MIDI file can only contain one track" << std::endl;
+		return false;
+	}
+	int division = (ptr[12] << 8) | ptr[13];
+	if (division >= 0x8000) {
+		int framespersecond = 255 - ((division >> 8) & 0x00ff) + 1;
+		int subframes       = division & 0x00ff;
+		m_tpq = framespersecond * subframes;
+	} else {
+		m_tpq = division;
+	}
+	ptr += 14;
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// MidiProbe::needTrack -- Returns true if the requested fields may
+//    require reading the next track.  Tempo and time signature searches
+//    are finished when found at tick 0, since later tracks cannot change
+//    the result.
+//
+
+bool MidiProbe::needTrack(void) const {
+	if (m_fields & (PROBE_TRACK_SIZES | PROBE_TRACK_NAMES)) {
+		return true;
+	}
+	if ((m_fields & PROBE_TEMPO) && (!m_tempoQ || (m_tempoTick > 0))) {
+		return true;
+	}
+	if ((m_fields & PROBE_TIME_SIGNATURE) && (!m_timeSigQ || (m_timeSigTick > 0))) {
+		return true;
+	}
+	return false;
+}
+
+
+
+//////////////////////////////
+//
+// MidiProbe::needEvent -- Returns true if an event at the given tick in
+//    the current track may contain a requested field.  nameQ is true if
+//    the track name has already been found.
+//
+
+bool MidiProbe::needEvent(int tick, bool nameQ) const {
+	if ((m_fields & PROBE_TRACK_NAMES) && !nameQ && (tick == 0)) {
+		return true;
+	}
+	if ((m_fields & PROBE_TEMPO) && (!m_tempoQ || (tick < m_tempoTick))) {
+		return true;
+	}
+	if ((m_fields & PROBE_TIME_SIGNATURE) &&
+			(!m_timeSigQ || (tick < m_timeSigTick))) {
+		return true;
+	}
+	return false;
+}
+
+
+
+//////////////////////////////
+//
+// MidiProbe::scanTrack -- Read the events at the start of a track until
+//    none of the remaining events can contain a requested field.  Channel
+//    and system exclusive messages are skipped by their lengths, and only
+//    meta messages are examined.  Errors in the track data stop the scan
+//    without an error: unlike MidiFile::read(), the probe does not check
+//    the events which it does not need.
+//
+
+void MidiProbe::scanTrack(int track, const uchar* data, size_t size) {
+	MidiTrackDecoder decoder(data, size);
+	bool nameQ = false;
+	long tick = 0;
+	while (decoder.next() > 0) {
+		tick += decoder.getDeltaTick();
+		if ((tick > 0x7fffffff) || !needEvent((int)tick, nameQ)) {
+			break;
+		}
+		if (!decoder.isMeta()) {
+			continue;
+		}
+		const uchar* content = decoder.getMetaContent();
+		int length = decoder.getMetaContentSize();
+		switch (decoder.getMetaType()) {
+			case 0x03:  // track name
+				if ((tick == 0) && !nameQ) {
+					m_trackNames[track].assign((const char*)content, length);
+					nameQ = true;
+				}
+				break;
+			case 0x51:  // tempo
+				if ((length >= 3) && (!m_tempoQ || (tick < m_tempoTick))) {
+					m_tempo = (content[0] << 16) | (content[1] << 8) | content[2];
+					m_tempoTick = (int)tick;
+					m_tempoQ = true;
+				}
+				break;
+			case 0x58:  // time signature
+				if ((length >= 2) && (!m_timeSigQ || (tick < m_timeSigTick))) {
+					m_timeSigTop = content[0];
+					m_timeSigBottom = content[1] < 31 ? 1 << content[1] : 0;
+					m_timeSigTick = (int)tick;
+					m_timeSigQ = true;
+				}
+				break;
+		}
+		if (decoder.isEndOfTrack()) {
+			break;
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// MidiProbe::findTrackEnd -- Skip all events of a track to find the
+//    number of bytes up to and including its end-of-track message.  Used
+//    when the chunk size of the track is not correct.
+//
+
+bool MidiProbe::findTrackEnd(const uchar* data, size_t size, size_t& used) {
+	MidiTrackDecoder decoder(data, size);
+	while (decoder.next() > 0) {
+		if (decoder.isEndOfTrack()) {
+			used = decoder.getOffset();
+			return true;
+		}
+	}
+	used = decoder.getOffset();
+	return false;
+}
+
+
+} // end of namespace smf
+
+
+
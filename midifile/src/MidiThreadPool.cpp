@@ -0,0 +1,202 @@
+//
+// Creation Date: Fri Oct 16 13:40:02 JST 2026
+// Last Modified: Fri Oct 16 13:40:02 JST 2026
+// Filename:      midifile/src/MidiThreadPool.cpp
+// Website:       http://midifile.sapp.org
+// Syntax:        C++11
+// vim:           ts=3 noexpandtab
+//
+// Description:   A small pool of worker threads used by the MidiFile
+//                class to process independent tracks concurrently.
+//
+
+#include "MidiThreadPool.h"
+
+#include <algorithm>
+
+
+namespace smf {
+
+// t_insideWorker == True in threads which are currently running a task
+// from a pool, so that nested calls to run() do not wait on themselves.
+static thread_local bool t_insideWorker = false;
+
+
+//////////////////////////////
+//
+// MidiThreadPool::MidiThreadPool -- Constructor.  The thread count
+//    includes the thread calling run().  If the count is less than one,
+//    then use the number of hardware threads.
+//
+
+MidiThreadPool::MidiThreadPool(int threads) {
+	m_next = 0;
+	if (threads < 1) {
+		threads = getHardwareThreads();
+	}
+	m_workers.reserve(threads - 1);
+	for (int i=1; i<threads; i++) {
+		m_workers.emplace_back(&MidiThreadPool::workerLoop, this);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// MidiThreadPool::~MidiThreadPool -- Deconstructor.  Stop the workers.
+//
+
+MidiThreadPool::~MidiThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+	m_wake.notify_all();
+	for (int i=0; i<(int)m_workers.size(); i++) {
+		m_workers[i].join();
+	}
+}
+
+
+
+//////////////////////////////
+//
+// MidiThreadPool::getThreadCount -- Return the number of threads which
+//    can process tasks at the same time (workers + calling thread).
+//
+
+int MidiThreadPool::getThreadCount(void) const {
+	return (int)m_workers.size() + 1;
+}
+
+
+
+//////////////////////////////
+//
+// MidiThreadPool::run -- Call task(i) for every i from 0 to count-1,
+//    distributing the calls over the pool threads, and return when all
+//    calls have finished.  Tasks are started in index order, so put the
+//    most expensive tasks first.  At most maxthreads threads are used
+//    (all of them if maxthreads is less than one).  If the pool is
+//    already running another job, or when called from inside a task,
+//    the tasks are run in the calling thread.
+//    default value: maxthreads = 0.
+//
+
+void MidiThreadPool::run(int count, const std::function<void(int)>& task,
+		int maxthreads) {
+	if (count <= 0) {
+		return;
+	}
+	int helpers = (int)m_workers.size();
+	if (maxthreads > 0) {
+		helpers = std::min(helpers, maxthreads - 1);
+	}
+	helpers = std::min(helpers, count - 1);
+	if ((helpers <= 0) || t_insideWorker || !m_runMutex.try_lock()) {
+		for (int i=0; i<count; i++) {
+			task(i);
+		}
+		return;
+	}
+	std::lock_guard<std::mutex> runlock(m_runMutex, std::adopt_lock);
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_task    = &task;
+		m_count   = count;
+		m_next    = 0;
+		m_helpers = helpers;
+		m_generation++;
+	}
+	m_wake.notify_all();
+
+	bool oldstate = t_insideWorker;
+	t_insideWorker = true;
+	int index;
+	while ((index = m_next++) < count) {
+		task(index);
+	}
+	t_insideWorker = oldstate;
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_helpers = 0;
+	m_done.wait(lock, [this]() { return m_busy == 0; });
+	m_task = NULL;
+	m_count = 0;
+}
+
+
+
+//////////////////////////////
+//
+// MidiThreadPool::getSharedPool -- Return a pool with one thread for
+//    each hardware thread, which is created on first use.
+//
+
+MidiThreadPool& MidiThreadPool::getSharedPool(void) {
+	static MidiThreadPool pool;
+	return pool;
+}
+
+
+
+//////////////////////////////
+//
+// MidiThreadPool::getHardwareThreads -- Return the number of threads
+//    which can run concurrently on the computer (at least 1).
+//
+
+int MidiThreadPool::getHardwareThreads(void) {
+	int count = (int)std::thread::hardware_concurrency();
+	return count < 1 ? 1 : count;
+}
+
+
+///////////////////////////////////////////////////////////////////////////
+//
+// protected functions --
+//
+
+//////////////////////////////
+//
+// MidiThreadPool::workerLoop -- Wait for jobs and help process them.
+//
+
+void MidiThreadPool::workerLoop(void) {
+	t_insideWorker = true;
+	unsigned long seen = 0;
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (1) {
+		m_wake.wait(lock, [this, &seen]() {
+			return m_stop || ((m_generation != seen) && (m_helpers > 0));
+		});
+		if (m_stop) {
+			return;
+		}
+		seen = m_generation;
+		m_helpers--;
+		m_busy++;
+		const std::function<void(int)>& task = *m_task;
+		int count = m_count;
+		lock.unlock();
+
+		int index;
+		while ((index = m_next++) < count) {
+			task(index);
+		}
+
+		lock.lock();
+		m_busy--;
+		if (m_busy == 0) {
+			m_done.notify_all();
+		}
+	}
+}
+
+
+} // end namespace smf
+
+
+
@@ -0,0 +1,252 @@
+//
+// Creation Date: Sat Oct 17 17:52:08 JST 2026
+// Last Modified: Sat Oct 17 17:52:08 JST 2026
+// Filename:      midifile/src/MidiTimeline.cpp
+// Website:       http://midifile.sapp.org
+// Syntax:        C++11
+// vim:           ts=3 noexpandtab
+//
+// Description:   Read-only view of the events of all tracks of a MidiFile
+//                in time order.  The tracks are merged one event at a time
+//                with a small heap that holds the next event of each track,
+//                so the MidiFile is never joined, sorted or changed to
+//                absolute ticks, and several timelines can read the same
+//                file at once.  The time of each event in seconds is
+//                calculated from the tempo messages on the way.
+//
+
+#include "MidiTimeline.h"
+#include "MidiFile.h"
+
+
+namespace smf {
+
+//////////////////////////////
+//
+// MidiTimeline::MidiTimeline -- Constructor.
+//
+
+MidiTimeline::MidiTimeline(void) {
+	// do nothing
+}
+
+
+MidiTimeline::MidiTimeline(const MidiFile& midifile) {
+	open(midifile);
+}
+
+
+
+//////////////////////////////
+//
+// MidiTimeline::open -- Start a timeline over the tracks of a MidiFile.
+//    The first event is available after calling next().  The events of
+//    each track must be in tick order, and the MidiFile must not be
+//    changed while the timeline is in use (the seconds of the events can
+//    be set, since they are not read).  Events with the same tick come
+//    in order of track, which is the order that joinTracks() gives for
+//    files that have been read.
+//
+
+void MidiTimeline::open(const MidiFile& midifile) {
+	m_file = &midifile;
+	rewind();
+}
+
+
+
+//////////////////////////////
+//
+// MidiTimeline::rewind -- Go back to before the first event.
+//
+
+void MidiTimeline::rewind(void) {
+	m_heap.clear();
+	m_next.clear();
+	m_track          = -1;
+	m_index          = -1;
+	m_tick           = 0;
+	m_seconds        = 0.0;
+	m_segmentTick    = 0;
+	m_segmentSeconds = 0.0;
+	if (m_file == NULL) {
+		return;
+	}
+
+	const MidiFile& midifile = *m_file;
+	m_deltaQ = midifile.isDeltaTicks();
+	double defaultTempo = 120.0;
+	m_secondsPerTick = 60.0 / (defaultTempo * midifile.getTicksPerQuarterNote());
+
+	int tracks = midifile.getTrackCount();
+	m_next.assign(tracks, 0);
+	m_heap.reserve(tracks);
+	for (int i=0; i<tracks; i++) {
+		if (midifile[i].getEventCount() > 0) {
+			m_heap.push_back(HeapItem{midifile[i][0].tick, i});
+		}
+	}
+	for (int i=(int)m_heap.size()/2 - 1; i>=0; i--) {
+		siftDown(i);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// MidiTimeline::next -- Move to the next event in time order.  Returns
+//    false when there are no more events.
+//
+
+bool MidiTimeline::next(void) {
+	if (m_heap.empty()) {
+		m_track = -1;
+		m_index = -1;
+		return false;
+	}
+
+	HeapItem& top = m_heap[0];
+	m_track = top.track;
+	m_index = m_next[m_track]++;
+	m_tick  = top.tick;
+
+	const MidiEventList& events = (*m_file)[m_track];
+	if (m_next[m_track] < events.getEventCount()) {
+		const MidiEvent& following = events[m_next[m_track]];
+		top.tick = m_deltaQ ? m_tick + following.tick : following.tick;
+	} else {
+		top = m_heap.back();
+		m_heap.pop_back();
+	}
+	if (!m_heap.empty()) {
+		siftDown(0);
+	}
+
+	// The seconds are counted from the start of the tempo segment rather
+	// than added up event by event, so that rounding errors do not build
+	// up.  A tempo message starts a new segment after its own tick.
+	m_seconds = m_segmentSeconds + (m_tick - m_segmentTick) * m_secondsPerTick;
+	const MidiEvent& event = events[m_index];
+	if (event.isTempo()) {
+		m_segmentTick    = m_tick;
+		m_segmentSeconds = m_seconds;
+		m_secondsPerTick = event.getTempoSPT(m_file->getTicksPerQuarterNote());
+	}
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// MidiTimeline::getEvent -- Return the current event.  Only valid after
+//    next() has returned true.
+//
+
+const MidiEvent& MidiTimeline::getEvent(void) const {
+	return (*m_file)[m_track][m_index];
+}
+
+
+
+//////////////////////////////
+//
+// MidiTimeline::getTrack -- Return the track of the current event, or -1
+//    before the first event and after the last one.
+//
+
+int MidiTimeline::getTrack(void) const {
+	return m_track;
+}
+
+
+
+//////////////////////////////
+//
+// MidiTimeline::getIndex -- Return the index of the current event in its
+//    track, or -1 before the first event and after the last one.
+//
+
+int MidiTimeline::getIndex(void) const {
+	return m_index;
+}
+
+
+
+//////////////////////////////
+//
+// MidiTimeline::getTick -- Return the absolute tick of the current event,
+//    also when the MidiFile is in delta ticks.
+//
+
+int MidiTimeline::getTick(void) const {
+	return m_tick;
+}
+
+
+
+//////////////////////////////
+//
+// MidiTimeline::getSeconds -- Return the time of the current event in
+//    seconds, following the tempo messages from the start of the file
+//    (120 beats per minute until the first one).  The values are the same
+//    as those set by MidiFile::doTimeAnalysis().
+//
+
+double MidiTimeline::getSeconds(void) const {
+	return m_seconds;
+}
+
+
+
+//////////////////////////////
+//
+// MidiTimeline::getSecondsPerTick -- Return the tempo after the current
+//    event (including it if it is a tempo message), in seconds per tick.
+//
+
+double MidiTimeline::getSecondsPerTick(void) const {
+	return m_secondsPerTick;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////
+//
+// protected functions --
+//
+
+//////////////////////////////
+//
+// MidiTimeline::siftDown -- Move an item of the heap down to its place,
+//    after its tick has changed or it has been replaced.  Items with
+//    smaller ticks, and then lower tracks, go on top.
+//
+
+void MidiTimeline::siftDown(int index) {
+	auto before = [](const HeapItem& a, const HeapItem& b) {
+		return (a.tick < b.tick) || ((a.tick == b.tick) && (a.track < b.track));
+	};
+	int size = (int)m_heap.size();
+	HeapItem item = m_heap[index];
+	int i = index;
+	while (2 * i + 1 < size) {
+		int child = 2 * i + 1;
+		if ((child + 1 < size) && before(m_heap[child + 1], m_heap[child])) {
+			child++;
+		}
+		if (!before(m_heap[child], item)) {
+			break;
+		}
+		m_heap[i] = m_heap[child];
+		i = child;
+	}
+	m_heap[i] = item;
+}
+
+
+} // end of namespace smf
+
+
+
@@ -0,0 +1,371 @@
+//
+// Creation Date: Fri Oct 16 09:12:40 JST 2026
+// Last Modified: Fri Oct 16 09:12:40 JST 2026
+// Filename:      midifile/src/MidiTrackDecoder.cpp
+// Website:       http://midifile.sapp.org
+// Syntax:        C++11
+// vim:           ts=3 noexpandtab
+//
+// Description:   Decodes the events of an MTrk chunk directly from a
+//                block of memory, one event at a time, without copying
+//                the message bytes.
+//
+
+#include "MidiTrackDecoder.h"
+#include "MidiVlv.h"
+
+#include <string.h>
+
+
+namespace smf {
+
+//////////////////////////////
+//
+// MidiTrackDecoder::MidiTrackDecoder -- Constructor.  The data should
+//    start at the first delta time after the MTrk chunk header.
+//
+
+MidiTrackDecoder::MidiTrackDecoder(void) {
+	// do nothing
+}
+
+
+MidiTrackDecoder::MidiTrackDecoder(const uchar* data, size_t size) {
+	setData(data, size);
+}
+
+
+
+//////////////////////////////
+//
+// MidiTrackDecoder::setData -- Set the memory to decode and restart
+//    at its first byte.  The running status is cleared.
+//
+
+void MidiTrackDecoder::setData(const uchar* data, size_t size) {
+	m_data    = data;
+	m_size    = size;
+	m_offset  = 0;
+	m_running = 0;
+	m_error   = "";
+	m_delta   = 0;
+	m_command = 0;
+	m_payload = NULL;
+	m_length  = 0;
+	m_metaSkip = 0;
+}
+
+
+
+//////////////////////////////
+//
+// MidiTrackDecoder::continueData -- Continue decoding in another block
+//    of memory which starts with the first byte that has not been decoded
+//    yet (such as after refilling a stream buffer).  The running status
+//    is kept.
+//
+
+void MidiTrackDecoder::continueData(const uchar* data, size_t size) {
+	m_data   = data;
+	m_size   = size;
+	m_offset = 0;
+	m_payload = NULL;
+	m_length = 0;
+}
+
+
+
+//////////////////////////////
+//
+// MidiTrackDecoder::clearRunningStatus -- Forget the last command byte,
+//    such as when starting to decode a new track.
+//
+
+void MidiTrackDecoder::clearRunningStatus(void) {
+	m_running = 0;
+}
+
+
+
+//////////////////////////////
+//
+// MidiTrackDecoder::next -- Decode the event starting at the current
+//    offset.  Returns 1 if an event was decoded, 0 if the data ends
+//    before the end of the event (the offset is not changed in that
+//    case, so decoding can be retried on a longer block), or -1 if
+//    the data is malformed (see getError()).  Messages follow the same
+//    rules as MidiFile::read(): delta times can be up to 5 bytes long,
+//    and running status is not allowed after meta or sysex messages.
+//
+
+int MidiTrackDecoder::next(void) {
+	const uchar* ptr = m_data + m_offset;
+	const uchar* end = m_data + m_size;
+
+	// delta time (most delta times fit into one byte):
+	ulong delta;
+	int vlvsize = 1;
+	if ((ptr < end) && (*ptr < 0x80)) {
+		delta = *ptr;
+	} else {
+		vlvsize = MidiVlv::decode(ptr, end - ptr, delta, 5);
+	}
+	if (vlvsize == 0) {
+		m_error = "unexpected end of file.";
+		return 0;
+	} else if (vlvsize < 0) {
+		m_error = "VLV number is too large";
+		return -1;
+	}
+	ptr += vlvsize;
+
+	// command byte:
+	if (ptr >= end) {
+		m_error = "unexpected end of file.";
+		return 0;
+	}
+	uchar command;
+	if (*ptr < 0x80) {
+		if (m_running == 0) {
+			m_error = "running command with no previous command";
+			return -1;
+		}
+		if (m_running >= 0xf0) {
+			m_error = "running status not permitted with meta and sysex event.";
+			return -1;
+		}
+		command = m_running;
+	} else {
+		command = *ptr++;
+	}
+
+	const uchar* payload = ptr;
+	size_t length = 0;
+	int metaskip = 0;
+	switch (command & 0xf0) {
+		case 0x80:        // note off (2 more bytes)
+		case 0x90:        // note on (2 more bytes)
+		case 0xA0:        // aftertouch (2 more bytes)
+		case 0xB0:        // cont. controller (2 more bytes)
+		case 0xE0:        // pitch wheel (2 more bytes)
+			length = 2;
+			break;
+		case 0xC0:        // patch change (1 more byte)
+		case 0xD0:        // channel pressure (1 more byte)
+			length = 1;
+			break;
+		case 0xF0:
+			if (command == 0xff) {
+				// meta message: type byte, VLV content size, content.  The type
+				// and size bytes are kept in the payload.
+				if (end - ptr < 2) {
+					m_error = "unexpected end of file.";
+					return 0;
+				}
+				ulong content;
+				vlvsize = MidiVlv::decode(ptr + 1, end - ptr - 1, content, 4);
+				if (vlvsize == 0) {
+					m_error = "unexpected end of file.";
+					return 0;
+				} else if (vlvsize < 0) {
+					m_error = "cannot handle large VLVs";
+					return -1;
+				}
+				metaskip = 1 + vlvsize;
+				length = metaskip + content;
+			} else if ((command == 0xf0) || (command == 0xf7)) {
+				// sysex or raw bytes: the VLV byte count is not stored.
+				ulong content;
+				vlvsize = MidiVlv::decode(ptr, end - ptr, content, 5);
+				if (vlvsize == 0) {
+					m_error = "unexpected end of file.";
+					return 0;
+				} else if (vlvsize < 0) {
+					m_error = "VLV number is too large";
+					return -1;
+				}
+				payload = ptr + vlvsize;
+				ptr = payload;
+				length = content;
+			}
+			// other "F" commands have no data bytes.
+			break;
+	}
+
+	if ((size_t)(end - ptr) < length) {
+		m_error = "unexpected end of file.";
+		return 0;
+	}
+	if (command < 0xf0) {
+		for (size_t i=0; i<length; i++) {
+			if (payload[i] > 0x7f) {
+				m_error = "MIDI data byte too large";
+				return -1;
+			}
+		}
+	}
+
+	m_running  = command;
+	m_delta    = delta;
+	m_command  = command;
+	m_payload  = payload;
+	m_length   = (int)length;
+	m_metaSkip = metaskip;
+	m_offset   = (size_t)(payload + length - m_data);
+	return 1;
+}
+
+
+
+//////////////////////////////
+//
+// MidiTrackDecoder::getOffset -- Return the number of bytes which have
+//    been decoded so far.
+//
+
+size_t MidiTrackDecoder::getOffset(void) const {
+	return m_offset;
+}
+
+
+
+//////////////////////////////
+//
+// MidiTrackDecoder::getError -- Return a description of the reason why
+//    next() did not return 1.
+//
+
+const char* MidiTrackDecoder::getError(void) const {
+	return m_error;
+}
+
+
+
+//////////////////////////////
+//
+// MidiTrackDecoder::getDeltaTick -- Return the delta time of the last event.
+//
+
+ulong MidiTrackDecoder::getDeltaTick(void) const {
+	return m_delta;
+}
+
+
+
+//////////////////////////////
+//
+// MidiTrackDecoder::getCommandByte -- Return the command byte of the
+//    last event (after resolving running status).
+//
+
+int MidiTrackDecoder::getCommandByte(void) const {
+	return m_command;
+}
+
+
+
+//////////////////////////////
+//
+// MidiTrackDecoder::getPayload -- Return the bytes following the command
+//    byte in the form they are stored in a MidiMessage: data bytes for
+//    MIDI messages, type/size/content for meta messages, and the content
+//    without the VLV byte count for sysex messages.  The pointer refers
+//    to the decoded memory block.
+//
+
+const uchar* MidiTrackDecoder::getPayload(void) const {
+	return m_payload;
+}
+
+
+int MidiTrackDecoder::getPayloadSize(void) const {
+	return m_length;
+}
+
+
+
+//////////////////////////////
+//
+// MidiTrackDecoder::getMessageSize -- Return the number of bytes needed
+//    to store the last event in a MidiMessage (command byte + payload).
+//
+
+int MidiTrackDecoder::getMessageSize(void) const {
+	return m_length + 1;
+}
+
+
+
+//////////////////////////////
+//
+// MidiTrackDecoder::copyMessage -- Copy the last event into the output
+//    buffer, which must hold getMessageSize() bytes.
+//
+
+void MidiTrackDecoder::copyMessage(uchar* output) const {
+	output[0] = m_command;
+	if (m_length > 0) {
+		memcpy(output + 1, m_payload, m_length);
+	}
+}
+
+
+
+//////////////////////////////
+//
+// MidiTrackDecoder::isMeta -- Returns true if the last event is a meta message.
+//
+
+bool MidiTrackDecoder::isMeta(void) const {
+	return (m_command == 0xff) && (m_length > 0);
+}
+
+
+
+//////////////////////////////
+//
+// MidiTrackDecoder::getMetaType -- Return the meta message type of the
+//    last event, or -1 if it is not a meta message.
+//
+
+int MidiTrackDecoder::getMetaType(void) const {
+	if (!isMeta()) {
+		return -1;
+	}
+	return m_payload[0];
+}
+
+
+
+//////////////////////////////
+//
+// MidiTrackDecoder::getMetaContent -- Return the content bytes of a
+//    meta message (after the type and size bytes).
+//
+
+const uchar* MidiTrackDecoder::getMetaContent(void) const {
+	return m_payload + m_metaSkip;
+}
+
+
+int MidiTrackDecoder::getMetaContentSize(void) const {
+	return m_length - m_metaSkip;
+}
+
+
+
+//////////////////////////////
+//
+// MidiTrackDecoder::isEndOfTrack -- Returns true if the last event is
+//    an end-of-track meta message.
+//
+
+bool MidiTrackDecoder::isEndOfTrack(void) const {
+	return (m_command == 0xff) && (m_length > 0) && (m_payload[0] == 0x2f);
+}
+
+
+} // end namespace smf
+
+
+
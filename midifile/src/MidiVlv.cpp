@@ -0,0 +1,239 @@
+//
+// Creation Date: Fri Oct 16 17:12:48 JST 2026
+// Last Modified: Fri Oct 16 17:12:48 JST 2026
+// Filename:      midifile/src/MidiVlv.cpp
+// Website:       http://midifile.sapp.org
+// Syntax:        C++11
+// vim:           ts=3 noexpandtab
+//
+// Description:   Conversion between integers and MIDI Variable Length
+//                Values stored in byte buffers.
+//
+
+#include "MidiVlv.h"
+
+#include <cstdint>
+#include <string.h>
+
+// When VLV_SWAR is defined, up to eight bytes are loaded into one 64-bit
+// word and the 7-bit groups are packed with shifts and masks instead
+// of a loop over the bytes.  This requires a little-endian processor
+// and the GCC/Clang byte-swap and bit-count builtins.
+#if defined(__GNUC__) && defined(__BYTE_ORDER__) && \
+		(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+	#define VLV_SWAR
+#endif
+
+
+namespace smf {
+
+//////////////////////////////
+//
+// MidiVlv::decode -- Convert the VLV at the start of the data into an
+//    integer.  Returns the number of bytes in the VLV, 0 if the data ends
+//    before the last byte of the VLV, or -1 if the VLV is longer than
+//    maxbytes (at most 8).  MIDI files allow four bytes, but delta times
+//    of five bytes are accepted when reading.
+//
+
+int MidiVlv::decode(const uchar* data, size_t size, ulong& value,
+		int maxbytes) {
+	if ((size > 0) && (data[0] < 0x80)) {
+		value = data[0];
+		return 1;
+	}
+#ifdef VLV_SWAR
+	if (size >= 8) {
+		uint64_t x;
+		memcpy(&x, data, 8);
+		uint64_t stops = ~x & 0x8080808080808080ULL;
+		if (stops == 0) {
+			return -1;
+		}
+		int length = (__builtin_ctzll(stops) >> 3) + 1;
+		if (length > maxbytes) {
+			return -1;
+		}
+		int unused = 64 - 8 * length;
+		x &= 0x7f7f7f7f7f7f7f7fULL >> unused;
+		// put the last (least significant) byte first:
+		x = __builtin_bswap64(x) >> unused;
+		// join pairs of 7-bit groups, then 14-bit and 28-bit groups:
+		x = (x & 0x007f007f007f007fULL) | ((x & 0x7f007f007f007f00ULL) >> 1);
+		x = (x & 0x00003fff00003fffULL) | ((x & 0x3fff00003fff0000ULL) >> 2);
+		x = (x & 0x000000000fffffffULL) | ((x & 0x0fffffff00000000ULL) >> 4);
+		value = (ulong)x;
+		return length;
+	}
+#endif
+	return decodeBytewise(data, size, value, maxbytes);
+}
+
+
+
+//////////////////////////////
+//
+// MidiVlv::decodeMany -- Convert consecutive VLVs (such as a list of
+//    delta times stored without their events) into integers.  Returns
+//    the number of values stored in the values array, and sets used to
+//    the number of bytes read.  Decoding stops at the first incomplete
+//    or invalid VLV.
+//
+
+int MidiVlv::decodeMany(const uchar* data, size_t size, ulong* values,
+		int count, size_t& used, int maxbytes) {
+	size_t offset = 0;
+	int output = 0;
+	while (output < count) {
+#ifdef VLV_SWAR
+		// Eight single-byte values in a row can be copied directly.
+		if ((count - output >= 8) && (size - offset >= 8)) {
+			uint64_t x;
+			memcpy(&x, data + offset, 8);
+			if ((x & 0x8080808080808080ULL) == 0) {
+				for (int i=0; i<8; i++) {
+					values[output++] = data[offset + i];
+				}
+				offset += 8;
+				continue;
+			}
+		}
+#endif
+		int length = decode(data + offset, size - offset, values[output],
+				maxbytes);
+		if (length <= 0) {
+			break;
+		}
+		offset += length;
+		output++;
+	}
+	used = offset;
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// MidiVlv::getEncodedSize -- Return the number of bytes needed to store
+//    a value as a VLV (1 to 5 bytes).
+//
+
+int MidiVlv::getEncodedSize(ulong value) {
+#ifdef VLV_SWAR
+	int bits = 64 - __builtin_clzll((uint64_t)value | 1);
+	return (bits + 6) / 7;
+#else
+	int length = 1;
+	while ((length < 5) && (value >> (7 * length))) {
+		length++;
+	}
+	return length;
+#endif
+}
+
+
+
+//////////////////////////////
+//
+// MidiVlv::encode -- Store a value as a VLV in the buffer, which must have
+//    space for five bytes.  Returns the number of bytes in the VLV.  The
+//    caller is responsible for limiting values to 0x0fffffff when
+//    writing MIDI files.
+//
+
+int MidiVlv::encode(ulong value, uchar* buffer) {
+	if (value < 0x80) {
+		buffer[0] = (uchar)value;
+		return 1;
+	}
+#ifdef VLV_SWAR
+	uint64_t v = (uint64_t)value;
+	int length = getEncodedSize(value);
+	int unused = 64 - 8 * length;
+	// spread the 7-bit groups into bytes, least significant first:
+	uint64_t x = (v & 0x7fULL) |
+	             ((v & 0x3f80ULL) << 1) |
+	             ((v & 0x1fc000ULL) << 2) |
+	             ((v & 0xfe00000ULL) << 3) |
+	             ((v & 0x7f0000000ULL) << 4);
+	// continuation bits on all bytes except the last one:
+	x |= (0x8080808080808080ULL >> unused) & ~0x80ULL;
+	x = __builtin_bswap64(x) >> unused;
+	memcpy(buffer, &x, length);
+	return length;
+#else
+	return encodeBytewise(value, buffer);
+#endif
+}
+
+
+
+//////////////////////////////
+//
+// MidiVlv::encodeMany -- Store a list of values as consecutive VLVs.  The
+//    buffer must have space for five bytes per value.  Returns the number
+//    of bytes written.
+//
+
+size_t MidiVlv::encodeMany(const ulong* values, int count, uchar* buffer) {
+	size_t offset = 0;
+	for (int i=0; i<count; i++) {
+		if (values[i] < 0x80) {
+			buffer[offset++] = (uchar)values[i];
+		} else {
+			offset += encode(values[i], buffer + offset);
+		}
+	}
+	return offset;
+}
+
+
+///////////////////////////////////////////////////////////////////////////
+//
+// protected functions --
+//
+
+//////////////////////////////
+//
+// MidiVlv::decodeBytewise -- Decode a VLV one byte at a time.  Used for
+//    data near the end of a buffer.
+//
+
+int MidiVlv::decodeBytewise(const uchar* data, size_t size, ulong& value,
+		int maxbytes) {
+	ulong output = 0;
+	for (int i=0; i<maxbytes; i++) {
+		if ((size_t)i >= size) {
+			return 0;
+		}
+		output = (output << 7) | (data[i] & 0x7f);
+		if (data[i] < 0x80) {
+			value = output;
+			return i + 1;
+		}
+	}
+	return -1;
+}
+
+
+
+//////////////////////////////
+//
+// MidiVlv::encodeBytewise -- Encode a VLV one byte at a time.
+//
+
+int MidiVlv::encodeBytewise(ulong value, uchar* buffer) {
+	int length = getEncodedSize(value);
+	for (int i=length-1; i>=0; i--) {
+		buffer[i] = (uchar)(value & 0x7f) | (i < length - 1 ? 0x80 : 0x00);
+		value >>= 7;
+	}
+	return length;
+}
+
+
+} // end of namespace smf
+
+
+
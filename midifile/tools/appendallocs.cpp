@@ -0,0 +1,210 @@
+//
+// Creation Date: Sat Oct 17 13:26:40 JST 2026
+// Last Modified: Sat Oct 17 13:26:40 JST 2026
+// Filename:      midifile/tools/appendallocs.cpp
+// Syntax:        C++11
+// vim:           ts=3
+//
+// Description:   Count the heap allocations made for each event appended
+//                to a MidiEventList or MidiFile track by copying, by
+//                moving and by constructing the event in place, for short
+//                (channel) and long (system exclusive) messages.  Exits
+//                with an error if an append makes more allocations than
+//                expected: one for the event, plus one for the bytes of a
+//                long message when they are copied.  The appends of the
+//                midie application (MidiWorkspace::append_event) are not
+//                covered, since the tools only link with the library.
+//
+
+#include "MidiFile.h"
+#include "Options.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <new>
+#include <vector>
+
+using namespace std;
+using namespace smf;
+
+static atomic<long> allocations(0);
+
+bool   checkAppend     (const string& name, int events, int expected,
+                        const function<void(MidiEventList&, int)>& append);
+bool   checkAddEvent   (const string& name, int events, int expected,
+                        vector<MidiEvent>& prepared);
+MidiMessage makeMessage (bool longQ);
+
+
+// Count every allocation made by the program.  GCC must not inline these
+// functions into their callers, where it would find malloc() paired with
+// operator delete, or operator new paired with free().
+
+#ifdef __GNUC__
+	#define NOINLINE __attribute__((noinline))
+#else
+	#define NOINLINE
+#endif
+
+static void* allocate(size_t size) {
+	allocations.fetch_add(1, memory_order_relaxed);
+	void* ptr = malloc(size ? size : 1);
+	if (ptr == NULL) {
+		throw bad_alloc();
+	}
+	return ptr;
+}
+
+NOINLINE void* operator new(size_t size) {
+	return allocate(size);
+}
+
+NOINLINE void* operator new[](size_t size) {
+	return allocate(size);
+}
+
+NOINLINE void operator delete(void* ptr) noexcept {
+	free(ptr);
+}
+
+NOINLINE void operator delete[](void* ptr) noexcept {
+	free(ptr);
+}
+
+NOINLINE void operator delete(void* ptr, size_t) noexcept {
+	free(ptr);
+}
+
+NOINLINE void operator delete[](void* ptr, size_t) noexcept {
+	free(ptr);
+}
+
+
+///////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char** argv) {
+	Options options;
+	options.define("n|events=i:10000", "number of events to append");
+	options.process(argc, argv);
+	int events = options.getInteger("events");
+	if (events < 1) {
+		events = 1;
+	}
+
+	bool ok = true;
+	for (int longQ=0; longQ<2; longQ++) {
+		const MidiMessage message = makeMessage(longQ);
+		string size = longQ ? "long " : "short";
+		// The events and messages are made before counting, so that only
+		// the allocations of the appends are counted.
+		vector<MidiEvent> prepared(events, MidiEvent(message));
+		vector<MidiMessage> messages(events, message);
+
+		ok &= checkAppend("push_back copy  " + size, events, 1 + longQ,
+			[&](MidiEventList& list, int i) {
+				list.push_back(prepared[i]);
+			});
+
+		ok &= checkAppend("push_back move  " + size, events, 1,
+			[&](MidiEventList& list, int i) {
+				list.push_back(std::move(prepared[i]));
+			});
+
+		ok &= checkAppend("emplace_back    " + size, events, 1,
+			[&](MidiEventList& list, int i) {
+				list.emplace_back(std::move(messages[i]));
+				list.back().tick = i;
+			});
+
+		prepared.assign(events, MidiEvent(message));
+		ok &= checkAddEvent("addEvent move   " + size, events, 1, prepared);
+	}
+
+	// channel messages constructed from their bytes:
+	ok &= checkAppend("emplace_back bytes   ", events, 1,
+		[&](MidiEventList& list, int i) {
+			list.emplace_back(0x90, 60, 64);
+			list.back().tick = i;
+		});
+
+	if (!ok) {
+		cerr << "FAILED: appends made more allocations than expected" << endl;
+		return 1;
+	}
+	return 0;
+}
+
+
+///////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////
+//
+// checkAppend -- Append events to a list which has room for them, and
+//    compare the allocations made per event with the expected number.
+//
+
+bool checkAppend(const string& name, int events, int expected,
+		const function<void(MidiEventList&, int)>& append) {
+	MidiEventList list;
+	list.reserve(events);
+	long before = allocations.load();
+	for (int i=0; i<events; i++) {
+		append(list, i);
+	}
+	double count = (double)(allocations.load() - before) / events;
+	bool ok = count <= expected;
+	cout << name << "\tallocations per event: " << count
+	     << "\texpected: " << expected << (ok ? "" : "\tFAILED") << endl;
+	return ok;
+}
+
+
+
+//////////////////////////////
+//
+// checkAddEvent -- Like checkAppend(), for events moved into a MidiFile
+//    track.
+//
+
+bool checkAddEvent(const string& name, int events, int expected,
+		vector<MidiEvent>& prepared) {
+	MidiFile midifile;
+	midifile[0].reserve(events);
+	long before = allocations.load();
+	for (int i=0; i<events; i++) {
+		midifile.addEvent(0, std::move(prepared[i]));
+	}
+	double count = (double)(allocations.load() - before) / events;
+	bool ok = count <= expected;
+	cout << name << "\tallocations per event: " << count
+	     << "\texpected: " << expected << (ok ? "" : "\tFAILED") << endl;
+	return ok;
+}
+
+
+
+//////////////////////////////
+//
+// makeMessage -- Return a note-on, or a system exclusive message which is
+//    too long to be stored inside the MidiMessage.
+//
+
+MidiMessage makeMessage(bool longQ) {
+	MidiMessage message;
+	if (!longQ) {
+		message.makeNoteOn(0, 60, 64);
+		return message;
+	}
+	message.push_back(0xf0);
+	message.push_back(31);
+	for (int i=0; i<30; i++) {
+		message.push_back(i);
+	}
+	message.push_back(0xf7);
+	return message;
+}
+
+
+
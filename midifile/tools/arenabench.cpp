@@ -0,0 +1,151 @@
+//
+// Creation Date: Fri Oct 16 21:18:05 JST 2026
+// Last Modified: Fri Oct 16 21:18:05 JST 2026
+// Filename:      midifile/tools/arenabench.cpp
+// Syntax:        C++11
+// vim:           ts=3
+//
+// Description:   Compare the number of heap allocations and the time
+//                taken to read and then clear MIDI files when each event
+//                is allocated separately and when events are placed in
+//                blocks with MidiFile::setArenaStorage().
+//
+
+#include "MidiFile.h"
+#include "Options.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+
+using namespace std;
+using namespace smf;
+
+static atomic<long> allocations(0);
+
+void   benchmarkFile   (const string& filename, int repeat, int threads);
+void   readAndClear    (const string& filename, bool arenaQ, int threads,
+                        double& readtime, double& cleartime, long& count);
+double elapsed         (chrono::steady_clock::time_point start);
+
+
+// Count every allocation made by the program:
+
+void* operator new(size_t size) {
+	allocations.fetch_add(1, memory_order_relaxed);
+	void* ptr = malloc(size ? size : 1);
+	if (ptr == NULL) {
+		throw bad_alloc();
+	}
+	return ptr;
+}
+
+void operator delete(void* ptr) noexcept {
+	free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+	free(ptr);
+}
+
+
+///////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char** argv) {
+	Options options;
+	options.define("r|repeat=i:3", "number of times to read each file");
+	options.define("t|threads=i:1", "number of threads used for reading");
+	options.process(argc, argv);
+	if (options.getArgCount() == 0) {
+		cerr << "Usage: " << options.getCommand()
+		     << " [-r count] [-t threads] file(s)" << endl;
+		return 1;
+	}
+	int repeat = options.getInteger("repeat");
+	if (repeat < 1) {
+		repeat = 1;
+	}
+	int threads = options.getInteger("threads");
+	for (int i=0; i<options.getArgCount(); i++) {
+		benchmarkFile(options.getArg(i+1), repeat, threads);
+	}
+	return 0;
+}
+
+
+///////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////
+//
+// benchmarkFile -- Read and clear the file repeatedly with both kinds of
+//    storage, and print the allocation count and best times of each.
+//
+
+void benchmarkFile(const string& filename, int repeat, int threads) {
+	cout << filename << endl;
+	for (int arenaQ=0; arenaQ<2; arenaQ++) {
+		double bestread = -1.0;
+		double bestclear = -1.0;
+		long count = 0;
+		for (int i=0; i<repeat; i++) {
+			double readtime;
+			double cleartime;
+			readAndClear(filename, arenaQ, threads, readtime, cleartime, count);
+			if ((bestread < 0.0) || (readtime < bestread)) {
+				bestread = readtime;
+			}
+			if ((bestclear < 0.0) || (cleartime < bestclear)) {
+				bestclear = cleartime;
+			}
+		}
+		cout << (arenaQ ? "\tarena" : "\theap ")
+		     << "\tallocations: " << count
+		     << "\tread: " << bestread * 1000.0 << " ms"
+		     << "\tclear: " << bestclear * 1000.0 << " ms" << endl;
+	}
+}
+
+
+
+//////////////////////////////
+//
+// readAndClear -- Read the file and then delete its events, measuring
+//    the time of each step and the allocations made while reading.
+//
+
+void readAndClear(const string& filename, bool arenaQ, int threads,
+		double& readtime, double& cleartime, long& count) {
+	MidiFile midifile;
+	midifile.setThreadCount(threads);
+	midifile.setArenaStorage(arenaQ);
+
+	long before = allocations.load();
+	auto start = chrono::steady_clock::now();
+	midifile.read(filename);
+	readtime = elapsed(start);
+	count = allocations.load() - before;
+	if (!midifile.status()) {
+		cerr << "Error reading " << filename << endl;
+	}
+
+	start = chrono::steady_clock::now();
+	midifile.clear();
+	cleartime = elapsed(start);
+}
+
+
+
+//////////////////////////////
+//
+// elapsed -- Return the number of seconds since start.
+//
+
+double elapsed(chrono::steady_clock::time_point start) {
+	chrono::duration<double> duration = chrono::steady_clock::now() - start;
+	return duration.count();
+}
+
+
+
@@ -0,0 +1,514 @@
+//
+// Creation Date: Fri Oct 16 19:05:22 JST 2026
+// Last Modified: Fri Oct 16 19:05:22 JST 2026
+// Filename:      midifile/tools/corpusstats.cpp
+// Syntax:        C++11
+// vim:           ts=3
+//
+// Description:   Search directories for MIDI files and print statistics
+//                for each file as CSV or JSON lines.  Files are read
+//                concurrently with MidiEventCursor objects which are
+//                reused for every file read by a thread, so memory use
+//                does not depend on the number or size of the files.
+//                The number of files read per second is printed to
+//                standard error at the end.
+//
+
+#include "MidiEventCursor.h"
+#include "MidiThreadPool.h"
+#include "Options.h"
+
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <queue>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace smf;
+
+// Statistics for one file:
+class FileStats {
+	public:
+		string path;
+		bool   ok        = false;
+		int    type      = 0;
+		int    tracks    = 0;
+		int    tpq       = 0;
+		int    ticks     = 0;
+		double seconds   = 0.0;
+		long   events    = 0;
+		long   notes     = 0;
+		int    tempos    = 0;
+		int    lowest    = -1;
+		int    highest   = -1;
+};
+
+// Bounded list of filenames waiting to be read.  The directory search
+// waits when the list is full, so the list does not grow with the size
+// of the corpus.
+class PathQueue {
+	public:
+		PathQueue(size_t capacity) : m_capacity(capacity) { }
+		void push   (const string& path);
+		bool pop    (string& path);
+		void finish (void);
+	private:
+		queue<string>      m_paths;
+		size_t             m_capacity;
+		bool               m_finished = false;
+		mutex              m_mutex;
+		condition_variable m_notEmpty;
+		condition_variable m_notFull;
+};
+
+// Function declarations:
+void   checkOptions     (Options& opts, int argc, char* argv[]);
+void   usage            (const char* command);
+void   searchInputs     (const vector<string>& inputs, PathQueue& paths,
+                         bool allQ);
+void   searchDirectory  (const string& directory, PathQueue& paths, bool allQ);
+bool   hasMidiExtension (const string& filename);
+void   readFile         (MidiEventCursor& cursor, FileStats& stats);
+void   printHeader      (ostream& out);
+void   printStats       (ostream& out, const FileStats& stats);
+string csvString        (const string& text);
+string jsonString       (const string& text);
+double elapsed          (chrono::steady_clock::time_point start);
+
+// User interface variables:
+Options options;
+bool    jsonQ    = false;   // used with -j option
+int     progress = 0;       // used with -p option
+
+
+///////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char* argv[]) {
+	checkOptions(options, argc, argv);
+
+	int threads = options.getInteger("threads");
+	if (threads < 1) {
+		threads = MidiThreadPool::getHardwareThreads();
+	}
+
+	ofstream outfile;
+	ostream* out = &cout;
+	if (options.getBoolean("output")) {
+		outfile.open(options.getString("output").c_str());
+		if (!outfile.is_open()) {
+			cerr << "Error: cannot write to " << options.getString("output") << endl;
+			return 1;
+		}
+		out = &outfile;
+	}
+	printHeader(*out);
+
+	auto start = chrono::steady_clock::now();
+	long files = 0;
+	long errors = 0;
+	mutex outputMutex;
+
+	PathQueue paths(threads * 64);
+	vector<string> inputs;
+	for (int i=0; i<options.getArgCount(); i++) {
+		inputs.push_back(options.getArg(i+1));
+	}
+	bool allQ = options.getBoolean("all");
+	thread search([&]() { searchInputs(inputs, paths, allQ); });
+
+	MidiThreadPool pool(threads);
+	pool.run(threads, [&](int) {
+		MidiEventCursor cursor;
+		FileStats stats;
+		string line;
+		while (paths.pop(stats.path)) {
+			readFile(cursor, stats);
+			stringstream text;
+			text << fixed << setprecision(3);
+			printStats(text, stats);
+			line = text.str();
+
+			lock_guard<mutex> lock(outputMutex);
+			*out << line;
+			files++;
+			if (!stats.ok) {
+				errors++;
+			}
+			if ((progress > 0) && (files % progress == 0)) {
+				cerr << files << " files, " << files / elapsed(start)
+				     << " files/sec" << endl;
+			}
+		}
+	});
+	search.join();
+	out->flush();
+
+	double seconds = elapsed(start);
+	cerr << files << " files (" << errors << " with errors) in " << seconds
+	     << " seconds, " << (seconds > 0.0 ? files / seconds : 0.0)
+	     << " files/sec with " << threads << " threads" << endl;
+	return 0;
+}
+
+
+///////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////
+//
+// PathQueue::push -- Add a filename to the queue, waiting while the
+//    queue is full.
+//
+
+void PathQueue::push(const string& path) {
+	unique_lock<mutex> lock(m_mutex);
+	m_notFull.wait(lock, [this]() { return m_paths.size() < m_capacity; });
+	m_paths.push(path);
+	m_notEmpty.notify_one();
+}
+
+
+
+//////////////////////////////
+//
+// PathQueue::pop -- Remove the next filename from the queue, waiting
+//    while the queue is empty.  Returns false when the queue is empty
+//    and no more filenames will be added.
+//
+
+bool PathQueue::pop(string& path) {
+	unique_lock<mutex> lock(m_mutex);
+	m_notEmpty.wait(lock, [this]() { return m_finished || !m_paths.empty(); });
+	if (m_paths.empty()) {
+		return false;
+	}
+	path = m_paths.front();
+	m_paths.pop();
+	m_notFull.notify_one();
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// PathQueue::finish -- Indicate that no more filenames will be added.
+//
+
+void PathQueue::finish(void) {
+	lock_guard<mutex> lock(m_mutex);
+	m_finished = true;
+	m_notEmpty.notify_all();
+}
+
+
+
+//////////////////////////////
+//
+// searchInputs -- Add the files given on the command line to the queue,
+//    and the MIDI files found in directories given on the command line.
+//
+
+void searchInputs(const vector<string>& inputs, PathQueue& paths, bool allQ) {
+	for (int i=0; i<(int)inputs.size(); i++) {
+		const string& path = inputs[i];
+		struct stat info;
+		if (stat(path.c_str(), &info) != 0) {
+			cerr << "Error: cannot find " << path << endl;
+		} else if (S_ISDIR(info.st_mode)) {
+			searchDirectory(path, paths, allQ);
+		} else {
+			paths.push(path);
+		}
+	}
+	paths.finish();
+}
+
+
+
+//////////////////////////////
+//
+// searchDirectory -- Add the MIDI files in a directory and its
+//    subdirectories to the queue.  Symbolic links to directories are
+//    not followed, to avoid loops.  Files are added in alphabetical
+//    order within each directory.
+//
+
+void searchDirectory(const string& directory, PathQueue& paths, bool allQ) {
+	DIR* dir = opendir(directory.c_str());
+	if (dir == NULL) {
+		cerr << "Error: cannot read directory " << directory << endl;
+		return;
+	}
+	vector<string> names;
+	struct dirent* entry;
+	while ((entry = readdir(dir)) != NULL) {
+		string name = entry->d_name;
+		if ((name != ".") && (name != "..")) {
+			names.push_back(name);
+		}
+	}
+	closedir(dir);
+	sort(names.begin(), names.end());
+
+	string prefix = directory;
+	if (prefix.empty() || (prefix.back() != '/')) {
+		prefix += '/';
+	}
+	for (int i=0; i<(int)names.size(); i++) {
+		string path = prefix + names[i];
+		struct stat info;
+		if (lstat(path.c_str(), &info) != 0) {
+			continue;
+		}
+		if (S_ISDIR(info.st_mode)) {
+			searchDirectory(path, paths, allQ);
+			continue;
+		}
+		if (S_ISLNK(info.st_mode)) {
+			if ((stat(path.c_str(), &info) != 0) || !S_ISREG(info.st_mode)) {
+				continue;
+			}
+		} else if (!S_ISREG(info.st_mode)) {
+			continue;
+		}
+		if (allQ || hasMidiExtension(names[i])) {
+			paths.push(path);
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// hasMidiExtension -- Returns true if the filename ends in .mid, .midi,
+//    .smf or .kar (in upper or lower case).
+//
+
+bool hasMidiExtension(const string& filename) {
+	size_t dot = filename.rfind('.');
+	if (dot == string::npos) {
+		return false;
+	}
+	string extension = filename.substr(dot + 1);
+	for (int i=0; i<(int)extension.size(); i++) {
+		extension[i] = (char)tolower((uchar)extension[i]);
+	}
+	return (extension == "mid") || (extension == "midi") ||
+			(extension == "smf") || (extension == "kar");
+}
+
+
+
+//////////////////////////////
+//
+// readFile -- Read the events of a file and calculate its statistics.
+//    The duration is the time of the last event, using the tempo changes
+//    in all tracks (120 bpm until the first tempo change).
+//
+
+void readFile(MidiEventCursor& cursor, FileStats& stats) {
+	string path = stats.path;
+	stats = FileStats();
+	stats.path = path;
+	if (!cursor.open(path)) {
+		return;
+	}
+	stats.type = cursor.getType();
+	stats.tracks = cursor.getTrackCount();
+	stats.tpq = cursor.getTicksPerQuarterNote();
+
+	while (cursor.next()) {
+		stats.events++;
+		stats.ticks = max(stats.ticks, cursor.getTick());
+		int command = cursor.getCommandByte();
+		if ((command & 0xf0) == 0x90) {
+			const uchar* payload = cursor.getPayload();
+			if ((cursor.getPayloadSize() >= 2) && (payload[1] > 0)) {
+				stats.notes++;
+				if ((stats.lowest < 0) || (payload[0] < stats.lowest)) {
+					stats.lowest = payload[0];
+				}
+				if (payload[0] > stats.highest) {
+					stats.highest = payload[0];
+				}
+			}
+		}
+	}
+	stats.ok = cursor.status();
+	stats.tempos = cursor.getTempoCount();
+	stats.seconds = cursor.getTimeInSeconds(stats.ticks);
+	cursor.close();
+}
+
+
+
+//////////////////////////////
+//
+// printHeader -- Print the column names for CSV output.
+//
+
+void printHeader(ostream& out) {
+	if (jsonQ) {
+		return;
+	}
+	out << "path,ok,type,tracks,tpq,ticks,seconds,events,notes,tempos,"
+	    << "lowest,highest" << endl;
+}
+
+
+
+//////////////////////////////
+//
+// printStats -- Print the statistics for one file as a CSV line or as
+//    a JSON object on one line.  The note range is empty (null) for
+//    files without notes.
+//
+
+void printStats(ostream& out, const FileStats& stats) {
+	if (jsonQ) {
+		out << "{\"path\":" << jsonString(stats.path)
+		    << ",\"ok\":" << (stats.ok ? "true" : "false")
+		    << ",\"type\":" << stats.type
+		    << ",\"tracks\":" << stats.tracks
+		    << ",\"tpq\":" << stats.tpq
+		    << ",\"ticks\":" << stats.ticks
+		    << ",\"seconds\":" << stats.seconds
+		    << ",\"events\":" << stats.events
+		    << ",\"notes\":" << stats.notes
+		    << ",\"tempos\":" << stats.tempos;
+		if (stats.notes > 0) {
+			out << ",\"lowest\":" << stats.lowest
+			    << ",\"highest\":" << stats.highest;
+		} else {
+			out << ",\"lowest\":null,\"highest\":null";
+		}
+		out << "}\n";
+		return;
+	}
+
+	out << csvString(stats.path) << ',' << (stats.ok ? 1 : 0) << ','
+	    << stats.type << ',' << stats.tracks << ',' << stats.tpq << ','
+	    << stats.ticks << ',' << stats.seconds << ',' << stats.events << ','
+	    << stats.notes << ',' << stats.tempos << ',';
+	if (stats.notes > 0) {
+		out << stats.lowest << ',' << stats.highest;
+	} else {
+		out << ',';
+	}
+	out << '\n';
+}
+
+
+
+//////////////////////////////
+//
+// csvString -- Quote a string for CSV output if it contains a comma,
+//    quote or newline.
+//
+
+string csvString(const string& text) {
+	if (text.find_first_of(",\"\r\n") == string::npos) {
+		return text;
+	}
+	string output = "\"";
+	for (int i=0; i<(int)text.size(); i++) {
+		if (text[i] == '"') {
+			output += '"';
+		}
+		output += text[i];
+	}
+	output += '"';
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// jsonString -- Quote a string for JSON output.  Bytes which are not
+//    ASCII are copied unchanged, so UTF-8 filenames stay valid.
+//
+
+string jsonString(const string& text) {
+	string output = "\"";
+	for (int i=0; i<(int)text.size(); i++) {
+		uchar ch = (uchar)text[i];
+		if ((ch == '"') || (ch == '\\')) {
+			output += '\\';
+			output += (char)ch;
+		} else if (ch < 0x20) {
+			char buffer[8];
+			snprintf(buffer, sizeof(buffer), "\\u%04x", ch);
+			output += buffer;
+		} else {
+			output += (char)ch;
+		}
+	}
+	output += '"';
+	return output;
+}
+
+
+
+//////////////////////////////
+//
+// elapsed -- Return the number of seconds since the start time.
+//
+
+double elapsed(chrono::steady_clock::time_point start) {
+	chrono::duration<double> duration = chrono::steady_clock::now() - start;
+	return duration.count();
+}
+
+
+
+//////////////////////////////
+//
+// checkOptions --
+//
+
+void checkOptions(Options& opts, int argc, char* argv[]) {
+	opts.define("t|threads=i:0", "number of threads (0 = all processors)");
+	opts.define("o|output=s", "write the statistics to a file");
+	opts.define("j|json|jsonl=b", "print JSON lines instead of CSV");
+	opts.define("a|all=b", "read all files, not only .mid/.midi/.smf/.kar");
+	opts.define("p|progress=i:0", "print the speed after every n files");
+	opts.define("h|help=b", "short description");
+	opts.process(argc, argv);
+
+	if (opts.getBoolean("help") || (opts.getArgCount() == 0)) {
+		usage(opts.getCommand().c_str());
+		exit(opts.getBoolean("help") ? 0 : 1);
+	}
+	jsonQ = opts.getBoolean("json");
+	progress = opts.getInteger("progress");
+}
+
+
+
+//////////////////////////////
+//
+// usage --
+//
+
+void usage(const char* command) {
+	cerr << "Usage: " << command << " [-t threads] [-j] [-o output] "
+	     << "directory/file(s)" << endl;
+}
+
+
+
@@ -13,6 +13,7 @@
 
 #include "Options.h"
 #include "MidiFile.h"
+#include "MidiNoteTable.h"
 #include <iostream>
 
 using namespace std;
@@ -48,11 +49,12 @@ int main(int argc, char** argv) {
    }
 
    int tpq = midifile.getTicksPerQuarterNote();
-   midifile.linkNotePairs();
+   MidiNoteTable notes;
    if (joinQ) {
+      // pair notes within each track before joining
+      notes.build(midifile);
       midifile.joinTracks();
    }
-   MidiEvent* mev;
    double duration;
 
    if (secondsQ) {
@@ -69,29 +71,26 @@ int main(int argc, char** argv) {
    cout << "============================\n";
 
    for (int track=0; track < midifile.getTrackCount(); track++) {
-      for (int i=0; i<midifile[track].size(); i++) {
-         mev = &midifile[track][i];
-         if (!mev->isNoteOn()) {
-            continue;
-         }
-         if (secondsQ) {
-            duration = mev->getDurationInSeconds();
-         } else {
-            duration = mev->getTickDuration();
-         }
-
+      if (!joinQ) {
+         notes.build(midifile[track]);
+      }
+      for (int i=0; i<notes.getNoteCount(); i++) {
          if (secondsQ) {
-            cout << mev->seconds << '\t';
+            double start = midifile.getTimeInSeconds(notes.getStartTick(i));
+            duration = midifile.getTimeInSeconds(notes.getEndTick(i)) - start;
+            cout << start << '\t';
             cout << duration << '\t';
          } else if (quarterQ) {
-            cout << mev->tick/tpq << '\t';
+            duration = notes.getTickDuration(i);
+            cout << notes.getStartTick(i)/tpq << '\t';
             cout << duration/tpq << '\t';
          } else {
-            cout << mev->tick << '\t';
+            duration = notes.getTickDuration(i);
+            cout << notes.getStartTick(i) << '\t';
             cout << duration << '\t';
          }
-         cout << mev->track << '\t';
-         cout << mev->getKeyNumber();
+         cout << notes.getTrack(i) << '\t';
+         cout << notes.getKey(i);
          cout << endl;
       }
       if (midifile.getTrackCount() > 1) {
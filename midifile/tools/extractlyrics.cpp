@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Sun Apr 15 19:09:11 PDT 2018
-// Last Modified: Sun Apr 15 19:09:22 PDT 2018
+// Last Modified: Fri Oct 16 16:05:31 JST 2026 Read events with MidiEventCursor.
 // Filename:      midifile/tools/extractlyrics.cpp
 // Syntax:        C++11
 //
@@ -10,14 +10,18 @@
 //                that the lyric occurs at.
 //
 
-#include "MidiFile.h"
+#include "MidiEventCursor.h"
 #include "Options.h"
+
+#include <algorithm>
 #include <iostream>
+#include <utility>
+#include <vector>
 
 using namespace std;
 using namespace smf;
 
-void extractLyrics(MidiFile& midifile, int seconds);
+void   extractLyrics     (MidiEventCursor& cursor, int seconds);
 
 ///////////////////////////////////////////////////////////////////////////
 
@@ -26,17 +30,17 @@ int main(int argc, char** argv) {
    options.define("s|seconds|timestamp=b", "display timestamp for lyrics");
    options.process(argc, argv);
 
-   MidiFile midifile;
+   MidiEventCursor cursor;
    if (options.getArgCount() == 0) {
-      midifile.read(cin);
+      cursor.open(cin);
    } else if (options.getArgCount() == 1) {
-      midifile.read(options.getArg(1));
+      cursor.open(options.getArg(1));
    } else {
       cerr << "Too many filenames" << endl;
       exit(1);
    }
 
-   extractLyrics(midifile, options.getBoolean("seconds"));
+   extractLyrics(cursor, options.getBoolean("seconds"));
    return 0;
 }
 
@@ -44,27 +48,30 @@ int main(int argc, char** argv) {
 //////////////////////////////
 //
 // extractLyrics -- Extract lyrics from MIDI file, one lyric per output line.
+//    Without timestamps the lyrics are printed while reading; otherwise
+//    they are printed at the end since a tempo change in a later track
+//    can change the time of an earlier lyric.
 //
 
-void extractLyrics(MidiFile& midifile, int seconds) {
-   if (seconds) {
-      midifile.doTimeAnalysis();
-   }
-   for (int i=0; i<midifile.size(); i++) {
-      for (int j=0; j<midifile[i].size(); j++) {
-         if (!midifile[i][j].isLyricText()) {
-            continue;
-         }
-         string lyric = midifile[i][j].getMetaContent();
+void extractLyrics(MidiEventCursor& cursor, int seconds) {
+   vector<pair<int, string>> lyrics;
+   while (cursor.next()) {
+      if (cursor.getMetaType() == 0x05) {
          if (seconds) {
-            cout << midifile[i][j].seconds << "\t";
+            lyrics.push_back(make_pair(cursor.getTick(), cursor.getMetaText()));
+         } else {
+            cout << cursor.getMetaText() << endl;
          }
-         cout << lyric << endl;
       }
    }
+   for (int i=0; i<(int)lyrics.size(); i++) {
+      cout << cursor.getTimeInSeconds(lyrics[i].first) << "\t";
+      cout << lyrics[i].second << endl;
+   }
 }
 
 
+
 /* Test data: 
 
 "MThd"
@@ -0,0 +1,168 @@
+//
+// Creation Date: Sat Oct 17 17:14:26 JST 2026
+// Last Modified: Sat Oct 17 17:14:26 JST 2026
+// Filename:      midifile/tools/joinbench.cpp
+// Syntax:        C++11
+// vim:           ts=3
+//
+// Description:   Time MidiFile::joinTracks(), mergeTracks() and
+//                doTimeAnalysis() on generated files with different numbers
+//                of tracks, and compare joining with sorting all of the
+//                events with qsort() and eventcompare().  Exits with an
+//                error if the joined events are not in the same order as
+//                the qsort() result.
+//
+
+#include "MidiFile.h"
+#include "Options.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <vector>
+
+using namespace std;
+using namespace smf;
+
+void   buildFile       (MidiFile& midifile, int events, int tracks,
+                        mt19937& random);
+bool   benchmarkTracks (int events, int tracks, mt19937& random);
+double elapsed         (chrono::steady_clock::time_point start);
+
+
+///////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char** argv) {
+	Options options;
+	options.define("n|events=i:2000000", "number of events in each file");
+	options.define("t|tracks=s:2,16,100,1000", "comma-separated track counts");
+	options.define("s|seed=i:1", "seed for the generated events");
+	options.process(argc, argv);
+	int events = options.getInteger("events");
+	mt19937 random(options.getInteger("seed"));
+
+	bool ok = true;
+	stringstream counts(options.getString("tracks"));
+	string count;
+	while (getline(counts, count, ',')) {
+		int tracks = atoi(count.c_str());
+		if (tracks > 0) {
+			ok &= benchmarkTracks(events, tracks, random);
+		}
+	}
+	if (!ok) {
+		cerr << "FAILED: joined events are not in eventcompare() order" << endl;
+		return 1;
+	}
+	return 0;
+}
+
+
+///////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////
+//
+// benchmarkTracks -- Time the functions for one number of tracks.
+//     Returns false if joinTracks() gives a different order than qsort().
+//
+
+bool benchmarkTracks(int events, int tracks, mt19937& random) {
+	MidiFile midifile;
+	buildFile(midifile, events, tracks, random);
+	midifile.markSequence();
+
+	vector<MidiEvent*> expected;
+	for (int i=0; i<midifile.getTrackCount(); i++) {
+		for (int j=0; j<midifile.getEventCount(i); j++) {
+			expected.push_back(&midifile[i][j]);
+		}
+	}
+	auto start = chrono::steady_clock::now();
+	qsort(expected.data(), expected.size(), sizeof(MidiEvent*), eventcompare);
+	double qsorttime = elapsed(start);
+
+	start = chrono::steady_clock::now();
+	midifile.joinTracks();
+	double jointime = elapsed(start);
+	bool ok = true;
+	for (int i=0; i<midifile.getEventCount(0); i++) {
+		if (&midifile[0][i] != expected[i]) {
+			cerr << "Joined event " << i << " differs from qsort() with "
+			     << tracks << " tracks" << endl;
+			ok = false;
+			break;
+		}
+	}
+
+	midifile.splitTracks();
+	start = chrono::steady_clock::now();
+	midifile.doTimeAnalysis();
+	double maptime = elapsed(start);
+
+	start = chrono::steady_clock::now();
+	if (midifile.getTrackCount() > 1) {
+		midifile.mergeTracks(0, 1);
+	}
+	double mergetime = elapsed(start);
+
+	cout << "tracks: " << tracks
+	     << "\tjoinTracks: " << jointime
+	     << "\tqsort: " << qsorttime
+	     << "\tdoTimeAnalysis: " << maptime
+	     << "\tmergeTracks: " << mergetime << " sec" << endl;
+	return ok;
+}
+
+
+
+//////////////////////////////
+//
+// buildFile -- Fill the tracks with notes, controllers and tempo
+//     messages in tick order, with many events at the same ticks.
+//
+
+void buildFile(MidiFile& midifile, int events, int tracks,
+		mt19937& random) {
+	midifile.addTracks(tracks - 1);
+	for (int i=0; i<tracks; i++) {
+		int count = events / tracks + (i < events % tracks ? 1 : 0);
+		int tick = 0;
+		MidiEventList& list = midifile[i];
+		list.reserve(count);
+		for (int j=0; j<count; j++) {
+			tick += random() % 3;
+			int type = random() % 100;
+			int channel = i % 16;
+			if (type < 45) {
+				list.emplace_back(0x90 | channel, 36 + random() % 48, 1 + random() % 127);
+			} else if (type < 90) {
+				list.emplace_back(0x80 | channel, 36 + random() % 48, 0);
+			} else if (type < 99) {
+				list.emplace_back(0xb0 | channel, random() % 128, random() % 128);
+			} else {
+				MidiEvent event;
+				event.makeTempo(60 + random() % 120);
+				list.push_back(std::move(event));
+			}
+			list.back().tick = tick;
+			list.back().track = i;
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// elapsed -- Return the number of seconds since start.
+//
+
+double elapsed(chrono::steady_clock::time_point start) {
+	chrono::duration<double> duration = chrono::steady_clock::now() - start;
+	return duration.count();
+}
+
+
+
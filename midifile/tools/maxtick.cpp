@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Mon Apr 16 07:25:01 PDT 2018
-// Last Modified: Mon Apr 16 08:01:18 PDT 2018
+// Last Modified: Fri Oct 16 16:05:31 JST 2026 Read events with MidiEventCursor.
 // Filename:      midifile/tools/maxtick.cpp
 // Syntax:        C++11
 // vim:           ts=3
@@ -9,15 +9,17 @@
 // Description:   Calculate the maximum timestamp in a MIDI file.
 //
 
-#include "MidiFile.h"
+#include "MidiEventCursor.h"
 #include "Options.h"
 
+#include <algorithm>
 #include <iostream>
 
 using namespace std;
 using namespace smf;
 
-void processFile(MidiFile& midifile, Options& options);
+bool   processFile       (MidiEventCursor& cursor, Options& options,
+                          const string& label);
 
 
 ///////////////////////////////////////////////////////////////////////////
@@ -27,22 +29,26 @@ int main(int argc, char** argv) {
 	options.define("s|seconds=b",  "display total time in seconds");
 	options.define("q|quarters=b", "display total time in quarter notes");
 	options.process(argc, argv);
-	MidiFile midifile;
+	MidiEventCursor cursor;
+	bool ok = true;
 	if (options.getArgCount() == 0) {
-		midifile.read(cin);
-		processFile(midifile, options);
+		cursor.open(cin);
+		if (!processFile(cursor, options, "")) {
+			cerr << "Error: cannot read input" << endl;
+			ok = false;
+		}
 	} else {
 		int count = options.getArgCount();
 		for (int i=0; i<count; i++) {
 			string filename = options.getArg(i+1);
-			if (count > 1) {
-				cout << filename << "\t";
+			cursor.open(filename);
+			if (!processFile(cursor, options, count > 1 ? filename : "")) {
+				cerr << "Error: cannot read " << filename << endl;
+				ok = false;
 			}
-			midifile.read(filename);
-			processFile(midifile, options);
 		}
 	}
-	return 0;
+	return ok ? 0 : 1;
 }
 
 
@@ -50,18 +56,35 @@ int main(int argc, char** argv) {
 
 //////////////////////////////
 //
-// processFile --
+// processFile -- Scan the events once, keeping only the largest tick
+//     and the tempo changes (which the cursor keeps).  The result is
+//     printed after the label (if any), or nothing is printed and false
+//     is returned if the file could not be read to the end.
 //
 
-void processFile(MidiFile& midifile, Options& options) {
-	cout << "maxtick=" << midifile.getFileDurationInTicks();
+bool processFile(MidiEventCursor& cursor, Options& options,
+		const string& label) {
+	int maxtick = 0;
+	while (cursor.next()) {
+		maxtick = max(maxtick, cursor.getTick());
+	}
+	if (!cursor.status()) {
+		return false;
+	}
+
+	int tpq = cursor.getTicksPerQuarterNote();
+	if (!label.empty()) {
+		cout << label << "\t";
+	}
+	cout << "maxtick=" << maxtick;
 	if (options.getBoolean("quarters")) {
-		cout << "\tquarters=" << midifile.getFileDurationInQuarters();
+		cout << "\tquarters=" << (double)maxtick / (double)tpq;
 	}
 	if (options.getBoolean("seconds")) {
-		cout << "\tseconds=" << midifile.getFileDurationInSeconds();
+		cout << "\tseconds=" << cursor.getTimeInSeconds(maxtick);
 	}
 	cout << endl;
+	return true;
 }
 
 
@@ -11,6 +11,7 @@
 //
 
 #include "MidiFile.h"
+#include "MidiTimeline.h"
 #include "Options.h"
 
 #include <iostream>
@@ -78,38 +79,33 @@ int main(int argc, char** argv)
     }
 
     midifile.linkNotePairs();
-    midifile.joinTracks();
     midifile.doTimeAnalysis();
 
-    midifile.absoluteTicks();
-
+    // play the notes of all tracks in time order, without joining them:
     double lastNoteFinished = 0.0;
-    for (int track=0; track < midifile.getTrackCount(); track++) {
-        for (int i=0; i<midifile[track].size(); i++) {
-            MidiEvent* mev = &midifile[track][i];
-            if (!mev->isNoteOn() || mev->getLinkedEvent() == NULL) {
-                continue;
-            }
-
-            // pause, silence
-            int silence = static_cast<int>((midifile.getTimeInSeconds(mev->tick) - lastNoteFinished) * 1000 * 1000);
-            if(silence >0)
-            {
-                usleep(silence);
-            }
+    MidiTimeline timeline(midifile);
+    while (timeline.next()) {
+        const MidiEvent* mev = &timeline.getEvent();
+        if (!mev->isNoteOn() || mev->getLinkedEvent() == NULL) {
+            continue;
+        }
 
-            double duration = mev->getDurationInSeconds();
+        // pause, silence
+        int silence = static_cast<int>((timeline.getSeconds() - lastNoteFinished) * 1000 * 1000);
+        if(silence >0)
+        {
+            usleep(silence);
+        }
 
-            int halfTonesFromA4 = mev->getKeyNumber() - 69; // 69 == A4 == 440Hz
-            int frq = 440 * pow(2, halfTonesFromA4/12.0);
+        double duration = mev->getDurationInSeconds();
 
-            // play note
-            beep(frq, static_cast<int>(duration*1000*1000));
+        int halfTonesFromA4 = mev->getKeyNumber() - 69; // 69 == A4 == 440Hz
+        int frq = 440 * pow(2, halfTonesFromA4/12.0);
 
-            MidiEvent* off = mev->getLinkedEvent();
-            lastNoteFinished = midifile.getTimeInSeconds(off->tick);
+        // play note
+        beep(frq, static_cast<int>(duration*1000*1000));
 
-        }
+        lastNoteFinished = timeline.getSeconds() + duration;
     }
 
     return 0;
@@ -0,0 +1,95 @@
+//
+// Creation Date: Fri Oct 16 19:48:10 JST 2026
+// Last Modified: Fri Oct 16 19:48:10 JST 2026
+// Filename:      midifile/tools/midiprobe.cpp
+// Syntax:        C++11
+// vim:           ts=3
+//
+// Description:   Print the header information, first tempo and time
+//                signature, and the size and name of each track in MIDI
+//                files, using MidiProbe so that note data is not read.
+//
+
+#include "MidiProbe.h"
+#include "Options.h"
+
+#include <chrono>
+#include <iostream>
+
+using namespace std;
+using namespace smf;
+
+void   printProbe      (const string& filename, MidiProbe& probe);
+
+
+///////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char** argv) {
+	Options options;
+	options.define("t|time=b", "print the time taken to probe each file");
+	options.process(argc, argv);
+	if (options.getArgCount() == 0) {
+		cerr << "Usage: " << options.getCommand() << " [-t] file(s)" << endl;
+		return 1;
+	}
+	bool timeQ = options.getBoolean("time");
+	MidiProbe probe;
+	int status = 0;
+	for (int i=0; i<options.getArgCount(); i++) {
+		const string& filename = options.getArg(i+1);
+		auto start = chrono::steady_clock::now();
+		bool okQ = probe.probe(filename);
+		chrono::duration<double> duration = chrono::steady_clock::now() - start;
+		if (!okQ) {
+			status = 1;
+			continue;
+		}
+		printProbe(filename, probe);
+		if (timeQ) {
+			cout << "probe time:\t" << duration.count() * 1.0e6 << " us" << endl;
+		}
+	}
+	return status;
+}
+
+
+///////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////
+//
+// printProbe -- Print the information found for a file.
+//
+
+void printProbe(const string& filename, MidiProbe& probe) {
+	cout << "file:\t" << filename << endl;
+	cout << "type:\t" << probe.getType() << endl;
+	cout << "tpq:\t" << probe.getTicksPerQuarterNote() << endl;
+	cout << "tempo:\t";
+	if (probe.hasTempo()) {
+		cout << probe.getTempoBPM() << " bpm at tick " << probe.getTempoTick();
+	} else {
+		cout << "none";
+	}
+	cout << endl;
+	cout << "meter:\t";
+	if (probe.hasTimeSignature()) {
+		cout << probe.getTimeSignatureTop() << "/"
+		     << probe.getTimeSignatureBottom() << " at tick "
+		     << probe.getTimeSignatureTick();
+	} else {
+		cout << "none";
+	}
+	cout << endl;
+	cout << "tracks:\t" << probe.getTrackCount() << endl;
+	for (int i=0; i<probe.getTrackCount(); i++) {
+		cout << "\t" << i << "\t" << probe.getTrackSize(i) << " bytes";
+		string name = probe.getTrackName(i);
+		if (!name.empty()) {
+			cout << "\t" << name;
+		}
+		cout << endl;
+	}
+}
+
+
+
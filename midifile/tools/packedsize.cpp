@@ -0,0 +1,287 @@
+//
+// Creation Date: Sat Oct 17 15:41:09 JST 2026
+// Last Modified: Sat Oct 17 15:41:09 JST 2026
+// Filename:      midifile/tools/packedsize.cpp
+// Syntax:        C++11
+// vim:           ts=3
+//
+// Description:   Compare the memory used by MIDI files read into MidiFile
+//                objects and into MidiPackedFile objects.  The heap bytes
+//                held by each MidiFile are counted, all of the packed
+//                files are kept in memory at once, and each packed file
+//                is checked against the MidiFile it was compared with.
+//                Exits with an error if a packed file does not have the
+//                same events and note pairs.
+//
+
+#include "MidiFile.h"
+#include "MidiPackedFile.h"
+#include "Options.h"
+
+#ifdef __APPLE__
+	#include <malloc/malloc.h>
+#else
+	#include <malloc.h>
+#endif
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <vector>
+
+using namespace std;
+using namespace smf;
+
+static atomic<long> liveBytes(0);
+
+bool   compareFile     (const MidiFile& midifile, const MidiPackedFile& packed);
+bool   compareEvent    (const MidiEventList& events, int index,
+                        const MidiPackedFile& packed, int track);
+
+
+// Count the bytes in use on the heap, as the allocator reports them for
+// each block (including its rounding up), so that the size of a deleted
+// block can be subtracted without storing it.  GCC must not inline these
+// functions into their callers, where it would find malloc() paired with
+// operator delete, or operator new paired with free().
+
+#ifdef __GNUC__
+	#define NOINLINE __attribute__((noinline))
+#else
+	#define NOINLINE
+#endif
+
+static size_t blockSize(void* ptr) {
+#if defined(_WIN32)
+	return _msize(ptr);
+#elif defined(__APPLE__)
+	return malloc_size(ptr);
+#else
+	return malloc_usable_size(ptr);
+#endif
+}
+
+static void* allocate(size_t size, size_t alignment) {
+	void* ptr = NULL;
+	if (alignment <= alignof(max_align_t)) {
+		ptr = malloc(size ? size : 1);
+	} else {
+#ifdef _WIN32
+		ptr = _aligned_malloc(size ? size : 1, alignment);
+#else
+		if (posix_memalign(&ptr, alignment, size ? size : 1) != 0) {
+			ptr = NULL;
+		}
+#endif
+	}
+	if (ptr == NULL) {
+		throw bad_alloc();
+	}
+	liveBytes.fetch_add(blockSize(ptr), memory_order_relaxed);
+	return ptr;
+}
+
+static void release(void* ptr, size_t alignment) {
+	if (ptr == NULL) {
+		return;
+	}
+	liveBytes.fetch_sub(blockSize(ptr), memory_order_relaxed);
+#ifdef _WIN32
+	if (alignment > alignof(max_align_t)) {
+		_aligned_free(ptr);
+		return;
+	}
+#else
+	(void)alignment;
+#endif
+	free(ptr);
+}
+
+NOINLINE void* operator new(size_t size) {
+	return allocate(size, 0);
+}
+
+NOINLINE void* operator new[](size_t size) {
+	return allocate(size, 0);
+}
+
+NOINLINE void operator delete(void* ptr) noexcept {
+	release(ptr, 0);
+}
+
+NOINLINE void operator delete[](void* ptr) noexcept {
+	release(ptr, 0);
+}
+
+NOINLINE void operator delete(void* ptr, size_t) noexcept {
+	release(ptr, 0);
+}
+
+NOINLINE void operator delete[](void* ptr, size_t) noexcept {
+	release(ptr, 0);
+}
+
+#ifdef __cpp_aligned_new
+
+NOINLINE void* operator new(size_t size, align_val_t alignment) {
+	return allocate(size, (size_t)alignment);
+}
+
+NOINLINE void* operator new[](size_t size, align_val_t alignment) {
+	return allocate(size, (size_t)alignment);
+}
+
+NOINLINE void operator delete(void* ptr, align_val_t alignment) noexcept {
+	release(ptr, (size_t)alignment);
+}
+
+NOINLINE void operator delete[](void* ptr, align_val_t alignment) noexcept {
+	release(ptr, (size_t)alignment);
+}
+
+NOINLINE void operator delete(void* ptr, size_t, align_val_t alignment) noexcept {
+	release(ptr, (size_t)alignment);
+}
+
+NOINLINE void operator delete[](void* ptr, size_t, align_val_t alignment)
+		noexcept {
+	release(ptr, (size_t)alignment);
+}
+
+#endif
+
+
+///////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char** argv) {
+	Options options;
+	options.process(argc, argv);
+	if (options.getArgCount() == 0) {
+		cerr << "Usage: " << options.getCommand() << " file.mid [file.mid ...]"
+		     << endl;
+		return 1;
+	}
+
+	vector<MidiPackedFile> corpus;
+	corpus.reserve(options.getArgCount());
+	long events = 0;
+	long fileBytes = 0;
+	bool ok = true;
+	for (int i=1; i<=options.getArgCount(); i++) {
+		string filename = options.getArg(i);
+		long before = liveBytes.load();
+		MidiFile midifile;
+		midifile.setThreadCount(1);
+		midifile.read(filename);
+		if (!midifile.status()) {
+			cerr << "Error: cannot read " << filename << endl;
+			ok = false;
+			continue;
+		}
+		long bytes = liveBytes.load() - before;
+		midifile.linkNotePairs();
+
+		corpus.emplace_back(filename);
+		const MidiPackedFile& packed = corpus.back();
+		if (!packed.status() || !compareFile(midifile, packed)) {
+			cerr << "Error: packed events differ in " << filename << endl;
+			corpus.pop_back();
+			ok = false;
+			continue;
+		}
+		MidiFile unpacked;
+		packed.unpack(unpacked);
+		if (!compareFile(unpacked, packed)) {
+			cerr << "Error: unpacked events differ in " << filename << endl;
+			ok = false;
+		}
+
+		events += packed.getEventCount();
+		fileBytes += bytes;
+		cout << filename << "\tevents: " << packed.getEventCount()
+		     << "\tMidiFile: " << bytes << "\tpacked: "
+		     << packed.getMemoryUsage() << endl;
+	}
+
+	long packedBytes = 0;
+	for (int i=0; i<(int)corpus.size(); i++) {
+		packedBytes += corpus[i].getMemoryUsage();
+	}
+	if (events > 0) {
+		cout << "total\tevents: " << events
+		     << "\tMidiFile bytes/event: " << (double)fileBytes / events
+		     << "\tpacked bytes/event: " << (double)packedBytes / events
+		     << "\tratio: " << (double)fileBytes / packedBytes << endl;
+	}
+	return ok ? 0 : 1;
+}
+
+
+///////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////
+//
+// compareFile -- Returns true if the packed file has the same tracks,
+//     events and note pairs as a MidiFile in absolute tick mode with
+//     linked note pairs.
+//
+
+bool compareFile(const MidiFile& midifile, const MidiPackedFile& packed) {
+	if (midifile.getTrackCount() != packed.getTrackCount()) {
+		return false;
+	}
+	if (midifile.getTicksPerQuarterNote() != packed.getTicksPerQuarterNote()) {
+		return false;
+	}
+	for (int i=0; i<midifile.getTrackCount(); i++) {
+		const MidiEventList& events = midifile[i];
+		if (events.getEventCount() != packed.getEventCount(i)) {
+			return false;
+		}
+		for (int j=0; j<events.getEventCount(); j++) {
+			if (!compareEvent(events, j, packed, i)) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// compareEvent -- Returns true if an event and its packed copy have the
+//     same tick, bytes and note pair.  Linked controllers are ignored.
+//
+
+bool compareEvent(const MidiEventList& events, int index,
+		const MidiPackedFile& packed, int track) {
+	const MidiEvent& event = events[index];
+	if (event.tick != packed.getTick(track, index)) {
+		return false;
+	}
+	if ((int)event.size() != packed.getSize(track, index)) {
+		return false;
+	}
+	const uchar* bytes = packed.getBytes(track, index);
+	for (int k=0; k<(int)event.size(); k++) {
+		if (event[k] != bytes[k]) {
+			return false;
+		}
+	}
+	if (!event.isNoteOn() && !event.isNoteOff()) {
+		return true;
+	}
+	int link = packed.getLinkedIndex(track, index);
+	const MidiEvent* linked = event.getLinkedEvent();
+	if (linked == NULL) {
+		return link < 0;
+	}
+	return (link >= 0) && (linked == &events[link]);
+}
+
+
+
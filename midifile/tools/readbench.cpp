@@ -0,0 +1,143 @@
+//
+// Creation Date: Fri Oct 16 09:12:40 JST 2026
+// Last Modified: Fri Oct 16 09:12:40 JST 2026
+// Filename:      midifile/tools/readbench.cpp
+// Syntax:        C++11
+// vim:           ts=3
+//
+// Description:   Compare the speed of reading MIDI files through an
+//                input stream with reading them from a memory mapping.
+//                The contents of the two readings are also compared.
+//
+
+#include "MidiFile.h"
+#include "MidiMemoryMap.h"
+#include "Options.h"
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+
+using namespace std;
+using namespace smf;
+
+void   benchmarkFile   (const string& filename, int repeat);
+bool   sameContents    (MidiFile& a, MidiFile& b);
+double elapsed         (chrono::steady_clock::time_point start);
+
+
+///////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char** argv) {
+	Options options;
+	options.define("r|repeat=i:5", "number of times to read each file");
+	options.process(argc, argv);
+	if (options.getArgCount() == 0) {
+		cerr << "Usage: " << options.getCommand() << " [-r count] file(s)" << endl;
+		return 1;
+	}
+	int repeat = options.getInteger("repeat");
+	if (repeat < 1) {
+		repeat = 1;
+	}
+	for (int i=0; i<options.getArgCount(); i++) {
+		benchmarkFile(options.getArg(i+1), repeat);
+	}
+	return 0;
+}
+
+
+///////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////
+//
+// benchmarkFile -- Read the file repeatedly with both methods and print
+//    the best time of each.
+//
+
+void benchmarkFile(const string& filename, int repeat) {
+	MidiFile streamed;
+	MidiFile mapped;
+	double streamtime = -1.0;
+	double maptime = -1.0;
+	size_t bytes = 0;
+
+	for (int i=0; i<repeat; i++) {
+		auto start = chrono::steady_clock::now();
+		fstream input(filename.c_str(), ios::binary | ios::in);
+		streamed.read(input);
+		double seconds = elapsed(start);
+		if ((streamtime < 0.0) || (seconds < streamtime)) {
+			streamtime = seconds;
+		}
+
+		start = chrono::steady_clock::now();
+		MidiMemoryMap mapping(filename);
+		mapped.read(mapping.data(), mapping.size());
+		bytes = mapping.size();
+		seconds = elapsed(start);
+		if ((maptime < 0.0) || (seconds < maptime)) {
+			maptime = seconds;
+		}
+	}
+
+	double megabytes = bytes / 1048576.0;
+	cout << filename << endl;
+	cout << "\tistream: " << streamtime * 1000.0 << " ms\t"
+	     << megabytes / streamtime << " MB/s" << endl;
+	cout << "\tmmap:    " << maptime * 1000.0 << " ms\t"
+	     << megabytes / maptime << " MB/s" << endl;
+	cout << "\tspeedup: " << streamtime / maptime << endl;
+	if (!sameContents(streamed, mapped)) {
+		cout << "\tERROR: the two readings differ" << endl;
+	}
+}
+
+
+
+//////////////////////////////
+//
+// sameContents -- Returns true if the two files have the same tracks
+//    and events.
+//
+
+bool sameContents(MidiFile& a, MidiFile& b) {
+	if ((a.status() != b.status()) || (a.getTPQ() != b.getTPQ())) {
+		return false;
+	}
+	if (a.getTrackCount() != b.getTrackCount()) {
+		return false;
+	}
+	for (int i=0; i<a.getTrackCount(); i++) {
+		if (a[i].size() != b[i].size()) {
+			return false;
+		}
+		for (int j=0; j<a[i].size(); j++) {
+			MidiEvent& ea = a[i][j];
+			MidiEvent& eb = b[i][j];
+			if ((ea.tick != eb.tick) || (ea.track != eb.track) ||
+					(ea.seq != eb.seq) || (ea.size() != eb.size())) {
+				return false;
+			}
+			if (!equal(ea.begin(), ea.end(), eb.begin())) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// elapsed -- Return the number of seconds since the given time.
+//
+
+double elapsed(chrono::steady_clock::time_point start) {
+	chrono::duration<double> span = chrono::steady_clock::now() - start;
+	return span.count();
+}
+
+
+
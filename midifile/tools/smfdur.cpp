@@ -1,7 +1,7 @@
 //
 // Programmer:    Craig Stuart Sapp <craig@ccrma.stanford.edu>
 // Creation Date: Tue Feb 23 05:34:17 PST 2016
-// Last Modified: Tue Feb 23 05:34:20 PST 2016
+// Last Modified: Fri Oct 16 16:05:31 JST 2026 Read events with MidiEventCursor.
 // Filename:      midifile/tools/smfdur.cpp
 // Web Address:   https://github.com/craigsapp/midifile/blob/master/tools/smfdur.cpp
 // Syntax:        C++11
@@ -9,8 +9,10 @@
 // Description:   Calcualte the total duration of a MIDI file.
 //
 
-#include "MidiFile.h"
+#include "MidiEventCursor.h"
 #include "Options.h"
+
+#include <algorithm>
 #include <iostream>
 
 using namespace std;
@@ -23,7 +25,7 @@ Options options;
 void      checkOptions          (Options& opts, int argc, char* argv[]);
 void      usage                 (const char* command);
 void      example               (void);
-double    getTotalDuration      (MidiFile& midifile);
+bool      getTotalDuration      (MidiEventCursor& cursor, double& duration);
 string    minutes               (double seconds);
 
 
@@ -34,22 +36,31 @@ int main(int argc, char* argv[]) {
 	int fileQ  = options.getBoolean("filename");
 	int minuteQ = options.getBoolean("minute");
 
-   MidiFile midifile;
+   MidiEventCursor cursor;
 
 	int counter = 0;
 	double sum = 0.0;
+	bool errorQ = false;
    int numinputs = options.getArgCount();
    for (int i=0; i < numinputs || i==0; i++) {
-      midifile.clear();
+      string filename;
       if (options.getArgCount() < 1) {
-         midifile.read(cin);
+         cursor.open(cin);
       } else {
-         midifile.read(options.getArg(i+1));
+         filename = options.getArg(i+1);
+         cursor.open(filename);
       }
+		double duration;
+		if (!getTotalDuration(cursor, duration)) {
+			// no duration line for a file which could not be read
+			cerr << "Error: cannot read " << (filename.empty() ? "input" : filename)
+			     << endl;
+			errorQ = true;
+			continue;
+		}
       if (options.getArgCount() > 1) {
          cout << options.getArg(i+1) << "\t";
       }
-		double duration = getTotalDuration(midifile);
 		sum += duration;
 		counter++;
       cout << duration;
@@ -58,7 +69,7 @@ int main(int argc, char* argv[]) {
 		}
 		if (fileQ) {
 			cout << "\t";
-			cout << midifile.getFilename();
+			cout << filename;
 		}
       cout << endl;
    }
@@ -74,6 +85,7 @@ int main(int argc, char* argv[]) {
 		}
 		cout << endl;
 	}
+	return errorQ ? 1 : 0;
 }
 
 
@@ -127,13 +139,22 @@ string minutes(double seconds) {
 
 //////////////////////////////
 //
-// getTotalDuration --
+// getTotalDuration -- Find the time in seconds of the last event in
+//    the file.  The events are read one at a time, and only the tempo
+//    changes are stored (by the cursor).  Returns false if the file
+//    could not be read to the end.
 //
 
-double getTotalDuration(MidiFile& midifile) {
-   midifile.doTimeAnalysis();
-   midifile.joinTracks();
-   return midifile[0].last().seconds;
+bool getTotalDuration(MidiEventCursor& cursor, double& duration) {
+	int maxtick = 0;
+	while (cursor.next()) {
+		maxtick = max(maxtick, cursor.getTick());
+	}
+	if (!cursor.status()) {
+		return false;
+	}
+	duration = cursor.getTimeInSeconds(maxtick);
+	return true;
 }
 
 
@@ -0,0 +1,185 @@
+//
+// Creation Date: Sat Oct 17 16:27:52 JST 2026
+// Last Modified: Sat Oct 17 16:27:52 JST 2026
+// Filename:      midifile/tools/sortbench.cpp
+// Syntax:        C++11
+// vim:           ts=3
+//
+// Description:   Time the sorting of tracks on a generated file with many
+//                events at the same ticks: joining sequenced tracks, and
+//                sorting a shuffled track without sequence numbers.  Each
+//                sort is compared with qsort() and eventcompare(), and the
+//                results are checked against the eventcompare() rules.
+//                Exits with an error if an event is sorted before an event
+//                which eventcompare() places ahead of it.
+//
+
+#include "MidiFile.h"
+#include "Options.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using namespace std;
+using namespace smf;
+
+void   buildFile       (MidiFile& midifile, int events, int tracks,
+                        mt19937& random);
+double timeQsort       (const vector<MidiEvent*>& events);
+bool   checkOrder      (MidiEventList& events);
+double elapsed         (chrono::steady_clock::time_point start);
+
+
+///////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char** argv) {
+	Options options;
+	options.define("n|events=i:10000000", "number of events");
+	options.define("t|tracks=i:16", "number of tracks to join");
+	options.define("s|seed=i:1", "seed for the generated events");
+	options.process(argc, argv);
+	int events = options.getInteger("events");
+	int tracks = options.getInteger("tracks");
+	if (tracks < 1) {
+		tracks = 1;
+	}
+	mt19937 random(options.getInteger("seed"));
+
+	MidiFile midifile;
+	buildFile(midifile, events, tracks, random);
+	midifile.markSequence();
+	cout << "events: " << events << " in " << tracks << " tracks" << endl;
+	bool ok = true;
+
+	// Tracks which are already in order:
+	auto start = chrono::steady_clock::now();
+	midifile.sortTracks();
+	cout << "sorted tracks:    sortTracks " << elapsed(start) << " sec" << endl;
+
+	// Joining sequenced tracks (as after reading a file):
+	vector<MidiEvent*> joined;
+	for (int i=0; i<midifile.getTrackCount(); i++) {
+		for (int j=0; j<midifile.getEventCount(i); j++) {
+			joined.push_back(&midifile[i][j]);
+		}
+	}
+	double reference = timeQsort(joined);
+	start = chrono::steady_clock::now();
+	midifile.joinTracks();
+	cout << "joined tracks:    joinTracks " << elapsed(start)
+	     << " sec\tqsort " << reference << " sec" << endl;
+	ok &= checkOrder(midifile[0]);
+
+	// A shuffled track without sequence numbers:
+	midifile.clearSequence();
+	MidiEventList& track = midifile[0];
+	shuffle(track.data(), track.data() + track.getEventCount(), random);
+	vector<MidiEvent*> shuffled(track.data(), track.data() + track.getEventCount());
+	reference = timeQsort(shuffled);
+	start = chrono::steady_clock::now();
+	midifile.sortTracks();
+	cout << "shuffled track:   sortTracks " << elapsed(start)
+	     << " sec\tqsort " << reference << " sec" << endl;
+	ok &= checkOrder(midifile[0]);
+
+	if (!ok) {
+		cerr << "FAILED: events are not in eventcompare() order" << endl;
+		return 1;
+	}
+	return 0;
+}
+
+
+///////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////
+//
+// buildFile -- Fill the tracks with events in tick order.  Ticks advance
+//     slowly so that many events share a tick: notes, controllers,
+//     program changes and tempo meta messages.
+//
+
+void buildFile(MidiFile& midifile, int events, int tracks,
+		mt19937& random) {
+	midifile.addTracks(tracks - 1);
+	for (int i=0; i<tracks; i++) {
+		int count = events / tracks + (i < events % tracks ? 1 : 0);
+		int tick = 0;
+		MidiEventList& list = midifile[i];
+		list.reserve(count);
+		for (int j=0; j<count; j++) {
+			tick += random() % 3;
+			int type = random() % 100;
+			int channel = i % 16;
+			if (type < 40) {
+				list.emplace_back(0x90 | channel, 36 + random() % 48, 1 + random() % 127);
+			} else if (type < 80) {
+				list.emplace_back(0x80 | channel, 36 + random() % 48, 0);
+			} else if (type < 95) {
+				list.emplace_back(0xb0 | channel, random() % 128, random() % 128);
+			} else if (type < 98) {
+				list.emplace_back(0xc0 | channel, random() % 128);
+			} else {
+				MidiEvent event;
+				event.makeTempo(60 + random() % 120);
+				list.push_back(std::move(event));
+			}
+			list.back().tick = tick;
+			list.back().track = i;
+		}
+	}
+}
+
+
+
+//////////////////////////////
+//
+// timeQsort -- Return the time taken to sort a copy of the events with
+//     qsort() and eventcompare(), as MidiEventList::sort() used to.
+//
+
+double timeQsort(const vector<MidiEvent*>& events) {
+	vector<MidiEvent*> copy(events);
+	auto start = chrono::steady_clock::now();
+	qsort(copy.data(), copy.size(), sizeof(MidiEvent*), eventcompare);
+	return elapsed(start);
+}
+
+
+
+//////////////////////////////
+//
+// checkOrder -- Returns true if no event comes after an event which
+//     eventcompare() places after it.
+//
+
+bool checkOrder(MidiEventList& events) {
+	MidiEvent** data = events.data();
+	for (int i=1; i<events.getEventCount(); i++) {
+		if (eventcompare(&data[i], &data[i-1]) < 0) {
+			cerr << "Event " << i << " at tick " << data[i]->tick
+			     << " is out of order" << endl;
+			return false;
+		}
+	}
+	return true;
+}
+
+
+
+//////////////////////////////
+//
+// elapsed -- Return the number of seconds since start.
+//
+
+double elapsed(chrono::steady_clock::time_point start) {
+	chrono::duration<double> duration = chrono::steady_clock::now() - start;
+	return duration.count();
+}
+
+
+
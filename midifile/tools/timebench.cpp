@@ -0,0 +1,143 @@
+//
+// Creation Date: Sat Oct 17 18:46:37 JST 2026
+// Last Modified: Sat Oct 17 18:46:37 JST 2026
+// Filename:      midifile/tools/timebench.cpp
+// Syntax:        C++11
+// vim:           ts=3
+//
+// Description:   Time the conversion between ticks and seconds on a
+//                generated file with many tempo changes: getTimeInSeconds()
+//                for each tick in random order, getTimesInSeconds() for
+//                all of the ticks in order, and getAbsoluteTickTime().
+//                Exits with an error if the conversions do not give the
+//                seconds of the events, or do not convert back to ticks.
+//
+
+#include "MidiFile.h"
+#include "Options.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using namespace std;
+using namespace smf;
+
+void   buildFile       (MidiFile& midifile, int events, int tempos,
+                        mt19937& random);
+double elapsed         (chrono::steady_clock::time_point start);
+
+
+///////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char** argv) {
+	Options options;
+	options.define("n|events=i:2000000", "number of events");
+	options.define("t|tempos=i:10000", "number of tempo changes");
+	options.define("s|seed=i:1", "seed for the generated events");
+	options.process(argc, argv);
+	int events = options.getInteger("events");
+	mt19937 random(options.getInteger("seed"));
+
+	MidiFile midifile;
+	buildFile(midifile, events, options.getInteger("tempos"), random);
+	auto start = chrono::steady_clock::now();
+	midifile.doTimeAnalysis();
+	cout << "doTimeAnalysis:      " << elapsed(start) << " sec" << endl;
+
+	MidiEventList& track = midifile[0];
+	vector<int> ticks(track.getEventCount());
+	for (int i=0; i<track.getEventCount(); i++) {
+		ticks[i] = track[i].tick;
+	}
+	bool ok = true;
+
+	vector<int> shuffled(ticks);
+	shuffle(shuffled.begin(), shuffled.end(), random);
+	vector<double> seconds(shuffled.size());
+	start = chrono::steady_clock::now();
+	for (int i=0; i<(int)shuffled.size(); i++) {
+		seconds[i] = midifile.getTimeInSeconds(shuffled[i]);
+	}
+	cout << "getTimeInSeconds:    " << elapsed(start) << " sec" << endl;
+
+	start = chrono::steady_clock::now();
+	midifile.getTimesInSeconds(ticks, seconds);
+	cout << "getTimesInSeconds:   " << elapsed(start) << " sec" << endl;
+	for (int i=0; i<track.getEventCount(); i++) {
+		if (seconds[i] != track[i].seconds) {
+			cerr << "Event " << i << " at tick " << ticks[i]
+			     << " is converted to " << seconds[i] << " instead of "
+			     << track[i].seconds << " seconds" << endl;
+			ok = false;
+			break;
+		}
+	}
+
+	vector<double> found(seconds.size());
+	start = chrono::steady_clock::now();
+	for (int i=0; i<(int)seconds.size(); i++) {
+		found[i] = midifile.getAbsoluteTickTime(seconds[i]);
+	}
+	cout << "getAbsoluteTickTime: " << elapsed(start) << " sec" << endl;
+	for (int i=0; i<(int)found.size(); i++) {
+		if (fabs(found[i] - ticks[i]) > 0.01) {
+			cerr << "Event " << i << " at " << seconds[i]
+			     << " seconds is converted to tick " << found[i]
+			     << " instead of " << ticks[i] << endl;
+			ok = false;
+			break;
+		}
+	}
+
+	if (!ok) {
+		cerr << "FAILED: ticks and seconds do not match" << endl;
+		return 1;
+	}
+	return 0;
+}
+
+
+///////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////
+//
+// buildFile -- Fill one track with notes in tick order, and spread the
+//     tempo messages over it.
+//
+
+void buildFile(MidiFile& midifile, int events, int tempos,
+		mt19937& random) {
+	MidiEventList& list = midifile[0];
+	list.reserve(events);
+	int tick = 0;
+	for (int i=0; i<events; i++) {
+		tick += random() % 10;
+		if ((tempos > 0) && (random() % events < (unsigned)tempos)) {
+			MidiEvent event;
+			event.makeTempo(40 + random() % 160);
+			list.push_back(std::move(event));
+		} else {
+			list.emplace_back(0x90, 36 + random() % 48, random() % 128);
+		}
+		list.back().tick = tick;
+	}
+}
+
+
+
+//////////////////////////////
+//
+// elapsed -- Return the number of seconds since start.
+//
+
+double elapsed(chrono::steady_clock::time_point start) {
+	chrono::duration<double> duration = chrono::steady_clock::now() - start;
+	return duration.count();
+}
+
+
+
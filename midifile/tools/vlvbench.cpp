@@ -0,0 +1,230 @@
+//
+// Creation Date: Fri Oct 16 17:12:48 JST 2026
+// Last Modified: Fri Oct 16 17:12:48 JST 2026
+// Filename:      midifile/tools/vlvbench.cpp
+// Syntax:        C++11
+// vim:           ts=3
+//
+// Description:   Compare the speed of the MidiVlv conversion functions
+//                with a byte-by-byte conversion of VLVs, for delta times
+//                of different sizes.  The results of both methods are
+//                also compared.
+//
+
+#include "MidiVlv.h"
+#include "Options.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace smf;
+
+void   benchmark         (const string& name, const vector<ulong>& values,
+                          int repeat);
+int    decodeReference   (const uchar* data, size_t size, ulong& value);
+int    encodeReference   (ulong value, uchar* buffer);
+double elapsed           (chrono::steady_clock::time_point start);
+
+// Prevents the compiler from removing the timed loops.
+volatile ulong Checksum = 0;
+
+
+///////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char** argv) {
+	Options options;
+	options.define("n|count=i:1000000", "number of values in each test");
+	options.define("r|repeat=i:20", "number of times to run each test");
+	options.process(argc, argv);
+	int count = options.getInteger("count");
+	int repeat = options.getInteger("repeat");
+	if (count < 1) {
+		count = 1;
+	}
+	if (repeat < 1) {
+		repeat = 1;
+	}
+
+	mt19937 generator(1);
+	vector<ulong> values(count);
+
+	// Most delta times in MIDI files are 0 or fit into one byte.
+	for (int i=0; i<count; i++) {
+		values[i] = (generator() % 4 == 0) ? generator() % 0x80 : 0;
+	}
+	benchmark("1-byte", values, repeat);
+
+	uniform_int_distribution<int> size(1, 4);
+	for (int i=0; i<count; i++) {
+		values[i] = generator() & ((1UL << (7 * size(generator))) - 1);
+	}
+	benchmark("mixed", values, repeat);
+
+	for (int i=0; i<count; i++) {
+		values[i] = 0x200000 + generator() % 0x0fe00000;
+	}
+	benchmark("4-byte", values, repeat);
+
+	return 0;
+}
+
+
+///////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////
+//
+// benchmark -- Encode and decode the values with each method, and print
+//    the best time of each in nanoseconds per value.
+//
+
+void benchmark(const string& name, const vector<ulong>& values, int repeat) {
+	int count = (int)values.size();
+	vector<uchar> reference(count * 5);
+	vector<uchar> encoded(count * 5);
+	vector<ulong> decoded(count);
+	size_t refsize = 0;
+	size_t encsize = 0;
+	double times[5] = {-1.0, -1.0, -1.0, -1.0, -1.0};
+
+	for (int r=0; r<repeat; r++) {
+		double seconds[5];
+
+		auto start = chrono::steady_clock::now();
+		refsize = 0;
+		for (int i=0; i<count; i++) {
+			refsize += encodeReference(values[i], reference.data() + refsize);
+		}
+		seconds[0] = elapsed(start);
+
+		start = chrono::steady_clock::now();
+		encsize = 0;
+		for (int i=0; i<count; i++) {
+			encsize += MidiVlv::encode(values[i], encoded.data() + encsize);
+		}
+		seconds[1] = elapsed(start);
+
+		start = chrono::steady_clock::now();
+		ulong sum = 0;
+		size_t offset = 0;
+		for (int i=0; i<count; i++) {
+			ulong value = 0;
+			offset += decodeReference(reference.data() + offset,
+					refsize - offset, value);
+			sum += value;
+		}
+		seconds[2] = elapsed(start);
+		Checksum = Checksum + sum;
+
+		start = chrono::steady_clock::now();
+		sum = 0;
+		offset = 0;
+		for (int i=0; i<count; i++) {
+			ulong value = 0;
+			offset += MidiVlv::decode(encoded.data() + offset, encsize - offset,
+					value);
+			sum += value;
+		}
+		seconds[3] = elapsed(start);
+		Checksum = Checksum + sum;
+
+		start = chrono::steady_clock::now();
+		size_t used = 0;
+		MidiVlv::decodeMany(encoded.data(), encsize, decoded.data(), count,
+				used);
+		seconds[4] = elapsed(start);
+
+		for (int i=0; i<5; i++) {
+			if ((times[i] < 0.0) || (seconds[i] < times[i])) {
+				times[i] = seconds[i];
+			}
+		}
+	}
+
+	bool same = (refsize == encsize) && equal(reference.begin(),
+			reference.begin() + refsize, encoded.begin()) &&
+			(decoded == values);
+
+	double scale = 1.0e9 / count;
+	cout << name << " (" << (double)encsize / count << " bytes/value):" << endl;
+	cout << "\tencode: bytewise " << times[0] * scale << " ns, MidiVlv "
+	     << times[1] * scale << " ns" << endl;
+	cout << "\tdecode: bytewise " << times[2] * scale << " ns, MidiVlv "
+	     << times[3] * scale << " ns, decodeMany " << times[4] * scale
+	     << " ns" << endl;
+	if (!same) {
+		cout << "\tERROR: the results are different" << endl;
+	}
+}
+
+
+
+//////////////////////////////
+//
+// decodeReference -- Decode a VLV one byte at a time as in the original
+//     MidiFile::readVLValue() and MidiFile::unpackVLV() functions.
+//
+
+int decodeReference(const uchar* data, size_t size, ulong& value) {
+	uchar bytes[5] = {0};
+	int count = 0;
+	while ((count < 5) && ((size_t)count < size)) {
+		bytes[count] = data[count];
+		if (bytes[count++] < 0x80) {
+			break;
+		}
+	}
+	ulong output = 0;
+	for (int i=0; i<count; i++) {
+		output = output << 7;
+		output = output | (bytes[i] & 0x7f);
+	}
+	value = output;
+	return count;
+}
+
+
+
+//////////////////////////////
+//
+// encodeReference -- Encode a VLV one byte at a time as in the original
+//     MidiFile::writeVLValue() function.
+//
+
+int encodeReference(ulong value, uchar* buffer) {
+	uchar bytes[4];
+	bytes[0] = (uchar)((value >> 21) & 0x7f);
+	bytes[1] = (uchar)((value >> 14) & 0x7f);
+	bytes[2] = (uchar)((value >> 7)  & 0x7f);
+	bytes[3] = (uchar)(value         & 0x7f);
+
+	int start = 0;
+	while ((start < 3) && (bytes[start] == 0)) {
+		start++;
+	}
+	int length = 0;
+	for (int i=start; i<3; i++) {
+		buffer[length++] = bytes[i] | 0x80;
+	}
+	buffer[length++] = bytes[3];
+	return length;
+}
+
+
+
+//////////////////////////////
+//
+// elapsed -- Return the number of seconds since the start time.
+//
+
+double elapsed(chrono::steady_clock::time_point start) {
+	chrono::duration<double> duration = chrono::steady_clock::now() - start;
+	return duration.count();
+}
+
+
+
@@ -1,13 +1,146 @@
 #include "midiworkspace.h"
 
 #include <MidiEvent.h>
+#include <MidiEventArena.h>
+#include <algorithm>
 #include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <functional>
+#include <iterator>
+#include <utility>
 #include <boost/format.hpp>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 
 namespace midie
 {
 
+namespace
+{
+
+// Inserts change after the changes at the same or earlier ticks.
+template <class Change>
+void
+insert_change(std::vector<Change>& changes, Change change)
+{
+    const auto it = std::upper_bound(changes.begin(), changes.end(), change.abs_tick,
+                                     [](uint64_t t, const Change& c){ return t < c.abs_tick; });
+    changes.insert(it, std::move(change));
+}
+
+template <class Change>
+void
+erase_change(std::vector<Change>& changes, const Change& deleted)
+{
+    auto it = std::lower_bound(changes.begin(), changes.end(), deleted.abs_tick,
+                               [](const Change& c, uint64_t t){ return c.abs_tick < t; });
+    for (; it!=changes.end() && it->abs_tick == deleted.abs_tick; it++) {
+        if (*it == deleted) {
+            changes.erase(it);
+            return;
+        }
+    }
+}
+
+// Returns the last change at or before abs_tick.
+template <class Change>
+const Change*
+change_at(const std::vector<Change>& changes, uint64_t abs_tick)
+{
+    const auto it = std::upper_bound(changes.begin(), changes.end(), abs_tick,
+                                     [](uint64_t t, const Change& c){ return t < c.abs_tick; });
+    return it == changes.begin() ? nullptr : &*(it - 1);
+}
+
+TempoChange
+make_tempo_change(const smf::MidiEvent& event)
+{
+    TempoChange change;
+    change.bpm = static_cast<uint16_t>(event.getTempoBPM());
+    change.abs_tick = static_cast<uint64_t>(event.tick);
+    return change;
+}
+
+TimeSignatureChange
+make_time_signature_change(const smf::MidiEvent& event)
+{
+    TimeSignatureChange change;
+    TimeSignature ts;
+    ts.denominator = static_cast<uint8_t>(event.getP2());
+    ts.numerator = static_cast<uint8_t>(event.getP3());
+    change.time_signature = ts;
+    change.abs_tick = static_cast<uint64_t>(event.tick);
+    return change;
+}
+
+KeySignatureChange
+make_key_signature_change(const smf::MidiEvent& event)
+{
+    KeySignatureChange change;
+    change.abs_tick = static_cast<uint64_t>(event.tick);
+    change.accidentals = static_cast<int8_t>(event.getP3());
+    change.minor = event[4] != 0;
+    return change;
+}
+
+Marker
+make_marker(const smf::MidiEvent& event)
+{
+    return Marker{static_cast<uint64_t>(event.tick), event.getMetaContent()};
+}
+
+// The on/off controllers which smf::MidiEventList::linkNotePairs pairs, such
+// as the sustain, sostenuto and soft pedals (0-63 is off, 64-127 is on).
+constexpr int switch_controllers[] = {
+    64, 65, 66, 67, 68, 69, 80, 81, 82, 83, 84, 85, 86, 87, 88, 89, 90, 122
+};
+
+// Slots from this number up are for the switch controllers.
+constexpr int first_controller_slot = 16 * 128;
+constexpr int slot_count = first_controller_slot + 16 * 32;
+static_assert(std::size(switch_controllers) <= 32, "too many switch controllers");
+
+// Returns the channel and key of a note-on or note-off as one number, the
+// channel and controller of a switch controller as a number from
+// first_controller_slot up, or -1 for other events.
+int
+note_slot(const smf::MidiEvent& event)
+{
+    const auto kind = event.getKind();
+    if (kind == smf::MidiMessage::KIND_NOTE_ON || kind == smf::MidiMessage::KIND_NOTE_OFF) {
+        return event.getChannel() * 128 + event.getKeyNumber();
+    }
+    if (kind != smf::MidiMessage::KIND_CONTROLLER) {
+        return -1;
+    }
+    const auto controller = event.getP1();
+    const auto begin = std::begin(switch_controllers);
+    const auto it = std::find(begin, std::end(switch_controllers), controller);
+    if (it == std::end(switch_controllers)) {
+        return -1;
+    }
+    return first_controller_slot + event.getChannel() * 32 + static_cast<int>(it - begin);
+}
+
+// Flushes a file written earlier, or a directory opened with O_DIRECTORY,
+// to the disk.
+bool
+sync_file(const std::string& path, int flags)
+{
+    const int fd = ::open(path.c_str(), flags);
+    if (fd < 0) {
+        return false;
+    }
+    const bool synced = ::fsync(fd) == 0;
+    return ::close(fd) == 0 && synced;
+}
+
+}
+
 bool
 operator==(const TimeSignature& ts1, const TimeSignature& ts2)
 {
@@ -33,37 +166,23 @@ TimeSignatureInfo::TimeSignatureInfo(std::vector<TimeSignatureChange> changes, b
 void
 TimeSignatureInfo::append(TimeSignatureChange change)
 {
-   m_changes.push_back(change);
-   std::stable_sort(m_changes.begin(), m_changes.end(), [](auto c1, auto c2){return c1.abs_tick < c2.abs_tick;});
+    insert_change(m_changes, change);
 }
 
 void
 TimeSignatureInfo::deleteChange(TimeSignatureChange deleted)
 {
-    size_t i = 0;
-    while (i != m_changes.size()) {
-        if (m_changes.at(i) == deleted) {
-            m_changes.erase(m_changes.begin() + static_cast<long>(i));
-        } else {
-            i++;
-        }
-    }
+    erase_change(m_changes, deleted);
 }
 
 std::optional<TimeSignature>
 TimeSignatureInfo::time_signature(uint64_t abs_tick) const
 {
     // m_changes is always sorted.
-    std::optional<TimeSignature> last_change;
-    for (auto it=m_changes.cbegin(); it!=m_changes.cend(); it++)
-    {
-        if (it->abs_tick <= abs_tick) {
-            last_change = std::make_optional(it->time_signature);
-        } else {
-            break;
-        }
-    }
-    return last_change;
+    const auto change = change_at(m_changes, abs_tick);
+    if (!change)
+        return std::nullopt;
+    return change->time_signature;
 }
 
 
@@ -85,37 +204,214 @@ TempoInfo::TempoInfo(std::vector<TempoChange> changes, bool need_sort)
 void
 TempoInfo::append(TempoChange change)
 {
-    m_changes.push_back(change);
-    std::stable_sort(m_changes.begin(), m_changes.end(), [](auto c1, auto c2){return c1.abs_tick < c2.abs_tick;});
+    insert_change(m_changes, change);
 }
 
 void
 TempoInfo::deleteChange(TempoChange deleted)
 {
-    size_t i = 0;
-    while (i != m_changes.size()) {
-        if (m_changes.at(i) == deleted) {
-            m_changes.erase(m_changes.begin() + static_cast<long>(i));
-        } else {
-            i++;
-        }
-    }
+    erase_change(m_changes, deleted);
 }
 
 std::optional<uint16_t>
 TempoInfo::tempo(uint64_t abs_tick) const
 {
     // m_changes is always sorted.
-    std::optional<uint16_t> last_tempo;
-    for (auto it=m_changes.cbegin(); it!=m_changes.cend(); it++)
-    {
-        if (it->abs_tick <= abs_tick) {
-            last_tempo = std::make_optional(it->bpm);
-        } else {
+    const auto change = change_at(m_changes, abs_tick);
+    if (!change)
+        return std::nullopt;
+    return change->bpm;
+}
+
+
+bool
+operator==(const KeySignatureChange& c1, const KeySignatureChange& c2)
+{
+    return c1.abs_tick == c2.abs_tick && c1.accidentals == c2.accidentals && c1.minor == c2.minor;
+}
+
+
+bool
+operator==(const Marker& m1, const Marker& m2)
+{
+    return m1.abs_tick == m2.abs_tick && m1.text == m2.text;
+}
+
+
+void
+ConductorIndex::assign(const smf::MidiEventList& events)
+{
+    using smf::MidiMessage;
+    *this = ConductorIndex();
+    const auto kinds = MidiMessage::kindMask(MidiMessage::KIND_TEMPO)
+            | MidiMessage::kindMask(MidiMessage::KIND_TIME_SIGNATURE)
+            | MidiMessage::kindMask(MidiMessage::KIND_KEY_SIGNATURE)
+            | MidiMessage::kindMask(MidiMessage::KIND_MARKER);
+    for (auto i=events.findNextKind(0, kinds); i<events.getEventCount(); i=events.findNextKind(i + 1, kinds)) {
+        insert(events[i]);
+    }
+}
+
+void
+ConductorIndex::insert(const smf::MidiEvent& event)
+{
+    switch (event.getKind()) {
+    case smf::MidiMessage::KIND_TEMPO:
+        m_tempos.append(make_tempo_change(event));
+        break;
+    case smf::MidiMessage::KIND_TIME_SIGNATURE:
+        m_time_signatures.append(make_time_signature_change(event));
+        break;
+    case smf::MidiMessage::KIND_KEY_SIGNATURE:
+        insert_change(m_key_signatures, make_key_signature_change(event));
+        break;
+    case smf::MidiMessage::KIND_MARKER:
+        insert_change(m_markers, make_marker(event));
+        break;
+    }
+}
+
+void
+ConductorIndex::erase(const smf::MidiEvent& event)
+{
+    switch (event.getKind()) {
+    case smf::MidiMessage::KIND_TEMPO:
+        m_tempos.deleteChange(make_tempo_change(event));
+        break;
+    case smf::MidiMessage::KIND_TIME_SIGNATURE:
+        m_time_signatures.deleteChange(make_time_signature_change(event));
+        break;
+    case smf::MidiMessage::KIND_KEY_SIGNATURE:
+        erase_change(m_key_signatures, make_key_signature_change(event));
+        break;
+    case smf::MidiMessage::KIND_MARKER:
+        erase_change(m_markers, make_marker(event));
+        break;
+    }
+}
+
+std::optional<KeySignatureChange>
+ConductorIndex::key_signature(uint64_t abs_tick) const
+{
+    const auto change = change_at(m_key_signatures, abs_tick);
+    if (!change)
+        return std::nullopt;
+    return *change;
+}
+
+std::vector<Marker>
+ConductorIndex::markers(uint64_t start_tick, uint64_t end_tick) const
+{
+    const auto first = std::lower_bound(m_markers.begin(), m_markers.end(), start_tick,
+                                        [](const Marker& m, uint64_t t){ return m.abs_tick < t; });
+    const auto last = std::lower_bound(first, m_markers.end(), end_tick,
+                                       [](const Marker& m, uint64_t t){ return m.abs_tick < t; });
+    return std::vector<Marker>(first, last);
+}
+
+
+void
+NoteLinkIndex::assign(const EventTrack& events)
+{
+    // The entries are gathered by slot number first, rather than looking up
+    // the slot of every event in the map.
+    std::vector<std::vector<Entry>> slots(slot_count);
+    for (auto& event : events) {
+        const auto slot = note_slot(event);
+        if (slot >= 0) {
+            slots[static_cast<size_t>(slot)].push_back(Entry{&event, false});
+        }
+    }
+    m_slots.clear();
+    for (size_t i=0; i<slots.size(); i++) {
+        if (!slots[i].empty()) {
+            auto& entries = m_slots[static_cast<int>(i)];
+            entries = std::move(slots[i]);
+            relink(entries, 0);
+        }
+    }
+}
+
+void
+NoteLinkIndex::insert(smf::MidiEvent& event)
+{
+    const auto slot = note_slot(event);
+    if (slot < 0) return;
+    auto& entries = m_slots[slot];
+    // after the entries at the same tick, as in EventTrack::insert
+    const auto it = std::upper_bound(entries.begin(), entries.end(), event.tick,
+                                     [](int t, const Entry& e){ return t < e.event->tick; });
+    const auto edit = static_cast<size_t>(it - entries.begin());
+    entries.insert(it, Entry{&event, false});
+    relink(entries, edit);
+}
+
+void
+NoteLinkIndex::erase(smf::MidiEvent& event)
+{
+    const auto slot = note_slot(event);
+    if (slot < 0) return;
+    auto& entries = m_slots[slot];
+    auto it = std::lower_bound(entries.begin(), entries.end(), event.tick,
+                               [](const Entry& e, int t){ return e.event->tick < t; });
+    while (it != entries.end() && it->event != &event) {
+        it++;
+    }
+    if (it == entries.end()) return;
+    const auto edit = static_cast<size_t>(it - entries.begin());
+    entries.erase(it);
+    relink(entries, edit);
+}
+
+// Pairs the events of one slot again after an edit at index edit. Before the
+// last entry (before edit) with no unpaired note-on, the pairs are unchanged.
+// The pairing is also unchanged from the first entry after the edit which had
+// no unpaired note-on before it, and still has none. A switch controller is
+// paired like a note, except that an "on" while one is unpaired is ignored
+// (so at most one is unpaired), as is an "off" while none is. Events which
+// are already linked to the right event (such as events loaded from a cache)
+// are left alone.
+void
+NoteLinkIndex::relink(std::vector<Entry>& slot, size_t edit)
+{
+    size_t start = edit == 0 ? 0 : edit - 1;
+    while (start > 0 && !slot[start].top) {
+        start--;
+    }
+    m_noteons.clear();
+    for (size_t i=start; i<slot.size(); i++) {
+        auto& entry = slot[i];
+        const bool top = m_noteons.empty();
+        if (i >= edit && top && entry.top) {
             break;
         }
+        entry.top = top;
+        auto* event = entry.event;
+        bool on;
+        if (event->getKind() == smf::MidiMessage::KIND_CONTROLLER) {
+            on = event->getP2() >= 64;
+            if (on && !top) {
+                event->unlinkEvent();
+                continue;
+            }
+        } else {
+            on = event->getKind() == smf::MidiMessage::KIND_NOTE_ON;
+        }
+        if (on) {
+            m_noteons.push_back(event);
+        } else if (m_noteons.empty()) {
+            event->unlinkEvent();
+        } else {
+            if (m_noteons.back()->getLinkedEvent() != event) {
+                m_noteons.back()->linkEvent(event);
+            }
+            m_noteons.pop_back();
+        }
+    }
+    // note-ons left at the end of the slot
+    for (auto* event : m_noteons) {
+        event->unlinkEvent();
     }
-    return last_tempo;
 }
 
 
@@ -145,23 +441,45 @@ MidiWorkspace::MidiWorkspace()
     mf->setTicksPerQuarterNote(480);
 
     m_midi.reset(mf);
-
-    m_cache = std::vector<int>(2, 0);
+    init_tracks();
 }
 
 MidiWorkspace::MidiWorkspace(const std::string& path)
 {
     auto mf = new smf::MidiFile;
-    mf->read(path);
+    mf->setThreadCount(0); // decode tracks on all cores
+    mf->setArenaStorage(true); // allocate loaded events in blocks
+    const bool cached = mf->readCache(cache_path(path), path);
+    if (!cached) {
+        mf->read(path);
+    }
     m_midi.reset(mf);
-
-    m_cache = std::vector<int>(static_cast<size_t>(m_midi->getTrackCount()), 0);
+    init_tracks();
+    if (!cached && m_midi->status()) {
+        // with the links of init_tracks(), from a snapshot, so that the
+        // workspace can be edited meanwhile
+        m_cache_writer = std::thread([snapshot = snapshot(), path]() {
+            write_smf_cache(*snapshot, path);
+        });
+    }
 }
 
 MidiWorkspace::MidiWorkspace(const QString& path)
     : MidiWorkspace(path.toStdString())
 {}
 
+MidiWorkspace::~MidiWorkspace()
+{
+    if (m_cache_writer.joinable()) {
+        m_cache_writer.join();
+    }
+    // The event lists own the events, so they must hold exactly the events
+    // of m_tracks when they are deleted.
+    for (unsigned int i=0; i<track_count(); i++) {
+        sync_track(i);
+    }
+}
+
 unsigned int
 MidiWorkspace::track_count() const
 {
@@ -171,9 +489,11 @@ MidiWorkspace::track_count() const
 const smf::MidiEventList&
 MidiWorkspace::events_abs_tick(unsigned int track) const
 {
-    if (track >= static_cast<unsigned int>(m_midi->getTrackCount()))
+    if (track >= track_count())
         throw std::out_of_range("track index out of range");
-    return (*m_midi)[static_cast<int>(track)];
+    sync_track(track);
+    // const access, so that a list shared with a snapshot is not copied.
+    return std::as_const(*m_midi)[static_cast<int>(track)];
 }
 
 smf::MidiEventList&
@@ -181,42 +501,23 @@ MidiWorkspace::events_abs_tick_mut(unsigned int track) const
 {
     if (track >= static_cast<unsigned int>(m_midi->getTrackCount()))
         throw std::out_of_range("track index out of range");
+    sync_track(track);
+    unshare_track(track);
     return (*m_midi)[static_cast<int>(track)];
 }
 
 void
 MidiWorkspace::append_event(unsigned int track, uint64_t abs_tick, smf::MidiMessage msg)
 {
-    auto& events = events_abs_tick_mut(track);
-    const auto events_len = events.getEventCount();
-    smf::MidiEvent ev;
-    ev = msg;
-    ev.tick = static_cast<int>(abs_tick);
-    if (events_len == 0) {
-        events.append(ev);
-    } else if (ev.tick < events.getEvent(m_cache.at(track)).tick)
-    {
-        auto i = m_cache.at(track)-1;
-        for (; i>0; i--) {
-            // if two events have the same timestamp,
-            // note_off must come before note_on.
-            if (static_cast<uint64_t>(events.getEvent(i-1).tick) <= abs_tick)
-                break;
-        }
-        events.insert(i, ev);
-        m_cache.at(track)++;
-    }
-    else
-    {
-        auto i = m_cache.at(track);
-        for (; i<events_len; i++) {
-            // if two events have the same timestamp,
-            // note_off must come before note_on.
-            if (static_cast<uint64_t>(events.getEvent(i).tick) > abs_tick)
-                break;
-        }
-        events.insert(i, ev);
-    }
+    auto& events = editable_track(track);
+    auto ev = new smf::MidiEvent(std::move(msg));
+    ev->tick = static_cast<int>(abs_tick);
+    ev->track = static_cast<int>(track);
+    // if two events have the same timestamp, the new one comes last.
+    events.insert(ev);
+    m_conductors.at(track).insert(*ev);
+    note_links(track).insert(*ev);
+    m_modified.at(track) = true;
 }
 
 bool
@@ -225,84 +526,25 @@ MidiWorkspace::delete_event(unsigned int track, uint64_t abs_tick, const smf::Mi
     return delete_event_if_once(track, abs_tick, [&msg](auto& m){ return m == msg; });
 }
 
-bool
-MidiWorkspace::delete_event_if_once(unsigned int track, uint64_t abs_tick, std::function<bool(const smf::MidiMessage&)> pred)
-{
-    auto& events = events_abs_tick_mut(track);
-    if (abs_tick <= static_cast<uint64_t>(events.getEvent(m_cache.at(track)).tick))
-    {
-        auto i = m_cache.at(track);
-        for(; i>=0; i--)
-        {
-            const auto& event = events.getEvent(i);
-            if (static_cast<uint64_t>(event.tick) == abs_tick
-                    && pred(event))
-            {
-                m_cache.at(track) = std::max(0, m_cache.at(track));
-                return events.remove(i) != -1;
-            }
-        }
-    }
-    else
-    {
-        auto i = m_cache.at(track);
-        auto events_len = events.getEventCount();
-        for (; i<events_len; i++)
-        {
-            const auto& event = events.getEvent(i);
-            if (static_cast<uint64_t>(event.tick) == abs_tick
-                    && pred(event))
-            {
-                return events.remove(i) != -1;
-            }
-        }
-    }
-    return false;
-}
 
 TempoInfo
 MidiWorkspace::create_tempo_info(unsigned int track) const
 {
-    auto& events = events_abs_tick(track);
-    auto events_len = events.getEventCount();
-    std::vector<TempoChange> changes;
-
-    for (auto i=0; i<events_len; i++)
-    {
-        auto& event = events.getEvent(i);
-        if (event.isMeta() && event.isTempo()) {
-            TempoChange change;
-            change.bpm = static_cast<uint16_t>(event.getTempoBPM());
-            change.abs_tick = static_cast<uint64_t>(event.tick);
-            changes.push_back(std::move(change));
-        }
-    }
-
-    return TempoInfo(changes, false);
+    return conductor(track).tempo_info();
 }
 
 TimeSignatureInfo
 MidiWorkspace::create_time_signature_info(unsigned int track) const
 {
-    auto& events = events_abs_tick(track);
-    auto events_len = events.getEventCount();
-    std::vector<TimeSignatureChange> changes;
-
-    for (auto i=0; i<events_len; i++)
-    {
-        auto& event = events.getEvent(i);
-        if (event.isMeta() && event.isTimeSignature()) {
-            TimeSignatureChange change;
-            TimeSignature ts;
-            ts.denominator = static_cast<uint8_t>(event.getP2());
-            ts.numerator = static_cast<uint8_t>(event.getP3());
-            change.time_signature = ts;
-            change.abs_tick = static_cast<uint64_t>(event.tick);
-            changes.push_back(std::move(change));
-        }
-    }
+    return conductor(track).time_signature_info();
+}
 
-    return TimeSignatureInfo(changes, false);
+const ConductorIndex&
+MidiWorkspace::conductor(unsigned int track) const
+{
+    if (track >= track_count())
+        throw std::out_of_range("track index out of range");
+    return m_conductors[track];
 }
 
 std::vector<std::tuple<uint8_t, std::string>>
@@ -315,13 +557,185 @@ MidiWorkspace::track_info() const
     return tracks;
 }
 
+std::shared_ptr<smf::MidiFile>
+MidiWorkspace::snapshot() const
+{
+    for (unsigned int i=0; i<track_count(); i++) {
+        sync_track(i);
+    }
+    auto copy = std::make_shared<smf::MidiFile>(*m_midi);
+    copy->setThreadCount(0); // encode tracks on all cores
+    return copy;
+}
+
+void
+MidiWorkspace::init_tracks()
+{
+    // NoteLinkIndex pairs events as linkNotePairs() does, and keeps them
+    // linked through edits. The events of a cache are linked already.
+    if (!m_midi->hasLinkedNotePairs()) {
+        m_midi->linkNotePairs();
+    }
+    m_tracks.clear();
+    m_conductors.clear();
+    for (auto i=0; i<m_midi->getTrackCount(); i++) {
+        m_tracks.emplace_back((*m_midi)[i]);
+        m_conductors.emplace_back();
+        m_conductors.back().assign((*m_midi)[i]);
+    }
+    m_note_links.assign(m_tracks.size(), NoteLinkIndex());
+    m_note_links_built.assign(m_tracks.size(), false);
+    m_midi->setLinkedNotePairs(true);
+    m_modified.assign(m_tracks.size(), false);
+}
+
 void
-MidiWorkspace::reset_cache()
+MidiWorkspace::sync_track(unsigned int track) const
 {
-    for (auto& c : m_cache)
-    {
-        c = 0;
+    if (m_modified.at(track)) {
+        m_tracks.at(track).write_to((*m_midi)[static_cast<int>(track)]);
+        m_modified.at(track) = false;
+    }
+}
+
+// Returns the track to make an edit on. The caller sets m_modified if it
+// changes the track.
+EventTrack&
+MidiWorkspace::editable_track(unsigned int track)
+{
+    if (track >= track_count())
+        throw std::out_of_range("track index out of range");
+    unshare_track(track);
+    return m_tracks.at(track);
+}
+
+// Returns the note link index of a track, building it first if needed.
+NoteLinkIndex&
+MidiWorkspace::note_links(unsigned int track)
+{
+    if (!m_note_links_built.at(track)) {
+        m_note_links.at(track).assign(m_tracks.at(track));
+        m_note_links_built.at(track) = true;
+    }
+    return m_note_links.at(track);
+}
+
+void
+MidiWorkspace::erase_event(unsigned int track, EventTrack::Position pos)
+{
+    auto* event = m_tracks.at(track).erase(pos);
+    m_conductors.at(track).erase(*event);
+    // no event may stay linked to the deleted one
+    event->unlinkEvent();
+    note_links(track).erase(*event);
+    smf::MidiEventArena::deleteEvent(event);
+    m_modified.at(track) = true;
+}
+
+void
+MidiWorkspace::unshare_track(unsigned int track) const
+{
+    const auto index = static_cast<int>(track);
+    if (m_midi->isTrackShared(index)) {
+        // The track must be in sync: non-const access copies the list (with
+        // the same links), and m_tracks is pointed at the events of the copy.
+        sync_track(track);
+        m_tracks.at(track).assign((*m_midi)[index]);
+        m_note_links.at(track) = NoteLinkIndex();
+        m_note_links_built.at(track) = false;
+    }
+}
+
+
+bool
+write_smf_atomically(smf::MidiFile& midi, const std::string& path)
+{
+    // A new file of its own next to path, so that no other file is
+    // overwritten and two saves to the same path do not share it.
+    std::string temp_path = path + ".XXXXXX";
+    const int fd = ::mkstemp(temp_path.data());
+    if (fd < 0) {
+        return false;
+    }
+    // The new file keeps the permissions of the file it replaces, or gets
+    // those of a newly created file.
+    mode_t mode;
+    struct stat original;
+    if (::stat(path.c_str(), &original) == 0) {
+        mode = original.st_mode & 07777;
+    } else {
+        const mode_t mask = ::umask(0);
+        ::umask(mask);
+        mode = 0666 & ~mask;
+    }
+    const bool created = ::fchmod(fd, mode) == 0;
+    if (::close(fd) != 0 || !created || !midi.write(temp_path)) {
+        std::remove(temp_path.c_str());
+        return false;
+    }
+
+    // It must be on the disk before the rename, or a crash could leave path
+    // empty.
+    if (!sync_file(temp_path, O_WRONLY)) {
+        std::remove(temp_path.c_str());
+        return false;
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temp_path, path, error);
+    if (error) {
+        std::remove(temp_path.c_str());
+        return false;
+    }
+    // The rename itself is only durable once the directory is flushed. This
+    // is done as well as the file system allows: path has been replaced
+    // either way, so a failure is not reported.
+    auto dir = std::filesystem::path(path).parent_path();
+    if (dir.empty()) {
+        dir = ".";
+    }
+    sync_file(dir.string(), O_RDONLY | O_DIRECTORY);
+    return true;
+}
+
+
+std::string
+cache_path(const std::string& path)
+{
+    std::filesystem::path dir;
+    const char* cache_home = std::getenv("XDG_CACHE_HOME");
+    const char* home = std::getenv("HOME");
+    if (cache_home && *cache_home) {
+        dir = cache_home;
+    } else if (home && *home) {
+        dir = std::filesystem::path(home) / ".cache";
+    } else {
+        return std::string();
+    }
+    // One cache for each absolute path.
+    std::error_code error;
+    const auto absolute = std::filesystem::absolute(path, error);
+    if (error) {
+        return std::string();
+    }
+    const auto name = std::hash<std::string>()(absolute.lexically_normal().string());
+    return (dir / "midie" / (boost::format("%016x.cache") % name).str()).string();
+}
+
+
+bool
+write_smf_cache(const smf::MidiFile& midi, const std::string& path)
+{
+    const auto cache = cache_path(path);
+    if (cache.empty()) {
+        return false;
+    }
+    std::error_code error;
+    std::filesystem::create_directories(std::filesystem::path(cache).parent_path(), error);
+    if (error) {
+        return false;
     }
+    return midi.writeCache(cache, path);
 }
 
 }
@@ -1,10 +1,15 @@
 #ifndef MIDIWORKSPACE_H
 #define MIDIWORKSPACE_H
 
+#include "eventtrack.h"
+
 #include <memory>
 #include <MidiFile.h>
 #include <MidiEventList.h>
 #include <QString>
+#include <string>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 #include <optional>
 
@@ -18,6 +23,10 @@ class TimeSignatureInfo;
 class MidiWorkspace;
 struct TempoChange;
 class TempoInfo;
+struct KeySignatureChange;
+struct Marker;
+class ConductorIndex;
+class NoteLinkIndex;
 
 
 struct TimeSignature
@@ -42,6 +51,7 @@ public:
     TimeSignatureInfo(std::vector<TimeSignatureChange> changes, bool need_sort);
 
     void append(TimeSignatureChange change);
+    // Removes one change equal to deleted.
     void deleteChange(TimeSignatureChange deleted);
     std::optional<TimeSignature> time_signature(uint64_t abs_tick) const;
 
@@ -66,6 +76,7 @@ public:
     TempoInfo(std::vector<TempoChange> changes, bool need_sort);
 
     void append(TempoChange change);
+    // Removes one change equal to deleted.
     void deleteChange(TempoChange deleted);
     std::optional<uint16_t> tempo(uint64_t abs_tick) const;
 
@@ -76,38 +87,183 @@ private:
 };
 
 
+struct KeySignatureChange
+{
+    uint64_t abs_tick;
+    int8_t accidentals; // sharps if positive, flats if negative
+    bool minor;
+};
+bool operator==(const KeySignatureChange& c1, const KeySignatureChange& c2);
+
+
+struct Marker
+{
+    uint64_t abs_tick;
+    std::string text;
+};
+bool operator==(const Marker& m1, const Marker& m2);
+
+
+// The tempo, time signature, key signature and marker events of a track.
+// It is updated as events are added and deleted, so that queries take
+// O(log k) time in the number of these events, whatever the size of the
+// track.
+class ConductorIndex
+{
+public:
+    void assign(const smf::MidiEventList& events);
+    // Both ignore events of other kinds.
+    void insert(const smf::MidiEvent& event);
+    void erase(const smf::MidiEvent& event);
+
+    const TempoInfo& tempo_info() const { return m_tempos; }
+    const TimeSignatureInfo& time_signature_info() const { return m_time_signatures; }
+    std::optional<KeySignatureChange> key_signature(uint64_t abs_tick) const;
+    // Markers from start_tick up to (but not including) end_tick.
+    std::vector<Marker> markers(uint64_t start_tick, uint64_t end_tick) const;
+
+private:
+    TempoInfo m_tempos{{}, false};
+    TimeSignatureInfo m_time_signatures{{}, false};
+    std::vector<KeySignatureChange> m_key_signatures;
+    std::vector<Marker> m_markers;
+};
+
+
+// The note-ons and note-offs of a track for each channel and key, and its
+// on/off controllers (such as the sustain pedal) for each channel and
+// controller, in track order. They are paired in the same way as
+// smf::MidiEventList::linkNotePairs (a note-off ends the last unpaired
+// note-on, and a controller "off" the first "on" after the previous "off"),
+// and an edit only relinks the events of its slot from the last point before
+// it with nothing unpaired, up to the first point after it where the pairing
+// is unchanged.
+class NoteLinkIndex
+{
+public:
+    // Links the note and controller pairs of the track.
+    void assign(const EventTrack& events);
+    // Both ignore events which linkNotePairs does not pair. event must be in
+    // the track when inserted, and unlinked when erased.
+    void insert(smf::MidiEvent& event);
+    void erase(smf::MidiEvent& event);
+
+private:
+    struct Entry
+    {
+        smf::MidiEvent* event;
+        bool top; // no unpaired note-on before the event
+    };
+    std::unordered_map<int, std::vector<Entry>> m_slots; // by channel and key or controller
+    std::vector<smf::MidiEvent*> m_noteons;
+
+    void relink(std::vector<Entry>& slot, size_t edit);
+};
+
+
 class MidiWorkspace
 {
 public:
+    // Opens the file at path from its cache when the cache is up to date.
+    // Otherwise the file is read, and the cache is written on another
+    // thread.
     MidiWorkspace(const std::string& path);
     MidiWorkspace(const QString& path);
     MidiWorkspace();
+    ~MidiWorkspace();
 
     unsigned int track_count() const;
 
+    // The returned lists are brought up to date with the edits made by
+    // append_event and delete_event first, and their note pairs are linked.
+    // Events in the mutable list may be linked, but not added, removed,
+    // reordered or given other messages.
     const smf::MidiEventList& events_abs_tick(unsigned int track) const;
     smf::MidiEventList& events_abs_tick_mut(unsigned int track) const;
 
+    // msg is moved into the new event; pass an rvalue to avoid a copy.
     void append_event(unsigned int track, uint64_t abs_tick, smf::MidiMessage msg);
     bool delete_event(unsigned int track, uint64_t abs_tick, const smf::MidiMessage& msg);
-    bool delete_event_if_once(unsigned int track, uint64_t abs_tick, std::function<bool(const smf::MidiMessage&)> pred);
+    // Deletes the first event at abs_tick for which pred(const smf::MidiMessage&)
+    // returns true.
+    template <class Pred>
+    bool delete_event_if_once(unsigned int track, uint64_t abs_tick, Pred pred);
 
     TempoInfo create_tempo_info(unsigned int track) const;
     TimeSignatureInfo create_time_signature_info(unsigned int track) const;
+    // Tempo, time signature, key signature and marker lookups which do not
+    // scan the track.
+    const ConductorIndex& conductor(unsigned int track) const;
 
     std::vector<std::tuple<uint8_t, std::string>> track_info() const;
 
     int resolution() const { return m_midi->getTicksPerQuarterNote(); }
 
+    // Returns a copy of the MIDI data which can be written on another thread
+    // while this workspace is being edited.
+    std::shared_ptr<smf::MidiFile> snapshot() const;
+
 private:
     std::unique_ptr<smf::MidiFile> m_midi;
 
-    std::vector<int> m_cache;
-    void reset_cache();
+    // Edits are made on m_tracks, and copied to the event lists of m_midi
+    // when they are next read (m_modified). Event lists shared with a
+    // snapshot are copied before the first edit (unshare_track).
+    mutable std::vector<EventTrack> m_tracks;
+    mutable std::vector<bool> m_modified;
+    std::vector<ConductorIndex> m_conductors;
+    mutable std::vector<NoteLinkIndex> m_note_links; // over the events of m_tracks
+    // Whether each index of m_note_links is built. An index is only built
+    // before the first edit of its track, since the events are linked in
+    // the same way when the tracks are loaded.
+    mutable std::vector<bool> m_note_links_built;
+    std::thread m_cache_writer;
+    void init_tracks();
+    void sync_track(unsigned int track) const;
+    void unshare_track(unsigned int track) const;
+    EventTrack& editable_track(unsigned int track);
+    NoteLinkIndex& note_links(unsigned int track);
+    void erase_event(unsigned int track, EventTrack::Position pos);
 
     void finalize();
 };
 
+
+template <class Pred>
+bool
+MidiWorkspace::delete_event_if_once(unsigned int track, uint64_t abs_tick, Pred pred)
+{
+    auto& events = editable_track(track);
+    const auto tick = static_cast<int>(abs_tick);
+    for (auto it=events.lower_bound(tick); it!=events.end() && it->tick == tick; ++it)
+    {
+        if (pred(static_cast<const smf::MidiMessage&>(*it)))
+        {
+            erase_event(track, it.position());
+            return true;
+        }
+    }
+    return false;
+}
+
+
+// Writes the MIDI file to a new temporary file next to path, flushes it to
+// the disk with the permissions of the existing file, then renames it over
+// path, so that an existing file is never left half-written.
+bool write_smf_atomically(smf::MidiFile& midi, const std::string& path);
+
+// Returns the path of the cache file of a MIDI file, in the midie directory
+// of the user's cache directory ($XDG_CACHE_HOME, or ~/.cache), or an empty
+// string if there is none. The cache holds the decoded events and note
+// links, so that MidiWorkspace can open the file again without decoding it.
+// It is ignored once the size or modification time of the file changes.
+std::string cache_path(const std::string& path);
+
+// Stores midi in the cache file of path. midi must hold the contents of the
+// file at path, and its note pairs must be linked (as in a workspace or one
+// of its snapshots), or the cache holds no links.
+bool write_smf_cache(const smf::MidiFile& midi, const std::string& path);
+
 }
 
 #endif // MIDIWORKSPACE_H
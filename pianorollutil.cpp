@@ -1,8 +1,6 @@
 #include "pianorollutil.h"
 
-#include <map>
-#include <tuple>
-#include <stdexcept>
+#include <MidiNoteTable.h>
 
 namespace midie
 {
@@ -19,47 +17,21 @@ IndependentNoteDrawingInfo::IndependentNoteDrawingInfo
 std::vector<IndependentNoteDrawingInfo>
 build_drawing_graph(const smf::MidiEventList& track)
 {
-    std::map<uint8_t, std::tuple<uint64_t, uint8_t>> start_note; // Map<note, (abs_tick, velocity)>
+    const smf::MidiNoteTable notes(track);
     std::vector<IndependentNoteDrawingInfo> note_drawing;
+    note_drawing.reserve(static_cast<size_t>(notes.getNoteCount()));
 
-    const auto track_len = track.getEventCount();
-    for (auto i=0; i<track_len; i++) {
-        const auto& event = track.getEvent(i);
-        if (event.isNote()) {
-            const auto abs_tick = event.tick;
-            const auto note = static_cast<uint8_t>(event.getP1());
-            const auto velocity = event.getP2();
-            if (event.isNoteOn()) {
-                if (velocity == 0) {
-                    // note_on with velocity 0 are treated as note_off
-                    try {
-                        const auto& start_pair = start_note.at(note);
-                        note_drawing.emplace_back(
-                                    note,
-                                    velocity,
-                                    std::get<0>(start_pair),
-                                    event.tick
-                                    );
-                    }  catch (const std::out_of_range&) {
-                        // ignore
-                    }
-                } else {
-                    start_note.insert_or_assign(note, std::make_tuple(abs_tick, velocity)); // FIXME: duplicates note_ons?
-                }
-            } else if (event.isNoteOff()) {
-                try {
-                    const auto& start_pair = start_note.at(note);
-                    note_drawing.emplace_back(
-                                note,
-                                velocity,
-                                std::get<0>(start_pair),
-                                event.tick
-                                );
-                }  catch (const std::out_of_range&) {
-                    // ignore
-                }
-            }
+    for (auto i=0; i<notes.getNoteCount(); i++) {
+        if (!notes.isMatched(i)) {
+            // note_on without a matching note_off
+            continue;
         }
+        note_drawing.emplace_back(
+                    static_cast<uint8_t>(notes.getKey(i)),
+                    static_cast<uint8_t>(notes.getVelocity(i)),
+                    notes.getStartTick(i),
+                    notes.getEndTick(i)
+                    );
     }
 
     return note_drawing;
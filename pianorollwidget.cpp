@@ -194,7 +194,7 @@ PianoRollWidget::paintTimeline(QPainter& painter, const PianoRollViewport& viewp
     const auto height = WHITE_KEYS * m_config.whiteHeight;
     const auto width = viewport.maxWidth;
     const auto beat_width = m_config.beatWidth;
-    const auto ts_info = m_ws->create_time_signature_info(0);
+    const auto& ts_info = m_ws->conductor(0).time_signature_info();
     if (ts_info.empty()) return;
     const auto tick_per_beat = m_ws->resolution();
 
@@ -306,8 +306,8 @@ PianoRollWidget::mouseReleaseEvent(QMouseEvent *event)
                 smf::MidiMessage noteoff;
                 noteoff.makeNoteOff(static_cast<int>(m_currentTrack), note, 0); // TODO:
 
-                m_ws->append_event(m_currentTrack, start_tick, noteon);
-                m_ws->append_event(m_currentTrack, end_tick, noteoff);
+                m_ws->append_event(m_currentTrack, start_tick, std::move(noteon));
+                m_ws->append_event(m_currentTrack, end_tick, std::move(noteoff));
 
                 // request redraw
                 update();